@@ -1,23 +1,53 @@
 #include "control_analyzer.h"
 
+#include <algorithm>
+
 #include "../util/casting.h"
 
+namespace
+{
+    // The flat scan finishes nested blocks before the ones around them, so it
+    // finds errors inside out.
+    std::vector<arc::line_exception> in_source_order(const std::vector<arc::line_exception>& errors)
+    {
+        std::vector<const arc::line_exception*> sorted;
+        for(const auto& error : errors)
+        {
+            sorted.push_back(&error);
+        }
+
+        std::stable_sort(sorted.begin(), sorted.end(), [](const arc::line_exception* lhs, const arc::line_exception* rhs) {
+            return lhs->position.offset < rhs->position.offset;
+        });
+
+        std::vector<arc::line_exception> result;
+        for(auto error : sorted)
+        {
+            result.push_back(*error);
+        }
+        return result;
+    }
+}
+
 namespace arc
 {
-    control_analyzer::control_analyzer(const std::vector<std::shared_ptr<decl>>& ast, const source_file& source)
+    control_analyzer::control_analyzer(const std::vector<decl*>& ast, const source_file& source)
         : _ast(ast), _source(source)
     {
     }
 
-    bool control_analyzer::is_terminating(const std::shared_ptr<stmt>& s)
+    bool control_analyzer::is_terminating(stmt* s)
     {
-        if(auto stmt = arc::is<stmt_return>(s))
+        switch(s->kind)
         {
+        case ast_kind::stmt_return: {
             return true;
         }
-
-        if(auto stmt = arc::is<stmt_if>(s))
-        {
+        case ast_kind::stmt_block: {
+            return is_terminating(cast<stmt_block>(s)->block);
+        }
+        case ast_kind::stmt_if: {
+            auto stmt = cast<stmt_if>(s);
             bool can_fall_through = false;
             for(const auto& branch : stmt->if_branches)
             {
@@ -31,16 +61,12 @@ namespace arc
             can_fall_through |= !is_terminating(stmt->else_branch);
             return !can_fall_through;
         }
-
-        if(auto stmt = arc::is<stmt_block>(s))
-        {
-            return is_terminating(stmt->block);
         }
 
         return false;
     }
 
-    bool control_analyzer::is_terminating(const std::vector<std::shared_ptr<stmt>>& block)
+    bool control_analyzer::is_terminating(std::span<stmt* const> block)
     {
         bool found_return = false;
         for(const auto& s : block)
@@ -60,10 +86,10 @@ namespace arc
         return found_return;
     }
 
-    void control_analyzer::analyze_func(const std::shared_ptr<decl_func>& decl)
+    void control_analyzer::analyze_func(decl_func* decl)
     {
         // TODO: Only if function has a return type
-        if(!is_terminating(decl->body))
+        if(!is_terminating(decl->body()))
         {
             _errors.push_back(line_exception("not all control paths return a value", _source, decl->position));
         }
@@ -73,11 +99,73 @@ namespace arc
     {
         for(const auto& d : _ast)
         {
-            if(auto decl = arc::is<decl_func>(d))
+            if(auto decl = dyn_cast<decl_func>(d))
             {
                 analyze_func(decl);
             }
         }
         return _errors;
     }
+
+    flat_control_analyzer::flat_control_analyzer(const flat_ast& ast, const source_file& source)
+        : _ast(ast), _source(source)
+    {
+    }
+
+    bool flat_control_analyzer::is_terminating(std::span<const node_index> block)
+    {
+        for(size_t i = 0; i < block.size(); i++)
+        {
+            if(_terminating[block[i]])
+            {
+                if(i + 1 < block.size())
+                {
+                    _errors.push_back(line_exception("unreachable code", _source, _ast.positions[block[i + 1]]));
+                }
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    std::vector<line_exception> flat_control_analyzer::analyze()
+    {
+        // Children come before their parents, so by the time a statement is reached
+        // everything nested in it has been looked at.
+        _terminating.assign(_ast.nodes.size(), false);
+        for(node_index i = 0; i < _ast.nodes.size(); i++)
+        {
+            const auto& node = _ast.nodes[i];
+            switch(node.kind)
+            {
+            case ast_kind::stmt_return: {
+                _terminating[i] = true;
+            } break;
+            case ast_kind::stmt_block: {
+                _terminating[i] = is_terminating(_ast.list(node.lhs));
+            } break;
+            case ast_kind::if_branch: {
+                _terminating[i] = is_terminating(_ast.list(node.rhs));
+            } break;
+            case ast_kind::stmt_if: {
+                bool can_fall_through = !is_terminating(_ast.list(node.rhs));
+                for(auto branch : _ast.list(node.lhs))
+                {
+                    can_fall_through |= !_terminating[branch];
+                }
+                _terminating[i] = !can_fall_through;
+            } break;
+            case ast_kind::decl_func: {
+                // TODO: Only if function has a return type
+                if(!is_terminating(_ast.func_body(node)))
+                {
+                    _errors.push_back(line_exception("not all control paths return a value", _source, _ast.positions[i]));
+                }
+            } break;
+            }
+        }
+
+        return in_source_order(_errors);
+    }
 }
@@ -1,28 +1,54 @@
 #pragma once
 
 #include <vector>
-#include <memory>
+#include <span>
 
 #include "../parse/ast.h"
+#include "../parse/flat_ast.h"
 #include "../error/exceptions.h"
 #include "../util/source_file.h"
 
 namespace arc
 {
+    // The analyzer the driver runs. Flattening a module costs more than the
+    // flat scan saves while control analysis is the only pass that reads the
+    // flat form.
     class control_analyzer
     {
     private:
-        std::vector<std::shared_ptr<decl>> _ast;
+        const std::vector<decl*>& _ast;
 
         std::vector<line_exception> _errors;
         const source_file& _source;
     public:
-        control_analyzer(const std::vector<std::shared_ptr<decl>>& ast, const source_file& source);
+        control_analyzer(const std::vector<decl*>& ast, const source_file& source);
 
-        bool is_terminating(const std::shared_ptr<stmt>& s);
-        bool is_terminating(const std::vector<std::shared_ptr<stmt>>& block);
+        bool is_terminating(stmt* s);
+        bool is_terminating(std::span<stmt* const> block);
 
-        void analyze_func(const std::shared_ptr<decl_func>& decl);
+        void analyze_func(decl_func* decl);
+
+        std::vector<line_exception> analyze();
+    };
+
+    // Control analysis as one linear scan over the flat ast. Unlike the tree
+    // analyzer it checks every block, including later if branches, code after
+    // a return and member functions, so it reports more. Errors come out in
+    // source order. Only the tests and benchmarks run it for now.
+    class flat_control_analyzer
+    {
+    private:
+        const flat_ast& _ast;
+
+        // Whether each node always ends in a return, filled in as the nodes are scanned.
+        std::vector<uint8_t> _terminating;
+
+        std::vector<line_exception> _errors;
+        const source_file& _source;
+    public:
+        flat_control_analyzer(const flat_ast& ast, const source_file& source);
+
+        bool is_terminating(std::span<const node_index> block);
 
         std::vector<line_exception> analyze();
     };
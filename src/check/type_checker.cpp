@@ -1,8 +1,14 @@
 #include "type_checker.h"
 
+#include "../type/builtins.h"
 #include "../util/casting.h"
+#include "../util/thread_pool.h"
 
-#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace
 {
@@ -46,45 +52,54 @@ namespace
 
 namespace arc
 {
+	// Where a checker reports errors, one per thread when checking in parallel.
+	struct error_sink
+	{
+		const source_file& source;
+		std::vector<line_exception>& errors;
+
+		void add(const std::string& error, source_pos position) const
+		{
+			errors.push_back(line_exception(error, source, position));
+		}
+	};
+
 	class expr_checker
 	{
 	private:
-		lexical_scope* _scope;
+		const lexical_scope& _scope;
 		type_map& _type_map;
-		type_checker& _checker;
+		const error_sink& _errors;
 	public:
-		expr_checker(lexical_scope* scope, type_map& type_map, type_checker& checker)
-			: _scope(scope), _type_map(type_map), _checker(checker)
+		expr_checker(const lexical_scope& scope, type_map& type_map, const error_sink& errors)
+			: _scope(scope), _type_map(type_map), _errors(errors)
 		{
 		}
 
-		std::shared_ptr<type> check(const std::shared_ptr<expr>& e)
+		std::shared_ptr<type> check(expr* e)
 		{
-			if(auto expr = arc::is<expr_integer>(e))
+			switch(e->kind)
 			{
-				return _type_map.get(make_name_typespec("u64"));
+			case ast_kind::expr_integer: {
+				return types::u64();
 			}
-
-			if(auto expr = arc::is<expr_boolean>(e))
-			{
-				return _type_map.get(make_name_typespec("bool"));
+			case ast_kind::expr_boolean: {
+				return types::boolean();
 			}
-
-			if(auto expr = arc::is<expr_name>(e))
-			{
-				if(auto type = _scope->get(expr->name))
+			case ast_kind::expr_name: {
+				auto expr = cast<expr_name>(e);
+				if(auto type = _scope.get(expr->name_symbol))
 				{
 					return type;
 				}
 				else
 				{
-					_checker.add_error("could not find variable with name " + expr->name, expr->position);
-					return _type_map.get(make_name_typespec("none"));
+					_errors.add("could not find variable with name " + std::string(expr->name), expr->position);
+					return types::none();
 				}
 			}
-
-			if(auto expr = arc::is<expr_binary>(e))
-			{
+			case ast_kind::expr_binary: {
+				auto expr = cast<expr_binary>(e);
 				auto lhs = this->check(expr->lhs);
 				auto rhs = this->check(expr->rhs);
 				// For now, asssume binary operaters are only implemented for equal types.
@@ -95,22 +110,19 @@ namespace arc
 				}
 				else
 				{
-					_checker.add_error("operator " + operator_to_string(expr->op) + " not implemented for types", expr->position);
-					return _type_map.get(make_name_typespec("none"));
+					_errors.add("operator " + operator_to_string(expr->op) + " not implemented for types", expr->position);
+					return types::none();
 				}
 			}
-
-			if(auto expr = arc::is<expr_unary>(e))
-			{
-				auto rhs = this->check(expr->rhs);
+			case ast_kind::expr_unary: {
+				auto rhs = this->check(cast<expr_unary>(e)->rhs);
 				// TODO: Return the actual return type of the unary operator.
 				return rhs;
 			}
-
-			if(auto expr = arc::is<expr_call>(e))
-			{
+			case ast_kind::expr_call: {
+				auto expr = cast<expr_call>(e);
 				auto lhs = this->check(expr->lhs);
-				if(auto func_type = arc::is<type_func>(lhs))
+				if(auto func_type = dyn_cast<type_func>(lhs))
 				{
 					if(func_type->argument_types.size() == expr->args.size())
 					{
@@ -120,46 +132,57 @@ namespace arc
 							auto got_type = this->check(expr->args[i]);
 							if(got_type != expected_type)
 							{
-								_checker.add_error("parameter type mismatch at index " + std::to_string(i), expr->position);
+								_errors.add("parameter type mismatch at index " + std::to_string(i), expr->position);
 							}
 						}
 						return func_type->return_type;
 					}
 					else
 					{
-						_checker.add_error(
+						_errors.add(
 							"incorrect number of parameters passed to function, expected " +
 							std::to_string(func_type->argument_types.size()) +
 							", got " +
 							std::to_string(expr->args.size()),
 						expr->position);
-						return _type_map.get(make_name_typespec("none"));
+						return types::none();
 					}
 				}
 				else
 				{
-					_checker.add_error("object is not callable", expr->position);
-					return _type_map.get(make_name_typespec("none"));
+					_errors.add("object is not callable", expr->position);
+					return types::none();
 				}
 			}
-
-			if(auto expr = arc::is<expr_index>(e))
-			{
-				std::cout << "not implemented" << std::endl;
-				std::exit(1);
+			case ast_kind::expr_access: {
+				auto expr = cast<expr_access>(e);
+				auto lhs = this->check(expr->lhs);
+				if(auto structure = dyn_cast<type_struct>(lhs))
+				{
+					if(auto member = structure->find_member(expr->field))
+					{
+						return member;
+					}
+				}
+				_errors.add("type has no member named " + std::string(expr->field), expr->position);
+				return types::none();
 			}
-
-			if(auto expr = arc::is<expr_access>(e))
-			{
-				std::cout << "not implemented" << std::endl;
-				std::exit(1);
+			// These can be checked on a pool thread, so they're reported like
+			// any other error rather than ending the process.
+			case ast_kind::expr_index: {
+				auto expr = cast<expr_index>(e);
+				this->check(expr->lhs);
+				this->check(expr->index);
+				_errors.add("indexing is not supported yet", expr->position);
+				return types::none();
 			}
-
-			if(auto expr = arc::is<expr_cast>(e))
-			{
+			case ast_kind::expr_cast: {
 				// expr->types.to_type = ...;
-				std::cout << "not implemented" << std::endl;
-				std::exit(1);
+				auto expr = cast<expr_cast>(e);
+				this->check(expr->lhs);
+				_errors.add("casts are not supported yet", expr->position);
+				return types::none();
+			}
 			}
 
 			throw internal_exception("unreachable");
@@ -169,42 +192,44 @@ namespace arc
 	class func_checker
 	{
 	private:
-		std::shared_ptr<decl_func> _decl;
-		lexical_scope* _global_scope;
+		decl_func* _decl;
+		const type_struct* _owner;
+		lexical_scope& _scope;
 		type_map& _type_map;
-		type_checker& _checker;
+		const error_sink& _errors;
 	public:
-		func_checker(const std::shared_ptr<decl_func>& decl, lexical_scope* global_scope, type_map& type_map, type_checker& checker)
-			: _decl(decl), _global_scope(global_scope), _type_map(type_map), _checker(checker)
+		// scope must have no blocks open, and is left that way.
+		func_checker(const checked_func& func, lexical_scope& scope, type_map& type_map, const error_sink& errors)
+			: _decl(func.decl), _owner(func.owner), _scope(scope), _type_map(type_map), _errors(errors)
 		{
 		}
 
 		std::shared_ptr<type> check_var_declaration(
-			const std::string& name, const std::shared_ptr<typespec>& type,
-			const std::shared_ptr<expr>& initializer,
+			std::string_view name, symbol name_symbol,
+			typespec* type,
+			expr* initializer,
 			const source_pos& position,
-			bool is_const,
-			lexical_scope* scope
+			bool is_const
 		) {
 			if(initializer == nullptr && type == nullptr)
 			{
-				_checker.add_error("cannot deduce variable type", position);
-				return _type_map.get(make_name_typespec("none"));
+				_errors.add("cannot deduce variable type", position);
+				return types::none();
 			}
 			
 			// _: A = B -> A
 			if(type != nullptr && initializer != nullptr)
 			{
 				auto var_type = _type_map.get(type);
-				auto init_type = expr_checker(scope, _type_map, _checker).check(initializer);
+				auto init_type = expr_checker(_scope, _type_map, _errors).check(initializer);
 				if(init_type != var_type)
 				{
-					_checker.add_error("types cannot be assigned", position);
+					_errors.add("types cannot be assigned", position);
 				}
 
-				if(!scope->add(name, var_type))
+				if(!_scope.add(name_symbol, var_type))
 				{
-					_checker.add_error("variable name '" + name + "' already taken", position);
+					_errors.add("variable name '" + std::string(name) + "' already taken", position);
 				}
 				return var_type;
 			}
@@ -212,10 +237,10 @@ namespace arc
 			// _    = B -> B
 			if(type == nullptr && initializer != nullptr)
 			{
-				auto init_type = expr_checker(scope, _type_map, _checker).check(initializer);
-				if(!scope->add(name, init_type))
+				auto init_type = expr_checker(_scope, _type_map, _errors).check(initializer);
+				if(!_scope.add(name_symbol, init_type))
 				{
-					_checker.add_error("variable name '" + name + "' already taken", position);
+					_errors.add("variable name '" + std::string(name) + "' already taken", position);
 				}
 				return init_type;
 			}
@@ -225,13 +250,13 @@ namespace arc
 			{
 				if(is_const)
 				{
-					_checker.add_error("constant '" + name + "' must be given an initializer", position);
+					_errors.add("constant '" + std::string(name) + "' must be given an initializer", position);
 				}
 
 				auto var_type = _type_map.get(type);
-				if(!scope->add(name, var_type))
+				if(!_scope.add(name_symbol, var_type))
 				{
-					_checker.add_error("variable name '" + name + "' already taken", position);
+					_errors.add("variable name '" + std::string(name) + "' already taken", position);
 				}
 				return var_type;
 			}
@@ -239,110 +264,385 @@ namespace arc
 			throw internal_exception("unreachable");
 		}
 
-		void check_block(const std::vector<std::shared_ptr<stmt>>& block, lexical_scope* scope = nullptr)
+		void check_block(std::span<stmt* const> block)
 		{
-			lexical_scope local_scope(scope);
-			if(scope == nullptr)
-			{
-				scope = &local_scope;
-			}
+			_scope.enter();
+			check_stmts(block);
+			_scope.leave();
+		}
 
+		void check_stmts(std::span<stmt* const> block)
+		{
 			for(const auto& s : block)
 			{
-				if(auto stmt = arc::is<stmt_let>(s))
-				{
-					stmt->types.deduced_type = check_var_declaration(stmt->name, stmt->type, stmt->initializer, stmt->position, false, scope);
-				}
-				
-				if(auto stmt = arc::is<stmt_const>(s))
-				{
-					stmt->types.deduced_type = check_var_declaration(stmt->name, stmt->type, stmt->initializer, stmt->position, true, scope);
-				}
-				
-				if(auto stmt = arc::is<stmt_if>(s))
+				switch(s->kind)
 				{
+				case ast_kind::stmt_let: {
+					auto stmt = cast<stmt_let>(s);
+					stmt->types.deduced_type = check_var_declaration(stmt->name, stmt->name_symbol, stmt->type, stmt->initializer, stmt->position, false);
+				} break;
+				case ast_kind::stmt_const: {
+					auto stmt = cast<stmt_const>(s);
+					stmt->types.deduced_type = check_var_declaration(stmt->name, stmt->name_symbol, stmt->type, stmt->initializer, stmt->position, true);
+				} break;
+				case ast_kind::stmt_if: {
+					auto stmt = cast<stmt_if>(s);
 					for(const auto& branch : stmt->if_branches)
 					{
-						auto cond_type = expr_checker(scope, _type_map, _checker).check(branch.condition);
-						if(cond_type != _type_map.get(make_name_typespec("bool")))
+						auto cond_type = expr_checker(_scope, _type_map, _errors).check(branch.condition);
+						if(cond_type != types::boolean())
 						{
-							_checker.add_error("if condition must be a boolean type", stmt->position);
+							_errors.add("if condition must be a boolean type", stmt->position);
 						}
 						check_block(branch.body);
 					}
 					check_block(stmt->else_branch);
-				}
-				
-				if(auto stmt = arc::is<stmt_return>(s))
-				{
-					auto return_type = _type_map.get(_decl->ret_type);
-					auto none_type = _type_map.get(make_name_typespec("none"));
+				} break;
+				case ast_kind::stmt_return: {
+					auto stmt = cast<stmt_return>(s);
+					auto return_type = _decl->types.ret_type;
+					auto none_type = types::none();
 					if(stmt->expression == nullptr)
 					{
 						if(return_type != none_type)
 						{
-							_checker.add_error("function " + _decl->name + " must return a value", stmt->position);
+							_errors.add("function " + std::string(_decl->name) + " must return a value", stmt->position);
 						}
 					}
 					else
 					{
 						if(return_type == none_type)
 						{
-							_checker.add_error("function " + _decl->name + " does not return a value", stmt->position);
+							_errors.add("function " + std::string(_decl->name) + " does not return a value", stmt->position);
 						}
 						else
 						{
-							auto return_val_type = expr_checker(scope, _type_map, _checker).check(stmt->expression);
+							auto return_val_type = expr_checker(_scope, _type_map, _errors).check(stmt->expression);
 							if(return_type != return_val_type)
 							{
-								_checker.add_error("function " + _decl->name + " does not return that type", stmt->position);
+								_errors.add("function " + std::string(_decl->name) + " does not return that type", stmt->position);
 							}
 						}
 					}
+				} break;
+				case ast_kind::stmt_block: {
+					check_block(cast<stmt_block>(s)->block);
+				} break;
+				case ast_kind::stmt_expr: {
+					expr_checker(_scope, _type_map, _errors).check(cast<stmt_expr>(s)->expression);
+				} break;
 				}
+			}
+		}
 
-				if(auto stmt = arc::is<stmt_block>(s))
+		// The signature must already have been resolved by the decl_collector.
+		void check_body()
+		{
+			// Members are in a block of their own, so arguments and locals can
+			// hide them.
+			if(_owner != nullptr)
+			{
+				_scope.enter();
+				for(const auto& members : { &_owner->fields, &_owner->functions })
 				{
-					check_block(stmt->block);
+					for(const auto& m : *members)
+					{
+						if(m.type != nullptr)
+						{
+							_scope.add(symbol::intern(m.name), m.type);
+						}
+					}
 				}
+			}
 
-				if(auto stmt = arc::is<stmt_expr>(s))
+			// The arguments share a block with the top level of the body.
+			_scope.enter();
+			for(auto& arg : _decl->arguments)
+			{
+				if(!_scope.add(arg.name_symbol, arg.types.type))
 				{
-					expr_checker(scope, _type_map, _checker).check(stmt->expression);
+					_errors.add("argument name '" + std::string(arg.name) + "' already taken", _decl->position);
 				}
 			}
+			check_stmts(_decl->body());
+			_scope.leave();
+
+			if(_owner != nullptr)
+			{
+				_scope.leave();
+			}
 		}
+	};
 
-		void check()
+	// Registers every top level declaration before any body is checked, so that
+	// bodies can refer to anything in the module whatever order it's declared
+	// in. Struct names come first, then aliases, which are resolved on demand
+	// so they can refer to each other in any order, then struct members and
+	// function signatures.
+	class decl_collector
+	{
+	private:
+		enum class alias_state
 		{
-			lexical_scope scope(_global_scope);
-			_decl->types.ret_type = _type_map.get(_decl->ret_type);
+			pending,
+			resolving,
+			resolved,
+			failed
+		};
 
-			for(auto& arg : _decl->arguments)
+		struct alias_entry
+		{
+			decl_alias* decl;
+			alias_state state;
+		};
+
+		lexical_scope& _global_scope;
+		type_map& _type_map;
+		const error_sink& _errors;
+
+		std::unordered_map<std::string_view, alias_entry> _aliases;
+	public:
+		decl_collector(lexical_scope& global_scope, type_map& type_map, const error_sink& errors)
+			: _global_scope(global_scope), _type_map(type_map), _errors(errors)
+		{
+		}
+
+		// Fills funcs with the functions whose signatures resolved, member
+		// functions first. The others have already been reported.
+		void collect(std::span<decl* const> ast, std::vector<checked_func>& funcs)
+		{
+			std::vector<std::pair<decl_struct*, std::shared_ptr<type_struct>>> structs;
+			std::vector<decl_alias*> aliases;
+			std::vector<decl_func*> decls;
+			for(const auto& d : ast)
 			{
-				const_cast<func_arg&>(arg).types.type = _type_map.get(arg.type);
-				scope.add(arg.name, arg.types.type);
+				switch(d->kind)
+				{
+				case ast_kind::decl_struct: {
+					auto decl = cast<decl_struct>(d);
+					if(auto type = _type_map.add_struct(decl->name))
+					{
+						structs.emplace_back(decl, type);
+					}
+					else
+					{
+						_errors.add("type name '" + std::string(decl->name) + "' already taken", decl->position);
+					}
+				} break;
+				case ast_kind::decl_func: {
+					decls.push_back(cast<decl_func>(d));
+				} break;
+				}
 			}
 
-			check_block(_decl->body, &scope);
+			// Only once every struct has its name, so an alias can't take the
+			// name of a struct declared after it.
+			for(const auto& d : ast)
+			{
+				if(auto decl = dyn_cast<decl_alias>(d))
+				{
+					if(_type_map.get(decl->name) == nullptr && _aliases.emplace(decl->name, alias_entry { decl, alias_state::pending }).second)
+					{
+						aliases.push_back(decl);
+					}
+					else
+					{
+						_errors.add("type name '" + std::string(decl->name) + "' already taken", decl->position);
+					}
+				}
+			}
+
+			for(auto decl : aliases)
+			{
+				resolve_alias(_aliases.find(decl->name)->second);
+			}
+
+			for(const auto& [decl, type] : structs)
+			{
+				std::unordered_set<std::string_view> names;
+				for(const auto& field : decl->fields)
+				{
+					if(!names.insert(field.name).second)
+					{
+						_errors.add("member name '" + std::string(field.name) + "' already taken", decl->position);
+						continue;
+					}
+					type->fields.push_back({ std::string(field.name), resolve(field.type) });
+				}
+				for(auto func : decl->functions)
+				{
+					if(!names.insert(func->name).second)
+					{
+						_errors.add("member name '" + std::string(func->name) + "' already taken", func->position);
+						continue;
+					}
+
+					auto func_type = collect_signature(func);
+					type->functions.push_back({ std::string(func->name), func_type });
+					if(func_type != nullptr)
+					{
+						funcs.push_back({ func, type.get() });
+					}
+				}
+			}
+
+			for(auto decl : decls)
+			{
+				auto type = collect_signature(decl);
+				if(type == nullptr)
+				{
+					continue;
+				}
+				// The name belongs to the first function declared with it, so
+				// this body would be checked against the wrong signature.
+				if(!_global_scope.add(symbol::intern(decl->name), type))
+				{
+					_errors.add("function name '" + std::string(decl->name) + "' already taken", decl->position);
+					continue;
+				}
+				funcs.push_back({ decl, nullptr });
+			}
+		}
+	private:
+		// Resolves the argument and return types, and gives back the type of
+		// the function, or null if part of it is unknown.
+		std::shared_ptr<type> collect_signature(decl_func* decl)
+		{
+			bool known = true;
+			std::vector<std::shared_ptr<type>> argument_types;
+			for(auto& arg : decl->arguments)
+			{
+				auto type = resolve(arg.type);
+				arg.types.type = type;
+				argument_types.push_back(type);
+				known = known && type != nullptr;
+			}
+
+			decl->types.ret_type = resolve(decl->ret_type);
+			if(!known || decl->types.ret_type == nullptr)
+			{
+				return nullptr;
+			}
+			return _type_map.types().func(decl->types.ret_type, argument_types);
+		}
+
+		// Resolves spec after resolving any aliases it names, reporting it if
+		// the type doesn't exist.
+		std::shared_ptr<type> resolve(typespec* spec)
+		{
+			if(!resolve_aliases(spec))
+			{
+				return nullptr;
+			}
+
+			auto type = _type_map.get(spec);
+			if(type == nullptr)
+			{
+				if(auto name = unknown_name(spec))
+				{
+					_errors.add("unknown type '" + std::string(name->name) + "'", name->position);
+				}
+				else
+				{
+					_errors.add("unknown type", spec->position);
+				}
+			}
+			return type;
+		}
+
+		// The first name in spec that isn't a type, null if the typespec is
+		// left over from a parse error.
+		typespec_name* unknown_name(typespec* spec)
+		{
+			switch(spec->kind)
+			{
+			case ast_kind::typespec_name: {
+				return cast<typespec_name>(spec);
+			}
+			case ast_kind::typespec_pointer: {
+				return unknown_name(cast<typespec_pointer>(spec)->base);
+			}
+			case ast_kind::typespec_func: {
+				auto func = cast<typespec_func>(spec);
+				for(auto part : func->argument_types)
+				{
+					if(_type_map.get(part) == nullptr) { return unknown_name(part); }
+				}
+				return unknown_name(func->return_type);
+			}
+			}
+			return nullptr;
+		}
+
+		// Returns false if spec names an alias that couldn't be resolved, which
+		// has already been reported.
+		bool resolve_aliases(typespec* spec)
+		{
+			switch(spec->kind)
+			{
+			case ast_kind::typespec_name: {
+				auto f = _aliases.find(cast<typespec_name>(spec)->name);
+				return f == _aliases.end() || resolve_alias(f->second);
+			}
+			case ast_kind::typespec_pointer: {
+				return resolve_aliases(cast<typespec_pointer>(spec)->base);
+			}
+			case ast_kind::typespec_func: {
+				auto func = cast<typespec_func>(spec);
+				bool resolved = resolve_aliases(func->return_type);
+				for(auto arg : func->argument_types)
+				{
+					resolved = resolve_aliases(arg) && resolved;
+				}
+				return resolved;
+			}
+			}
+			return true;
+		}
+
+		bool resolve_alias(alias_entry& alias)
+		{
+			switch(alias.state)
+			{
+			case alias_state::resolved: return true;
+			case alias_state::failed:   return false;
+			case alias_state::resolving: {
+				_errors.add("alias '" + std::string(alias.decl->name) + "' refers to itself", alias.decl->position);
+				alias.state = alias_state::failed;
+				return false;
+			}
+			case alias_state::pending: break;
+			}
+
+			alias.state = alias_state::resolving;
+			auto type = resolve_aliases(alias.decl->type) ? resolve(alias.decl->type) : nullptr;
+			// Whoever found the cycle has already marked it as failed.
+			if(alias.state == alias_state::failed || type == nullptr)
+			{
+				alias.state = alias_state::failed;
+				return false;
+			}
+
+			if(!_type_map.add(alias.decl->name, type))
+			{
+				_errors.add("type name '" + std::string(alias.decl->name) + "' already taken", alias.decl->position);
+				alias.state = alias_state::failed;
+				return false;
+			}
+
+			alias.state = alias_state::resolved;
+			return true;
 		}
 	};
 
-    type_checker::type_checker(const std::vector<std::shared_ptr<decl>>& ast, const source_file& source)
+    type_checker::type_checker(const std::vector<decl*>& ast, const source_file& source)
 		: _ast(ast), _source(source)
 	{
-		_type_map.add(arc::make_name_typespec("none"), new arc::type_none());
-		_type_map.add(arc::make_name_typespec("bool"), new arc::type_bool());
-		_type_map.add(arc::make_name_typespec("f32"), new arc::type_float(32));
-		_type_map.add(arc::make_name_typespec("f64"), new arc::type_float(64));
-		_type_map.add(arc::make_name_typespec("u8"), new arc::type_integer(false, 8));
-		_type_map.add(arc::make_name_typespec("u16"), new arc::type_integer(false, 16));
-		_type_map.add(arc::make_name_typespec("u32"), new arc::type_integer(false, 32));
-		_type_map.add(arc::make_name_typespec("u64"), new arc::type_integer(false, 64));
-		_type_map.add(arc::make_name_typespec("i8"), new arc::type_integer(true, 8));
-		_type_map.add(arc::make_name_typespec("i16"), new arc::type_integer(true, 16));
-		_type_map.add(arc::make_name_typespec("i32"), new arc::type_integer(true, 32));
-		_type_map.add(arc::make_name_typespec("i64"), new arc::type_integer(true, 64));
+	}
+
+    type_checker::type_checker(const std::vector<decl*>& ast, const source_file& source, type_interner& types)
+		: _type_map(types), _ast(ast), _source(source)
+	{
 	}
     
 	void type_checker::add_error(const std::string& error, source_pos position)
@@ -350,16 +650,105 @@ namespace arc
 		_errors.push_back(line_exception(error, _source, position));
 	}
 
+	void type_checker::collect_declarations(std::vector<line_exception>& errors)
+	{
+		_funcs.clear();
+		error_sink sink { _source, errors };
+		decl_collector(_global_scope, _type_map, sink).collect(_ast, _funcs);
+	}
+
+	void type_checker::merge_errors(const std::vector<std::vector<line_exception>>& body_errors)
+	{
+		std::vector<const line_exception*> errors;
+		for(const auto& list : body_errors)
+		{
+			for(const auto& error : list)
+			{
+				errors.push_back(&error);
+			}
+		}
+
+		// Functions don't overlap, so this gives the same order whichever worker
+		// checked each one. Errors at the same position keep the order they were
+		// found in.
+		std::stable_sort(errors.begin(), errors.end(), [](const line_exception* lhs, const line_exception* rhs) {
+			return lhs->position.offset < rhs->position.offset;
+		});
+
+		for(auto error : errors)
+		{
+			_errors.push_back(*error);
+		}
+	}
+
 	std::vector<line_exception> type_checker::check()
 	{
-		for(const auto& d : _ast)
+		std::vector<std::vector<line_exception>> errors(2);
+		collect_declarations(errors[1]);
+
+		error_sink sink { _source, errors[0] };
+		lexical_scope scope(&_global_scope);
+		for(const auto& func : _funcs)
+		{
+			func_checker(func, scope, _type_map, sink).check_body();
+		}
+
+		merge_errors(errors);
+		return _errors;
+	}
+
+	std::vector<line_exception> type_checker::check(thread_pool& pool)
+	{
+		std::vector<line_exception> declaration_errors;
+		collect_declarations(declaration_errors);
+
+		// Each slot of the pool pulls functions off a shared counter with its
+		// own scope stack and error list, so a few long bodies can't hold up
+		// everything queued behind them.
+		struct worker
 		{
-			if(auto decl = arc::is<decl_func>(d))
+			std::vector<line_exception> errors;
+			std::exception_ptr exception;
+			size_t failed_at = SIZE_MAX;
+		};
+
+		std::vector<worker> workers(std::min(pool.size(), std::max<size_t>(_funcs.size(), 1)));
+		std::atomic<size_t> next = 0;
+		pool.parallel_for(workers.size(), [&](size_t w) {
+			auto& worker = workers[w];
+			error_sink sink { _source, worker.errors };
+			lexical_scope scope(&_global_scope);
+			for(size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < _funcs.size();)
 			{
-				func_checker(decl, &_global_scope, _type_map, *this).check();
+				try
+				{
+					func_checker(_funcs[i], scope, _type_map, sink).check_body();
+				}
+				catch(...)
+				{
+					worker.exception = std::current_exception();
+					worker.failed_at = i;
+					return;
+				}
 			}
+		});
+
+		// Throw whatever check() would have thrown first.
+		auto failed = std::min_element(workers.begin(), workers.end(), [](const worker& lhs, const worker& rhs) {
+			return lhs.failed_at < rhs.failed_at;
+		});
+		if(failed->exception)
+		{
+			std::rethrow_exception(failed->exception);
 		}
 
+		std::vector<std::vector<line_exception>> errors;
+		errors.push_back(std::move(declaration_errors));
+		for(auto& worker : workers)
+		{
+			errors.push_back(std::move(worker.errors));
+		}
+		merge_errors(errors);
 		return _errors;
 	}
 }
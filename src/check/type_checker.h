@@ -1,48 +1,109 @@
 #pragma once
 
-#include <unordered_map>
+#include <algorithm>
 #include <memory>
+#include <vector>
+#include <string>
+#include <string_view>
 
 #include "../error/exceptions.h"
 #include "../parse/ast.h"
 #include "../type/types.h"
 #include "../type/type_map.h"
+#include "../util/symbol.h"
 
 namespace arc
 {
+    // Every name in scope, kept as one flat stack of bindings. Each symbol knows
+    // its innermost binding and each binding the one it shadows, so a lookup
+    // costs the same however deeply blocks are nested, and leaving a block only
+    // pops what was declared in it.
     class lexical_scope
 	{
 	private:
-		lexical_scope* _parent;
-		std::unordered_map<std::string, std::shared_ptr<type>> _symbols;
+		struct binding
+		{
+			std::shared_ptr<arc::type> type;
+			symbol name;
+			uint32_t depth;
+			// Index + 1 of the binding this one hides, 0 if it hides nothing.
+			uint32_t shadowed;
+		};
+
+		const lexical_scope* _parent;
+		std::vector<binding> _bindings;
+		// Index + 1 of the innermost binding of each symbol, by symbol id.
+		std::vector<uint32_t> _innermost;
+		// How many bindings there were when each open block was entered.
+		std::vector<uint32_t> _blocks;
 	public:
-		lexical_scope(lexical_scope* parent = nullptr)
+		lexical_scope(const lexical_scope* parent = nullptr)
 			: _parent(parent)
 		{
 		}
 
-		bool add(const std::string& name, const std::shared_ptr<type>& type)
+		void enter()
+		{
+			_blocks.push_back(uint32_t(_bindings.size()));
+		}
+
+		void leave()
 		{
-			if(_symbols.find(name) == _symbols.end())
+			auto mark = _blocks.back();
+			_blocks.pop_back();
+
+			while(_bindings.size() > mark)
 			{
-				_symbols[name] = type;
-				return true;
+				auto& b = _bindings.back();
+				_innermost[b.name.id] = b.shadowed;
+				_bindings.pop_back();
 			}
-			return false;
 		}
 
-		std::shared_ptr<type> get(const std::string& name, bool recursive = true)
+		// Returns false if the name is already declared in the current block.
+		bool add(symbol name, const std::shared_ptr<type>& type)
 		{
-			auto sym = _symbols.find(name);
-			if(sym != _symbols.end())
+			if(name.id >= _innermost.size())
 			{
-				return sym->second;
+				_innermost.resize(std::max<size_t>(symbol::count(), name.id + 1));
 			}
 
-			return recursive && _parent != nullptr ? _parent->get(name) : nullptr;
+			auto& innermost = _innermost[name.id];
+			auto depth = uint32_t(_blocks.size());
+			if(innermost != 0 && _bindings[innermost - 1].depth == depth)
+			{
+				return false;
+			}
+
+			_bindings.push_back({ type, name, depth, innermost });
+			innermost = uint32_t(_bindings.size());
+			return true;
+		}
+
+		std::shared_ptr<type> get(symbol name) const
+		{
+			if(name.id < _innermost.size() && _innermost[name.id] != 0)
+			{
+				return _bindings[_innermost[name.id] - 1].type;
+			}
+
+			return _parent != nullptr ? _parent->get(name) : nullptr;
 		}
 	};
 
+	class thread_pool;
+
+	// A function whose body is checked, and the struct it's a member of.
+	struct checked_func
+	{
+		decl_func* decl;
+		const type_struct* owner;
+	};
+
+	// Checking happens in two phases. Every top level declaration is collected
+	// first, on one thread, after which the global scope and the type names are
+	// only read. Each function body then only touches its own nodes,
+	// so bodies can be checked in any order, or all at once.
 	class type_checker
 	{
 	private:
@@ -52,12 +113,29 @@ namespace arc
 		std::vector<line_exception> _errors;
         const source_file& _source;
 
-		std::vector<std::shared_ptr<decl>> _ast;
+		std::vector<decl*> _ast;
+		std::vector<checked_func> _funcs;
 	public:
-		type_checker(const std::vector<std::shared_ptr<decl>>& ast, const source_file& source);
+		// Struct types recorded in the ast lose their members once the checker
+		// is gone, since they belong to its interner.
+		type_checker(const std::vector<decl*>& ast, const source_file& source);
+
+		// Builds types through types, which must be the interner the types
+		// already in the ast came from. Pass one that outlives the checker to
+		// keep using the recorded types afterwards.
+		type_checker(const std::vector<decl*>& ast, const source_file& source, type_interner& types);
 
 		void add_error(const std::string& error, source_pos position);
 
 		std::vector<line_exception> check();
+
+		// Checks the function bodies on the pool, giving the same errors as check().
+		std::vector<line_exception> check(thread_pool& pool);
+	private:
+		// Registers the functions, structs and aliases declared at the top level.
+		void collect_declarations(std::vector<line_exception>& errors);
+
+		// Adds the errors found to _errors, ordered by position.
+		void merge_errors(const std::vector<std::vector<line_exception>>& body_errors);
 	};
 }
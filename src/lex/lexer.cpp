@@ -1,6 +1,11 @@
 #include "lexer.h"
 
 #include <iostream>
+#include <charconv>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <algorithm>
 
 namespace
 {
@@ -9,9 +14,31 @@ namespace
         return c == 0x20 || c == 0x0A || c == 0x0D || c == 0x09;
     }
 
+    // Value of every character as a digit, or 0xFF if it is not one. A character
+    // is a digit in base b if its value is less than b.
+    constexpr auto digit_values = []() {
+        std::array<uint8_t, 256> values = {};
+        for(auto& v : values) { v = 0xFF; }
+        for(int c = '0'; c <= '9'; c++) { values[c] = uint8_t(c - '0'); }
+        for(int c = 'a'; c <= 'f'; c++) { values[c] = uint8_t(c - 'a' + 10); }
+        for(int c = 'A'; c <= 'F'; c++) { values[c] = uint8_t(c - 'A' + 10); }
+        return values;
+    }();
+
+    static uint32_t digit_value(char c)
+    {
+        return digit_values[uint8_t(c)];
+    }
+
+    template<uint32_t Base>
+    static bool is_digit(char c)
+    {
+        return digit_value(c) < Base;
+    }
+
     static bool is_number(char c)
     {
-        return c >= '0' && c <= '9';
+        return is_digit<10>(c);
     }
 
     static bool is_letter(char c)
@@ -24,71 +51,146 @@ namespace
         return is_letter(c) || c == '_';
     }
 
-    static bool is_ident_char(char c)
+    static bool is_exponent_start(const char* c)
     {
-        return is_ident_start_char(c) || is_number(c);
+        if(c[0] != 'e' && c[0] != 'E') { return false; }
+        if(is_number(c[1])) { return true; }
+        return (c[1] == '+' || c[1] == '-') && is_number(c[2]);
     }
 
-    static bool is_decimal_number(char c)
+    // Checks that all 8 bytes of a little endian load are ascii digits.
+    static bool is_eight_digits(uint64_t chunk)
     {
-        return is_number(c);
+        return ((chunk & 0xF0F0F0F0F0F0F0F0) | (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
     }
 
-    static bool is_hex_number(char c)
+    // Converts 8 ascii digits from a little endian load, pairing up digits, then
+    // pairs of pairs and so on, instead of going one digit at a time.
+    static uint64_t parse_eight_digits(uint64_t chunk)
     {
-        return is_number(c) || (c >= 'a' && c <= 'F') || (c >= 'A' && c <= 'F');
+        chunk = ((chunk & 0x0F0F0F0F0F0F0F0F) * 2561) >> 8;
+        chunk = ((chunk & 0x00FF00FF00FF00FF) * 6553601) >> 16;
+        return ((chunk & 0x0000FFFF0000FFFF) * 42949672960001) >> 32;
     }
+}
 
-    static bool is_octal_number(char c)
+namespace arc
+{
+    lexer::lexer(const source_file& source)
+        : _source(source), _stream(source.buffer(), 0, source.size(), source.id()), _finished(false)
     {
-        return c >= '0' && c <= '7';
     }
 
-    static bool is_binary_number(char c)
+    lexer::lexer(const source_file& source, size_t begin, size_t end)
+        : _source(source), _stream(source.buffer(), begin, end, source.id()), _finished(false)
     {
-        return c == '0' || c == '1';
     }
 
-    static uint64_t convert_char(char c)
+    std::string_view lexer::parse_identifier()
     {
-        if(is_number(c)) { return uint64_t(c - '0'); }
-        if(c >= 'a' && c <= 'f') { return uint64_t(c - 'a') + 10; }
-        if(c >= 'A' && c <= 'F') { return uint64_t(c - 'A') + 10; }
-        return 0;
+        auto length = scan_identifier(_stream.current(), _stream.remaining());
+        std::string_view ident(_stream.current(), length);
+        _stream.skip(length);
+
+        return ident;
     }
-}
 
-namespace arc
-{
-    lexer::lexer(const source_file& source)
-        : _source(source), _stream(source.buffer(), source.size())
+    symbol lexer::intern(std::string_view ident)
     {
+        constexpr size_t cache_size = 4096;
+        if(_symbols.empty())
+        {
+            _symbols.resize(cache_size);
+        }
+
+        uint32_t h = 2166136261u;
+        for(char c : ident)
+        {
+            h = (h ^ uint8_t(c)) * 16777619u;
+        }
+
+        auto& entry = _symbols[h & (cache_size - 1)];
+        if(entry.text != ident)
+        {
+            entry = { ident, symbol::intern(ident) };
+        }
+        return entry.sym;
     }
 
-    std::string lexer::parse_identifier()
+    template<uint32_t Base>
+    uint64_t lexer::parse_digits(bool& overflow)
     {
-        std::string ident = "";
-        while(_stream.has_next() && is_ident_char(_stream.peek()))
+        constexpr uint64_t limit = UINT64_MAX / Base;
+        constexpr uint64_t last_digit_limit = UINT64_MAX % Base;
+
+        auto digits = _stream.current();
+        auto remaining = _stream.remaining();
+
+        uint64_t val = 0;
+        size_t i = 0;
+
+        if constexpr(Base == 10 && std::endian::native == std::endian::little)
         {
-            ident += _stream.next();
+            constexpr uint64_t chunk_limit = UINT64_MAX / 100000000;
+
+            while(i + 8 <= remaining)
+            {
+                uint64_t chunk;
+                std::memcpy(&chunk, digits + i, sizeof(chunk));
+                if(!is_eight_digits(chunk))
+                {
+                    break;
+                }
+
+                auto chunk_value = parse_eight_digits(chunk);
+                if(val > chunk_limit || val * 100000000 > UINT64_MAX - chunk_value)
+                {
+                    overflow = true;
+                }
+
+                val = val * 100000000 + chunk_value;
+                i += 8;
+            }
         }
 
-        return ident;
+        for(; i < remaining; i++)
+        {
+            auto digit = digit_value(digits[i]);
+            if(digit >= Base)
+            {
+                break;
+            }
+
+            if(val > limit || (val == limit && digit > last_digit_limit))
+            {
+                overflow = true;
+            }
+
+            val = val * Base + digit;
+        }
+
+        _stream.skip(i);
+        return val;
     }
 
-    uint64_t lexer::parse_number(uint32_t base, std::function<bool(char)> predicate)
+    template<uint32_t Base>
+    uint64_t lexer::parse_prefixed_number()
     {
-        if(!_stream.has_next() || !predicate(_stream.peek()))
+        _stream.next(); // eat the leading 0
+        _stream.next(); // eat the base prefix
+
+        if(!is_digit<Base>(_stream.peek()))
         {
             _errors.push_back(line_exception("malformed integer literal", _source, _stream.position()));
             return 0;
         }
 
-        uint64_t val = 0;
-        while(_stream.has_next() && predicate(_stream.peek()))
+        auto position = _stream.position();
+        bool overflow = false;
+        auto val = parse_digits<Base>(overflow);
+        if(overflow)
         {
-            val *= base;
-            val += convert_char(_stream.next());
+            _errors.push_back(line_exception("integer literal is too large", _source, position));
         }
 
         return val;
@@ -98,104 +200,181 @@ namespace arc
     {
         if(_stream.peek() == '0')
         {
-            if(_stream.peek(1) == 'b')
-            {
-                _stream.next(); // eat the leading 0
-                _stream.next(); // eat the leading b
-                auto v = parse_number(2, is_binary_number);
-
-                return {
-                    .is_float = false,
-                    .val_int = v
-                };
-            }
-            else if(_stream.peek(1) == 'o')
+            switch(_stream.peek(1))
             {
-                _stream.next(); // eat the leading 0
-                _stream.next(); // eat the leading o
-                auto v = parse_number(8, is_octal_number);
-                
-                return {
-                    .is_float = false,
-                    .val_int = v
-                };
-            }
-            else if(_stream.peek(1) == 'x')
-            {
-                _stream.next(); // eat the leading 0
-                _stream.next(); // eat the leading x
-                auto v = parse_number(16, is_hex_number);
-                
-                return {
-                    .is_float = false,
-                    .val_int = v
-                };
+            case 'b': return { .is_float = false, .val_int = parse_prefixed_number<2>() };
+            case 'o': return { .is_float = false, .val_int = parse_prefixed_number<8>() };
+            case 'x': return { .is_float = false, .val_int = parse_prefixed_number<16>() };
             }
         }
 
-        auto v = parse_number(10, is_decimal_number);
+        // Decimal literals are only known to be floats once we have seen a '.' or
+        // an exponent, in which case the whole literal is converted again below.
+        auto position = _stream.position();
+        auto begin = _stream.current();
+        bool is_float = false;
+
+        bool overflow = false;
+        auto val_int = parse_digits<10>(overflow);
         if(_stream.peek() == '.')
         {
             _stream.next();
+            _stream.skip(scan_digits(_stream.current(), _stream.remaining()));
+            is_float = true;
+        }
+
+        // The source buffer is NUL terminated, so looking two characters ahead is safe here.
+        if(is_exponent_start(_stream.current()))
+        {
+            _stream.skip(is_number(_stream.peek(1)) ? 1 : 2);
+            _stream.skip(scan_digits(_stream.current(), _stream.remaining()));
+            is_float = true;
+        }
 
-            double f = 0.0;
-            double m = 0.1;
+        auto end = _stream.current();
 
-            while(_stream.has_next() && is_decimal_number(_stream.peek()))
+        if(is_float)
+        {
+            double val = 0.0;
+            if(std::from_chars(begin, end, val).ec == std::errc::result_out_of_range)
             {
-                f += double(convert_char(_stream.next())) * m;
-                m *= 0.1;
+                _errors.push_back(line_exception("float literal is out of range", _source, position));
             }
 
             return {
                 .is_float = true,
-                .val_float = double(v) + f
+                .val_float = val
             };
         }
-        
+
+        if(overflow)
+        {
+            _errors.push_back(line_exception("integer literal is too large", _source, position));
+        }
+
         return {
             .is_float = false,
-            .val_int = v
+            .val_int = val_int
         };
     }
 
     lexer_result lexer::lex()
     {
         std::vector<token> tokens;
+        lex_some(tokens);
+
+        return lexer_result(std::move(tokens), std::move(_errors));
+    }
+
+    lexer_result lexer::lex_parallel(const source_file& source, thread_pool& pool, size_t min_chunk_size)
+    {
+        auto buffer = source.buffer();
+        auto size = source.size();
+
+        // No token can span a newline, so every line boundary is a safe place to split.
+        auto chunk_size = std::max(min_chunk_size, size / (pool.size() * 4) + 1);
+        std::vector<size_t> bounds = { 0 };
+        while(bounds.back() < size)
+        {
+            auto target = bounds.back() + chunk_size;
+            auto newline = target < size ? static_cast<const char*>(std::memchr(buffer + target, '\n', size - target)) : nullptr;
+            bounds.push_back(newline != nullptr ? size_t(newline - buffer) + 1 : size);
+        }
+
+        auto chunks = bounds.size() - 1;
+        std::vector<std::vector<token>> chunk_tokens(chunks);
+        std::vector<std::vector<line_exception>> chunk_errors(chunks);
+
+        pool.parallel_for(chunks, [&](size_t i) {
+            lexer chunk_lexer(source, bounds[i], bounds[i + 1]);
+            chunk_lexer.lex_tokens(chunk_tokens[i]);
+            chunk_errors[i] = std::move(chunk_lexer._errors);
+        });
+
+        size_t token_count = 1;
+        for(const auto& t : chunk_tokens)
+        {
+            token_count += t.size();
+        }
+
+        std::vector<token> tokens;
+        std::vector<line_exception> errors;
+        tokens.reserve(token_count);
+        for(size_t i = 0; i < chunks; i++)
+        {
+            tokens.insert(tokens.end(), chunk_tokens[i].begin(), chunk_tokens[i].end());
+            for(const auto& error : chunk_errors[i])
+            {
+                errors.push_back(error);
+            }
+        }
+        tokens.emplace_back(token_type::eof, token_payload(), source_pos { .offset = uint32_t(size), .file = source.id() }, 0);
 
-        while(_stream.has_next())
+        return lexer_result(std::move(tokens), std::move(errors));
+    }
+
+    bool lexer::lex_some(std::vector<token>& tokens, size_t count)
+    {
+        if(_finished)
+        {
+            return false;
+        }
+
+        lex_tokens(tokens, count == SIZE_MAX ? SIZE_MAX : tokens.size() + count);
+        if(!_stream.has_next())
+        {
+            tokens.emplace_back(token_type::eof, token_payload(), _stream.position(), 0);
+            _finished = true;
+        }
+        return true;
+    }
+
+    const std::vector<line_exception>& lexer::errors() const
+    {
+        return _errors;
+    }
+
+    void lexer::lex_tokens(std::vector<token>& tokens, size_t limit)
+    {
+        if(limit == SIZE_MAX)
+        {
+            tokens.reserve(tokens.size() + _stream.remaining() / 4);
+        }
+
+        while(_stream.has_next() && tokens.size() < limit)
         {
             auto cur_pos = _stream.position();
 
-            auto emit = [&](token_type type, token_value value = uint64_t(0)) {
-                tokens.emplace_back(type, value, cur_pos);
+            auto emit = [&](token_type type, token_payload payload = {}) {
+                tokens.emplace_back(type, payload, cur_pos, uint32_t(_stream.offset() - cur_pos.offset));
             };
 
             if(is_whitespace(_stream.peek()))
             {
-                _stream.next();
+                _stream.skip_whitespace();
                 continue;
             }
 
             if(is_ident_start_char(_stream.peek()))
             {
                 auto ident = parse_identifier();
-                if(ident == "func"     ) { emit(token_type::func,       "func"     ); continue; }
-                if(ident == "return"   ) { emit(token_type::return_,    "return"   ); continue; }
-                if(ident == "if"       ) { emit(token_type::if_,        "if"       ); continue; }
-                if(ident == "elif"     ) { emit(token_type::elif,       "elif"     ); continue; }
-                if(ident == "else"     ) { emit(token_type::else_,      "else"     ); continue; }
-                if(ident == "as"       ) { emit(token_type::as,         "as"       ); continue; }
-                if(ident == "let"      ) { emit(token_type::let,        "let"      ); continue; }
-                if(ident == "const"    ) { emit(token_type::const_,     "const"    ); continue; }
-                if(ident == "import"   ) { emit(token_type::import_,    "import"   ); continue; }
-                if(ident == "namespace") { emit(token_type::namespace_, "namespace"); continue; }
-                if(ident == "alias"    ) { emit(token_type::alias,      "alias"    ); continue; }
-                if(ident == "struct"   ) { emit(token_type::struct_,    "struct"   ); continue; }
-                if(ident == "true"     ) { emit(token_type::boolean,    true       ); continue; }
-                if(ident == "false"    ) { emit(token_type::boolean,    false      ); continue; }
-
-                emit(token_type::identifier, ident);
+                if(auto kw = find_keyword(ident))
+                {
+                    if(kw->type == token_type::boolean)
+                    {
+                        emit(token_type::boolean, { .boolean = kw->text == "true" });
+                    }
+                    else
+                    {
+                        emit(kw->type);
+                    }
+                    continue;
+                }
+
+                // Zeroed first so that the unused bytes of the payload stay predictable.
+                token_payload payload = { .integer = 0 };
+                payload.identifier = intern(ident);
+                emit(token_type::identifier, payload);
                 continue;
             }
 
@@ -204,11 +383,11 @@ namespace arc
                 auto number = parse_number();
                 if(number.is_float)
                 {
-                    emit(token_type::float_, number.val_float);
+                    emit(token_type::float_, { .floating = number.val_float });
                 }
                 else
                 {
-                    emit(token_type::integer, number.val_int);
+                    emit(token_type::integer, { .integer = number.val_int });
                 }
                 continue;
             }
@@ -326,9 +505,5 @@ namespace arc
             _errors.push_back(line_exception("unexpected character", _source, cur_pos));
             _stream.next();
         }
-
-        tokens.emplace_back(token_type::eof, "eof", _stream.position());
-
-        return lexer_result(tokens, _errors);
     }
 }
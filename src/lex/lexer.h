@@ -1,10 +1,13 @@
 #pragma once
 
-#include <functional>
+#include <cstdint>
+#include <string_view>
 
 #include "token.h"
+#include "scanner.h"
 #include "../error/exceptions.h"
 #include "../util/source_file.h"
+#include "../util/thread_pool.h"
 
 namespace arc
 {
@@ -12,32 +15,24 @@ namespace arc
     {
     private:
         const char* _buffer;
-        const size_t _size;
+        const size_t _end;
+        const uint32_t _file;
 
         size_t _ptr;
-
-        source_pos _cur_pos;
     public:
-        character_stream(const char* buffer, size_t size)
-            : _buffer(buffer), _size(size), _ptr(0)
+        character_stream(const char* buffer, size_t begin, size_t end, uint32_t file)
+            : _buffer(buffer), _end(end), _file(file), _ptr(begin)
         {
         }
 
         bool has_next() const
         {
-            return _ptr < _size;
+            return _ptr < _end;
         }
 
         char next()
         {
-            _cur_pos.column++;
-            char c = _buffer[_ptr++];
-            if(c == '\n')
-            {
-                _cur_pos.column = 1;
-                _cur_pos.line++;
-            }
-            return c;
+            return _buffer[_ptr++];
         }
 
         char peek(int o = 0) const
@@ -45,9 +40,41 @@ namespace arc
             return _buffer[_ptr + o];
         }
 
+        size_t offset() const
+        {
+            return _ptr;
+        }
+
+        const char* current() const
+        {
+            return _buffer + _ptr;
+        }
+
+        size_t remaining() const
+        {
+            return _end - _ptr;
+        }
+
+        void skip(size_t count)
+        {
+            _ptr += count;
+        }
+
+        void skip_whitespace()
+        {
+            // Most runs are a single space between tokens, which is not worth a vector scan.
+            if(peek() == ' ' && !(_ptr + 1 < _end && (peek(1) == ' ' || peek(1) == '\n' || peek(1) == '\r' || peek(1) == '\t')))
+            {
+                _ptr++;
+                return;
+            }
+
+            _ptr += scan_whitespace(current(), remaining());
+        }
+
         source_pos position() const
         {
-            return _cur_pos;
+            return source_pos { .offset = uint32_t(_ptr), .file = _file };
         }
     };
 
@@ -60,11 +87,11 @@ namespace arc
 
     struct lexer_result
     {
-        const std::vector<token> tokens;
-        const std::vector<line_exception> errors;
+        std::vector<token> tokens;
+        std::vector<line_exception> errors;
 
-        lexer_result(const std::vector<token>& tokens, const std::vector<line_exception> errors)
-            : tokens(tokens), errors(errors)
+        lexer_result(std::vector<token>&& tokens, std::vector<line_exception>&& errors)
+            : tokens(std::move(tokens)), errors(std::move(errors))
         {
         }
 
@@ -81,13 +108,40 @@ namespace arc
         character_stream _stream;
 
         std::vector<line_exception> _errors;
+        bool _finished;
+
+        // A small direct mapped cache of identifiers this lexer has interned, so
+        // that the common ones skip the lock on the shared symbol table.
+        struct cached_symbol
+        {
+            std::string_view text;
+            symbol sym;
+        };
+        std::vector<cached_symbol> _symbols;
     public:
         lexer(const source_file& source);
 
+        // Lexes only the characters in [begin, end), which must not split a token.
+        lexer(const source_file& source, size_t begin, size_t end);
+
         lexer_result lex();
+
+        // Appends up to count more tokens, followed by the eof token once the end
+        // of the input is reached. Returns false if eof was already produced.
+        bool lex_some(std::vector<token>& tokens, size_t count = SIZE_MAX);
+
+        const std::vector<line_exception>& errors() const;
+
+        // Splits the source into chunks at line boundaries and lexes them on the
+        // pool, producing the same result as lex().
+        static lexer_result lex_parallel(const source_file& source, thread_pool& pool, size_t min_chunk_size = 256 * 1024);
     private:
-        std::string parse_identifier();
-        uint64_t parse_number(uint32_t base, std::function<bool(char)> predicate);
+        void lex_tokens(std::vector<token>& tokens, size_t limit = SIZE_MAX);
+
+        std::string_view parse_identifier();
+        symbol intern(std::string_view ident);
+        template<uint32_t Base> uint64_t parse_digits(bool& overflow);
+        template<uint32_t Base> uint64_t parse_prefixed_number();
         lexed_number parse_number();
     };
 }
@@ -0,0 +1,114 @@
+#include "scanner.h"
+
+#include <bit>
+#include <cstdint>
+
+#if defined(__SSE2__)
+    #define ARC_SCANNER_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace
+{
+    bool is_whitespace(char c)
+    {
+        return c == 0x20 || c == 0x0A || c == 0x0D || c == 0x09;
+    }
+
+    bool is_digit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    bool is_ident_char(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || is_digit(c);
+    }
+
+    template<bool(*Predicate)(char)>
+    size_t scan_scalar(const char* data, size_t size, size_t i = 0)
+    {
+        while(i < size && Predicate(data[i]))
+        {
+            i++;
+        }
+        return i;
+    }
+
+#ifdef ARC_SCANNER_SSE2
+    // Offsets the range so that it starts at -128, which lets a single signed
+    // compare check both bounds at once.
+    __m128i range_sse2(__m128i v, char lo, char hi)
+    {
+        auto shifted = _mm_add_epi8(v, _mm_set1_epi8(char(-128 - lo)));
+        return _mm_cmplt_epi8(shifted, _mm_set1_epi8(char(-128 + (hi - lo) + 1)));
+    }
+
+    __m128i whitespace_sse2(__m128i v)
+    {
+        auto a = _mm_cmpeq_epi8(v, _mm_set1_epi8(0x20));
+        auto b = _mm_cmpeq_epi8(v, _mm_set1_epi8(0x0A));
+        auto c = _mm_cmpeq_epi8(v, _mm_set1_epi8(0x0D));
+        auto d = _mm_cmpeq_epi8(v, _mm_set1_epi8(0x09));
+        return _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+    }
+
+    __m128i digits_sse2(__m128i v)
+    {
+        return range_sse2(v, '0', '9');
+    }
+
+    __m128i identifier_sse2(__m128i v)
+    {
+        auto letters = range_sse2(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+        auto underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+        return _mm_or_si128(_mm_or_si128(letters, underscore), digits_sse2(v));
+    }
+
+    template<__m128i(*Classify)(__m128i), bool(*Predicate)(char)>
+    size_t scan_sse2(const char* data, size_t size)
+    {
+        size_t i = 0;
+        for(; i + 16 <= size; i += 16)
+        {
+            auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            auto outside = ~uint32_t(_mm_movemask_epi8(Classify(v))) & 0xFFFF;
+            if(outside != 0)
+            {
+                return i + std::countr_zero(outside);
+            }
+        }
+        return scan_scalar<Predicate>(data, size, i);
+    }
+#endif
+}
+
+namespace arc
+{
+    size_t scan_whitespace(const char* data, size_t size)
+    {
+#ifdef ARC_SCANNER_SSE2
+        return scan_sse2<whitespace_sse2, is_whitespace>(data, size);
+#else
+        return scan_scalar<is_whitespace>(data, size);
+#endif
+    }
+
+    size_t scan_identifier(const char* data, size_t size)
+    {
+#ifdef ARC_SCANNER_SSE2
+        return scan_sse2<identifier_sse2, is_ident_char>(data, size);
+#else
+        return scan_scalar<is_ident_char>(data, size);
+#endif
+    }
+
+    size_t scan_digits(const char* data, size_t size)
+    {
+#ifdef ARC_SCANNER_SSE2
+        return scan_sse2<digits_sse2, is_digit>(data, size);
+#else
+        return scan_scalar<is_digit>(data, size);
+#endif
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+namespace arc
+{
+    // Each scanner returns the length of the longest prefix of [data, data + size)
+    // made up of characters in its class, 16 bytes at a time where SSE2 is
+    // available.
+
+    size_t scan_whitespace(const char* data, size_t size);
+    size_t scan_identifier(const char* data, size_t size);
+    size_t scan_digits(const char* data, size_t size);
+}
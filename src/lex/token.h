@@ -1,8 +1,12 @@
 #pragma once
 
-#include <variant>
+#include <string_view>
+#include <cstdint>
+#include <array>
+#include <initializer_list>
 
 #include "../util/source_file.h"
+#include "../util/symbol.h"
 
 namespace arc
 {
@@ -80,51 +84,171 @@ namespace arc
         eof
     };
 
-    using token_value = std::variant<double, uint64_t, bool, std::string>;
+    // A set of token types as a bitmask, so checking the next token against a
+    // handful of alternatives is a single test. Meant to be built at compile time.
+    class token_set
+    {
+    private:
+        static constexpr size_t word_bits = 64;
+        std::array<uint64_t, (size_t(token_type::eof) + word_bits) / word_bits> _words = {};
+    public:
+        constexpr token_set(std::initializer_list<token_type> types)
+        {
+            for(auto type : types)
+            {
+                _words[size_t(type) / word_bits] |= uint64_t(1) << (size_t(type) % word_bits);
+            }
+        }
+
+        constexpr bool contains(token_type type) const
+        {
+            return (_words[size_t(type) / word_bits] >> (size_t(type) % word_bits)) & 1;
+        }
+
+        constexpr token_set operator|(const token_set& rhs) const
+        {
+            token_set result = *this;
+            for(size_t i = 0; i < _words.size(); i++)
+            {
+                result._words[i] |= rhs._words[i];
+            }
+            return result;
+        }
+    };
+
+    struct keyword
+    {
+        std::string_view text;
+        token_type type;
+    };
+
+    // Every reserved word in the language, this is the only place keywords are listed.
+    constexpr keyword keywords[] = {
+        { "func",      token_type::func       },
+        { "return",    token_type::return_    },
+        { "if",        token_type::if_        },
+        { "elif",      token_type::elif       },
+        { "else",      token_type::else_      },
+        { "as",        token_type::as         },
+        { "let",       token_type::let        },
+        { "const",     token_type::const_     },
+        { "import",    token_type::import_    },
+        { "namespace", token_type::namespace_ },
+        { "alias",     token_type::alias      },
+        { "struct",    token_type::struct_    },
+        { "true",      token_type::boolean    },
+        { "false",     token_type::boolean    }
+    };
+
+    namespace detail
+    {
+        constexpr size_t keyword_slots = 32;
+
+        constexpr size_t keyword_hash(std::string_view text, uint32_t seed)
+        {
+            auto first = uint8_t(text.front());
+            auto last = uint8_t(text.back());
+            return (text.size() + first * seed + ((last * seed) >> 3)) % keyword_slots;
+        }
 
+        struct keyword_table
+        {
+            uint32_t seed = 0;
+            std::array<uint8_t, keyword_slots> slots = {}; // index into keywords + 1, 0 if empty
+        };
+
+        // Searches for a seed that places every keyword in its own slot.
+        constexpr keyword_table make_keyword_table()
+        {
+            for(uint32_t seed = 1; seed < 4096; seed++)
+            {
+                keyword_table table;
+                table.seed = seed;
+
+                bool collision = false;
+                for(size_t i = 0; i < std::size(keywords) && !collision; i++)
+                {
+                    auto& slot = table.slots[keyword_hash(keywords[i].text, seed)];
+                    collision = slot != 0;
+                    slot = uint8_t(i + 1);
+                }
+
+                if(!collision)
+                {
+                    return table;
+                }
+            }
+
+            return keyword_table();
+        }
+
+        constexpr keyword_table keyword_lookup = make_keyword_table();
+        static_assert(keyword_lookup.seed != 0, "no perfect hash exists for the keyword set");
+    }
+
+    // Returns the keyword spelled by text, or nullptr if it is an ordinary identifier.
+    constexpr const keyword* find_keyword(std::string_view text)
+    {
+        if(text.empty())
+        {
+            return nullptr;
+        }
+
+        auto slot = detail::keyword_lookup.slots[detail::keyword_hash(text, detail::keyword_lookup.seed)];
+        if(slot != 0 && keywords[slot - 1].text == text)
+        {
+            return &keywords[slot - 1];
+        }
+        return nullptr;
+    }
+
+    union token_payload
+    {
+        uint64_t integer;
+        double floating;
+        bool boolean;
+        symbol identifier;
+    };
+
+    // Tokens do not own their text, they refer to a span of the source buffer
+    // they were lexed from, and only carry decoded literal values themselves.
     struct token
     {
-        const token_type type;
-        const token_value value;
-        const source_pos position;
+        token_type type;
+        uint32_t length;
+        token_payload payload;
+        source_pos position;
 
-        token(token_type type, token_value value, source_pos position)
-            : type(type), value(value), position(position)
+        token(token_type type, token_payload payload, source_pos position, uint32_t length)
+            : type(type), length(length), payload(payload), position(position)
         {
         }
 
         double val_double() const
         {
-            return std::get<double>(value);
+            return payload.floating;
         }
 
         uint64_t val_integer() const
         {
-            return std::get<uint64_t>(value);
+            return payload.integer;
         }
 
         bool val_boolean() const
         {
-            return std::get<bool>(value);
+            return payload.boolean;
         }
 
-        std::string val_string() const
+        // The empty name for anything but an identifier, which error recovery
+        // can hand out in place of one.
+        symbol val_symbol() const
         {
-            return std::get<std::string>(value);
+            return type == token_type::identifier ? payload.identifier : symbol();
         }
 
-        template<typename T>
-        bool has_type() const
+        std::string_view text(const source_file& source) const
         {
-            try
-            {
-                std::get<T>(value);
-                return true;
-            }
-            catch(const std::bad_variant_access&)
-            {
-                return false;
-            }
+            return source.text(position.offset, length);
         }
     };
 }
@@ -1,13 +1,16 @@
 #include <iostream>
 #include <stack>
 #include <cstring>
+#include <stdexcept>
 
 #include "lex/lexer.h"
 #include "parse/parser.h"
+#include "parse/ast_cache.h"
 #include "check/type_checker.h"
 #include "check/control_analyzer.h"
 #include "util/source_file.h"
 #include "util/casting.h"
+#include "util/thread_pool.h"
 
 #include "test/test_main.h"
 
@@ -15,8 +18,9 @@ static std::string format_error(const arc::line_exception& ex)
 {
 	std::string error = "";
 
-	error += "error: " + ex.error + " at " + std::to_string(ex.position.line) + ":" + std::to_string(ex.position.column) + "\n";
-	error += std::to_string(ex.position.line) + " | " + ex.file.get_line(ex.position.line) + "\n";
+	auto location = ex.file.location(ex.position);
+	error += "error: " + ex.error + " at " + std::to_string(location.line) + ":" + std::to_string(location.column) + "\n";
+	error += std::to_string(location.line) + " | " + std::string(ex.file.get_line(location.line)) + "\n";
 
 	return error;
 }
@@ -134,39 +138,89 @@ public:
 	}
 };
 
-static void process(const arc::source_file& input)
+// Files smaller than this are lexed faster on one thread than it takes to split them up.
+static constexpr size_t parallel_lex_threshold = 1024 * 1024;
+
+// Modules with fewer declarations than this are checked on one thread.
+static constexpr size_t parallel_check_threshold = 256;
+
+static arc::thread_pool& thread_pool()
+{
+	static arc::thread_pool pool;
+	return pool;
+}
+
+static void check(const std::vector<arc::decl*>& decls, const arc::source_file& input, arc::type_interner& types)
+{
+	arc::control_analyzer control_analyzer(decls, input);
+	auto control_analyzer_result = control_analyzer.analyze();
+	if(control_analyzer_result.size() == 0)
+	{
+		arc::type_checker type_checker(decls, input, types);
+		auto type_checker_result = decls.size() >= parallel_check_threshold
+			? type_checker.check(thread_pool())
+			: type_checker.check();
+		if(type_checker_result.size() == 0)
+		{
+		}
+		else
+		{
+			for(const auto& error : type_checker_result)
+			{
+				std::cout << format_error(error);
+			}
+		}
+	}
+	else
+	{
+		for(const auto& error : control_analyzer_result)
+		{
+			std::cout << format_error(error);
+		}
+	}
+}
+
+// With use_cache the ast is loaded from the file's cache when it is up to
+// date, and the cache is written after a clean parse otherwise.
+static void process(const arc::source_file& input, bool use_cache = false)
 {
 	if(input.exists())
 	{
 		try
 		{
-			arc::lexer lexer(input);
-			auto lexer_result = lexer.lex();
+			// Shared by the cache and the checker, so the types they build are
+			// the same objects. Made before the ast so it outlives the types
+			// recorded in it.
+			arc::type_interner types;
+			auto cache_path = arc::ast_cache_path(input);
+			if(use_cache)
+			{
+				if(auto cached = arc::cached_module::load(cache_path, input, types))
+				{
+					check(cached->decls(), input, types);
+					return;
+				}
+			}
+
+			auto lexer_result = input.size() >= parallel_lex_threshold
+				? arc::lexer::lex_parallel(input, thread_pool())
+				: arc::lexer(input).lex();
 			if(lexer_result.succeeded())
 			{
-				arc::parser parser(lexer_result.tokens, input);
+				arc::arena arena;
+				arc::parser parser(lexer_result.tokens, input, arena, arc::parse_mode::recover);
 				auto decls = parser.parse_module();
-
-				arc::control_analyzer control_analyzer(decls, input);
-				auto control_analyzer_result = control_analyzer.analyze();
-				if(control_analyzer_result.size() == 0)
+				if(parser.errors().size() == 0)
 				{
-					arc::type_checker type_checker(decls, input);
-					auto type_checker_result = type_checker.check();
-					if(type_checker_result.size() == 0)
+					check(decls, input, types);
+					if(use_cache && !arc::write_ast_cache(cache_path, input, decls))
 					{
-					}
-					else
-					{
-						for(const auto& error : type_checker_result)
-						{
-							std::cout << format_error(error);
-						}
+						std::cout << "warning: could not write '" << cache_path << "'" << std::endl;
 					}
 				}
 				else
 				{
-					for(const auto& error : control_analyzer_result)
+					for(const auto& error : parser.errors())
 					{
 						std::cout << format_error(error);
 					}
@@ -191,6 +245,53 @@ static void process(const arc::source_file& input)
 	}
 }
 
+// Lexes and parses in one pass without keeping every token of the file in
+// memory. Lexer errors only surface once parsing is done, parse errors are
+// only reported when the lexer had none since they are likely caused by what
+// the lexer skipped.
+static void process_streaming(const arc::source_file& input)
+{
+	if(input.exists())
+	{
+		arc::lexer lexer(input);
+		try
+		{
+			// Outlives the ast and the types recorded in it.
+			arc::type_interner types;
+			arc::arena arena;
+			arc::parser parser(lexer, input, arena, arc::parse_mode::recover);
+			auto decls = parser.parse_module();
+			if(lexer.errors().size() == 0)
+			{
+				if(parser.errors().size() == 0)
+				{
+					check(decls, input, types);
+				}
+				else
+				{
+					for(const auto& error : parser.errors())
+					{
+						std::cout << format_error(error);
+					}
+				}
+			}
+		}
+		catch(const arc::line_exception& ex)
+		{
+			std::cout << format_error(ex);
+		}
+
+		for(const auto& error : lexer.errors())
+		{
+			std::cout << format_error(error);
+		}
+	}
+	else
+	{
+		std::cout << "'" << input.path() << "' not found" << std::endl;
+	}
+}
+
 int main(int argc, const char** argv)
 {
 	if(argc > 1 && std::strcmp(argv[1], "test") == 0)
@@ -198,20 +299,39 @@ int main(int argc, const char** argv)
 		return arc_test_main(argc, argv);
 	}
 
-	if(argc == 2)
+	try
 	{
-		arc::source_file input(argv[1]);
-		process(input);
-	}
-	else
-	{
-		while(true)
+		if(argc == 2)
 		{
-			std::cout << "> ";
-			std::string src;
-			std::getline(std::cin, src);
-			arc::source_file input(src, true);
+			arc::source_file input(argv[1]);
 			process(input);
 		}
+		else if(argc == 3 && std::strcmp(argv[1], "--stream") == 0)
+		{
+			arc::source_file input(argv[2]);
+			process_streaming(input);
+		}
+		else if(argc == 3 && std::strcmp(argv[1], "--cache") == 0)
+		{
+			arc::source_file input(argv[2]);
+			process(input, true);
+		}
+		else
+		{
+			while(true)
+			{
+				std::cout << "> ";
+				std::string src;
+				std::getline(std::cin, src);
+				arc::source_file input(src, true);
+				process(input);
+			}
+		}
+	}
+	catch(const std::length_error& ex)
+	{
+		// Thrown by source_file for inputs too large to take positions in.
+		std::cout << "error: " << ex.what() << std::endl;
+		return 1;
 	}
 }
@@ -1,13 +1,19 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <utility>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 
 #include "../type/types.h"
+#include "../util/arena.h"
 #include "../util/source_file.h"
+#include "../util/symbol.h"
 
 namespace arc
 {
@@ -18,12 +24,14 @@ namespace arc
 	struct typespec_func;
 	struct typespec_name;
 	struct typespec_pointer;
+	struct typespec_error;
 
 	struct decl_import;
 	struct decl_namespace;
 	struct decl_func;
 	struct decl_struct;
 	struct decl_alias;
+	struct decl_error;
 
 	struct stmt_expr;
 	struct stmt_let;
@@ -31,6 +39,7 @@ namespace arc
 	struct stmt_return;
 	struct stmt_if;
 	struct stmt_block;
+	struct stmt_error;
 
 	struct expr_integer;
 	struct expr_boolean;
@@ -41,6 +50,49 @@ namespace arc
 	struct expr_index;
 	struct expr_access;
 	struct expr_cast;
+	struct expr_error;
+
+	//
+	// Node Kinds
+	//
+
+	enum class ast_kind : uint8_t
+	{
+		typespec_func,
+		typespec_name,
+		typespec_pointer,
+		typespec_error,
+
+		decl_import,
+		decl_namespace,
+		decl_func,
+		decl_struct,
+		decl_alias,
+		decl_error,
+
+		stmt_expr,
+		stmt_let,
+		stmt_const,
+		stmt_return,
+		stmt_if,
+		stmt_block,
+		stmt_error,
+
+		expr_integer,
+		expr_boolean,
+		expr_name,
+		expr_binary,
+		expr_unary,
+		expr_call,
+		expr_index,
+		expr_access,
+		expr_cast,
+		expr_error,
+
+		if_branch,
+		func_arg,
+		struct_field
+	};
 
 	//
 	// Visitor Stuff
@@ -51,12 +103,14 @@ namespace arc
 		virtual void visit(const typespec_func&) {}
 		virtual void visit(const typespec_name&) {}
 		virtual void visit(const typespec_pointer&) {}
+		virtual void visit(const typespec_error&) {}
 
 		virtual void visit(const decl_import&) {}
 		virtual void visit(const decl_namespace&) {}
 		virtual void visit(const decl_func&) {}
 		virtual void visit(const decl_struct&) {}
 		virtual void visit(const decl_alias&) {}
+		virtual void visit(const decl_error&) {}
 
 		virtual void visit(const stmt_expr&) {}
 		virtual void visit(const stmt_let&) {}
@@ -64,6 +118,7 @@ namespace arc
 		virtual void visit(const stmt_return&) {}
 		virtual void visit(const stmt_if&) {}
 		virtual void visit(const stmt_block&) {}
+		virtual void visit(const stmt_error&) {}
 
 		virtual void visit(const expr_integer&) {}
 		virtual void visit(const expr_boolean&) {}
@@ -74,18 +129,24 @@ namespace arc
 		virtual void visit(const expr_index&) {}
 		virtual void visit(const expr_access&) {}
 		virtual void visit(const expr_cast&) {}
+		virtual void visit(const expr_error&) {}
 	};
 
 	struct ast_node
 	{
-        const source_pos position;
+		// Not const so an incremental reparse can move the nodes after an edit.
+		source_pos position;
+		// Which node this is, see casting.h for isa, cast and dyn_cast.
+		const ast_kind kind;
 
-		ast_node(source_pos position)
-			: position(position)
+		ast_node(ast_kind kind, source_pos position)
+			: position(position), kind(kind)
 		{
 		}
 
-		virtual ~ast_node() = default;
+		// Nodes are owned by an arena and never deleted through a base pointer,
+		// so there is no virtual destructor. Most nodes are trivially destructible
+		// and the arena can drop them without visiting each one.
 		virtual void accept(ast_visitor&) const = 0;
 	};
 
@@ -95,14 +156,20 @@ namespace arc
 
 	struct typespec : public ast_node
 	{
-		typespec(source_pos position)
-			: ast_node(position)
+		typespec(ast_kind kind, source_pos position)
+			: ast_node(kind, position)
 		{
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind >= ast_kind::typespec_func && node->kind <= ast_kind::typespec_error;
+		}
+
+		// equals is only called once the kinds are known to match.
 		bool operator==(const typespec& rhs)
 		{
-			if(typeid(*this) != typeid(rhs)) { return false; }
+			if(kind != rhs.kind) { return false; }
 			return equals(rhs);
 		}
 
@@ -117,22 +184,27 @@ namespace arc
 
 	struct typespec_name : public typespec
 	{
-		const std::string name;
+		const std::string_view name;
 
-		typespec_name(const std::string& name, source_pos position)
-			: name(name), typespec(position)
+		typespec_name(std::string_view name, source_pos position)
+			: name(name), typespec(ast_kind::typespec_name, position)
 		{
 		}
 
 		bool equals(const typespec& rhs) const
 		{
-			const typespec_name& r = dynamic_cast<const typespec_name&>(rhs);
+			const typespec_name& r = static_cast<const typespec_name&>(rhs);
 			return this->name == r.name;
 		}
 
 		size_t hash() const
 		{
-			return std::hash<std::string>()(name);
+			return std::hash<std::string_view>()(name);
+		}
+
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::typespec_name;
 		}
 
 		void accept(ast_visitor& v) const { v.visit(*this); }
@@ -140,22 +212,28 @@ namespace arc
 
 	struct typespec_pointer : public typespec
 	{
-		const std::shared_ptr<typespec> base;
+		typespec* const base;
 
-		typespec_pointer(const std::shared_ptr<typespec>& base, source_pos position)
-			: base(base), typespec(position)
+		typespec_pointer(typespec* base, source_pos position)
+			: base(base), typespec(ast_kind::typespec_pointer, position)
 		{
 		}
 
 		bool equals(const typespec& rhs) const
 		{
-			const typespec_pointer& r = dynamic_cast<const typespec_pointer&>(rhs);
+			const typespec_pointer& r = static_cast<const typespec_pointer&>(rhs);
 			return *this->base == *r.base;
 		}
 
 		size_t hash() const
 		{
-			return 217 + this->base->hash();
+			size_t h = this->base->hash();
+			return h ^ (0x9e3779b97f4a7c15 + (h << 6) + (h >> 2));
+		}
+
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::typespec_pointer;
 		}
 
 		void accept(ast_visitor& v) const { v.visit(*this); }
@@ -163,17 +241,17 @@ namespace arc
 
 	struct typespec_func : public typespec
 	{
-		const std::vector<std::shared_ptr<typespec>> argument_types;
-		const std::shared_ptr<typespec> return_type;
+		const std::span<typespec* const> argument_types;
+		typespec* const return_type;
 
-		typespec_func(const std::vector<std::shared_ptr<typespec>>& argument_types, const std::shared_ptr<typespec>& return_type, source_pos position)
-			: argument_types(argument_types), return_type(return_type), typespec(position)
+		typespec_func(std::span<typespec* const> argument_types, typespec* return_type, source_pos position)
+			: argument_types(argument_types), return_type(return_type), typespec(ast_kind::typespec_func, position)
 		{
 		}
 
 		bool equals(const typespec& rhs) const
 		{
-			const typespec_func& r = dynamic_cast<const typespec_func&>(rhs);
+			const typespec_func& r = static_cast<const typespec_func&>(rhs);
 
 			if(*this->return_type != *r.return_type) { return false; }
 			if(this->argument_types.size() != r.argument_types.size()) { return false; }
@@ -197,6 +275,37 @@ namespace arc
 			return h;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::typespec_func;
+		}
+
+		void accept(ast_visitor& v) const { v.visit(*this); }
+	};
+
+	// Stands in for a type that failed to parse.
+	struct typespec_error : public typespec
+	{
+		typespec_error(source_pos position)
+			: typespec(ast_kind::typespec_error, position)
+		{
+		}
+
+		bool equals(const typespec&) const
+		{
+			return true;
+		}
+
+		size_t hash() const
+		{
+			return 0;
+		}
+
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::typespec_error;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
@@ -206,14 +315,20 @@ namespace arc
 
 	struct expr : public ast_node
 	{
-		expr(source_pos position)
-			: ast_node(position)
+		expr(ast_kind kind, source_pos position)
+			: ast_node(kind, position)
 		{
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind >= ast_kind::expr_integer && node->kind <= ast_kind::expr_error;
+		}
+
+		// equals is only called once the kinds are known to match.
 		bool operator==(const expr& rhs)
 		{
-			if(typeid(*this) != typeid(rhs)) { return false; }
+			if(kind != rhs.kind) { return false; }
 			return equals(rhs);
 		}
 
@@ -230,16 +345,21 @@ namespace arc
 		const uint64_t value;
 
 		expr_integer(uint64_t value, source_pos position)
-			: value(value), expr(position)
+			: value(value), expr(ast_kind::expr_integer, position)
 		{
 		}
 
 		bool equals(const expr& rhs) const
 		{
-			const expr_integer& r = dynamic_cast<const expr_integer&>(rhs);
+			const expr_integer& r = static_cast<const expr_integer&>(rhs);
 			return this->value == r.value;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::expr_integer;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
@@ -248,34 +368,45 @@ namespace arc
 		const bool value;
 
 		expr_boolean(bool value, source_pos position)
-			: value(value), expr(position)
+			: value(value), expr(ast_kind::expr_boolean, position)
 		{
 		}
 		
 		bool equals(const expr& rhs) const
 		{
-			const expr_boolean& r = dynamic_cast<const expr_boolean&>(rhs);
+			const expr_boolean& r = static_cast<const expr_boolean&>(rhs);
 			return this->value == r.value;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::expr_boolean;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
 	struct expr_name : public expr
 	{
-		const std::string name;
+		const std::string_view name;
+		const symbol name_symbol;
 
-		expr_name(const std::string& name, source_pos position)
-			: name(name), expr(position)
+		expr_name(std::string_view name, symbol name_symbol, source_pos position)
+			: name(name), name_symbol(name_symbol), expr(ast_kind::expr_name, position)
 		{
 		}
 
 		bool equals(const expr& rhs) const
 		{
-			const expr_name& r = dynamic_cast<const expr_name&>(rhs);
+			const expr_name& r = static_cast<const expr_name&>(rhs);
 			return this->name == r.name;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::expr_name;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
@@ -315,20 +446,25 @@ namespace arc
 	struct expr_binary : public expr
 	{
 		const binary_op op;
-		const std::shared_ptr<expr> lhs;
-		const std::shared_ptr<expr> rhs;
+		expr* const lhs;
+		expr* const rhs;
 
-		expr_binary(binary_op op, const std::shared_ptr<expr>& lhs, const std::shared_ptr<expr>& rhs, source_pos position)
-			: op(op), lhs(lhs), rhs(rhs), expr(position)
+		expr_binary(binary_op op, expr* lhs, expr* rhs, source_pos position)
+			: op(op), lhs(lhs), rhs(rhs), expr(ast_kind::expr_binary, position)
 		{
 		}
 
 		bool equals(const expr& rhs) const
 		{
-			const expr_binary& r = dynamic_cast<const expr_binary&>(rhs);
+			const expr_binary& r = static_cast<const expr_binary&>(rhs);
 			return this->op == r.op && *this->lhs == *r.lhs && *this->rhs == *r.rhs;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::expr_binary;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
@@ -349,35 +485,40 @@ namespace arc
 	struct expr_unary : public expr
 	{
 		const unary_op op;
-		const std::shared_ptr<expr> rhs;
+		expr* const rhs;
 
-		expr_unary(unary_op op, const std::shared_ptr<expr>& rhs, source_pos position)
-			: op(op), rhs(rhs), expr(position)
+		expr_unary(unary_op op, expr* rhs, source_pos position)
+			: op(op), rhs(rhs), expr(ast_kind::expr_unary, position)
 		{
 		}
 
 		bool equals(const expr& rhs) const
 		{
-			const expr_unary& r = dynamic_cast<const expr_unary&>(rhs);
+			const expr_unary& r = static_cast<const expr_unary&>(rhs);
 			return this->op == r.op && *this->rhs == *r.rhs;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::expr_unary;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
 	struct expr_call : public expr
 	{
-		const std::shared_ptr<expr> lhs;
-		const std::vector<std::shared_ptr<expr>> args;
+		expr* const lhs;
+		const std::span<expr* const> args;
 
-		expr_call(const std::shared_ptr<expr>& lhs, const std::vector<std::shared_ptr<expr>>& args, source_pos position)
-			: lhs(lhs), args(args), expr(position)
+		expr_call(expr* lhs, std::span<expr* const> args, source_pos position)
+			: lhs(lhs), args(args), expr(ast_kind::expr_call, position)
 		{
 		}
 
 		bool equals(const expr& rhs) const
 		{
-			const expr_call& r = dynamic_cast<const expr_call&>(rhs);
+			const expr_call& r = static_cast<const expr_call&>(rhs);
 			
 			if(*this->lhs != *r.lhs) { return false; }
 			if(this->args.size() != r.args.size()) { return false; }
@@ -390,68 +531,109 @@ namespace arc
 			return true;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::expr_call;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
 	struct expr_index : public expr
 	{
-		const std::shared_ptr<expr> lhs;
-		const std::shared_ptr<expr> index;
+		expr* const lhs;
+		expr* const index;
 
-		expr_index(const std::shared_ptr<expr>& lhs, const std::shared_ptr<expr>& index, source_pos position)
-			: lhs(lhs), index(index), expr(position)
+		expr_index(expr* lhs, expr* index, source_pos position)
+			: lhs(lhs), index(index), expr(ast_kind::expr_index, position)
 		{
 		}
 
 		bool equals(const expr& rhs) const
 		{
-			const expr_index& r = dynamic_cast<const expr_index&>(rhs);
+			const expr_index& r = static_cast<const expr_index&>(rhs);
 			return *this->lhs == *r.lhs && *this->index == *r.index;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::expr_index;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
 	struct expr_access : public expr
 	{
-		const std::shared_ptr<expr> lhs;
-		const std::string field;
+		expr* const lhs;
+		const std::string_view field;
 
-		expr_access(const std::shared_ptr<expr>& lhs, const std::string& field, source_pos position)
-			: lhs(lhs), field(field), expr(position)
+		expr_access(expr* lhs, std::string_view field, source_pos position)
+			: lhs(lhs), field(field), expr(ast_kind::expr_access, position)
 		{
 		}
 
 		bool equals(const expr& rhs) const
 		{
-			const expr_access& r = dynamic_cast<const expr_access&>(rhs);
+			const expr_access& r = static_cast<const expr_access&>(rhs);
 			return *this->lhs == *r.lhs && this->field == r.field;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::expr_access;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
 	struct expr_cast : public expr
 	{
-		const std::shared_ptr<expr> lhs;
-		const std::shared_ptr<typespec> to_type;
+		expr* const lhs;
+		typespec* const to_type;
 
 		struct
 		{
 			std::shared_ptr<type> to_type = nullptr;
 		} types;
 
-		expr_cast(const std::shared_ptr<expr>& lhs, const std::shared_ptr<typespec>& to_type, source_pos position)
-			: lhs(lhs), to_type(to_type), expr(position)
+		expr_cast(expr* lhs, typespec* to_type, source_pos position)
+			: lhs(lhs), to_type(to_type), expr(ast_kind::expr_cast, position)
 		{
 		}
 
 		bool equals(const expr& rhs) const
 		{
-			const expr_cast& r = dynamic_cast<const expr_cast&>(rhs);
+			const expr_cast& r = static_cast<const expr_cast&>(rhs);
 			return *this->lhs == *r.lhs && *this->to_type == *r.to_type;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::expr_cast;
+		}
+
+		void accept(ast_visitor& v) const { v.visit(*this); }
+	};
+
+	// Stands in for an expression that failed to parse.
+	struct expr_error : public expr
+	{
+		expr_error(source_pos position)
+			: expr(ast_kind::expr_error, position)
+		{
+		}
+
+		bool equals(const expr&) const
+		{
+			return true;
+		}
+
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::expr_error;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
@@ -461,14 +643,20 @@ namespace arc
 
 	struct stmt : public ast_node
 	{
-		stmt(source_pos position)
-			: ast_node(position)
+		stmt(ast_kind kind, source_pos position)
+			: ast_node(kind, position)
+		{
+		}
+
+		static bool classof(const ast_node* node)
 		{
+			return node->kind >= ast_kind::stmt_expr && node->kind <= ast_kind::stmt_error;
 		}
 
+		// equals is only called once the kinds are known to match.
 		bool operator==(const stmt& rhs)
 		{
-			if(typeid(*this) != typeid(rhs)) { return false; }
+			if(kind != rhs.kind) { return false; }
 			return equals(rhs);
 		}
 
@@ -482,41 +670,47 @@ namespace arc
 
 	struct stmt_expr : public stmt
 	{
-		const std::shared_ptr<expr> expression;
+		expr* const expression;
 
-		stmt_expr(const std::shared_ptr<expr>& expression, source_pos position)
-			: expression(expression), stmt(position)
+		stmt_expr(expr* expression, source_pos position)
+			: expression(expression), stmt(ast_kind::stmt_expr, position)
 		{
 		}
 
 		bool equals(const stmt& rhs) const
 		{
-			const stmt_expr& r = dynamic_cast<const stmt_expr&>(rhs);
+			const stmt_expr& r = static_cast<const stmt_expr&>(rhs);
 			return *this->expression == *r.expression;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::stmt_expr;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
 	struct stmt_let : public stmt
 	{
-		const std::string name;
-		const std::shared_ptr<typespec> type;
-		const std::shared_ptr<expr> initializer;
+		const std::string_view name;
+		const symbol name_symbol;
+		typespec* const type;
+		expr* const initializer;
 
 		struct
 		{
 			std::shared_ptr<arc::type> deduced_type = nullptr;
 		} types;
 
-		stmt_let(const std::string& name, const std::shared_ptr<typespec>& type, const std::shared_ptr<expr>& initializer, source_pos position)
-			: name(name), type(type), initializer(initializer), stmt(position)
+		stmt_let(std::string_view name, symbol name_symbol, typespec* type, expr* initializer, source_pos position)
+			: name(name), name_symbol(name_symbol), type(type), initializer(initializer), stmt(ast_kind::stmt_let, position)
 		{
 		}
 
 		bool equals(const stmt& rhs) const
 		{
-			const stmt_let& r = dynamic_cast<const stmt_let&>(rhs);
+			const stmt_let& r = static_cast<const stmt_let&>(rhs);
 
 			if(this->name != r.name) { return false; }
 
@@ -541,28 +735,34 @@ namespace arc
 			return true;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::stmt_let;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
 	struct stmt_const : public stmt
 	{
-		const std::string name;
-		const std::shared_ptr<typespec> type;
-		const std::shared_ptr<expr> initializer;
+		const std::string_view name;
+		const symbol name_symbol;
+		typespec* const type;
+		expr* const initializer;
 
 		struct
 		{
 			std::shared_ptr<arc::type> deduced_type;
 		} types;
 
-		stmt_const(const std::string& name, const std::shared_ptr<typespec>& type, const std::shared_ptr<expr>& initializer, source_pos position)
-			: name(name), type(type), initializer(initializer), stmt(position)
+		stmt_const(std::string_view name, symbol name_symbol, typespec* type, expr* initializer, source_pos position)
+			: name(name), name_symbol(name_symbol), type(type), initializer(initializer), stmt(ast_kind::stmt_const, position)
 		{
 		}
 
 		bool equals(const stmt& rhs) const
 		{
-			const stmt_const& r = dynamic_cast<const stmt_const&>(rhs);
+			const stmt_const& r = static_cast<const stmt_const&>(rhs);
 			
 			if(this->name != r.name) { return false; }
 
@@ -587,21 +787,26 @@ namespace arc
 			return true;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::stmt_const;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
 	struct stmt_return : public stmt
 	{
-		const std::shared_ptr<expr> expression;
+		expr* const expression;
 
-		stmt_return(const std::shared_ptr<expr>& expression, source_pos position)
-			: expression(expression), stmt(position)
+		stmt_return(expr* expression, source_pos position)
+			: expression(expression), stmt(ast_kind::stmt_return, position)
 		{
 		}
 
 		bool equals(const stmt& rhs) const
 		{
-			const stmt_return& r = dynamic_cast<const stmt_return&>(rhs);
+			const stmt_return& r = static_cast<const stmt_return&>(rhs);
 
 			if(this->expression != nullptr && r.expression != nullptr)
 			{
@@ -615,15 +820,20 @@ namespace arc
 			return true;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::stmt_return;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
 	struct if_branch
 	{
-		const std::shared_ptr<expr> condition;
-		const std::vector<std::shared_ptr<stmt>> body;
+		expr* const condition;
+		const std::span<stmt* const> body;
 
-		if_branch(const std::shared_ptr<expr> condition, const std::vector<std::shared_ptr<stmt>> body)
+		if_branch(expr* condition, std::span<stmt* const> body)
 			: condition(condition), body(body)
 		{
 		}
@@ -645,17 +855,17 @@ namespace arc
 
 	struct stmt_if : public stmt
 	{
-		const std::vector<if_branch> if_branches;
-		const std::vector<std::shared_ptr<stmt>> else_branch;
+		const std::span<const if_branch> if_branches;
+		const std::span<stmt* const> else_branch;
 
-		stmt_if(const std::vector<if_branch>& if_branches, const std::vector<std::shared_ptr<stmt>>& else_branch, source_pos position)
-			: if_branches(if_branches), else_branch(else_branch), stmt(position)
+		stmt_if(std::span<const if_branch> if_branches, std::span<stmt* const> else_branch, source_pos position)
+			: if_branches(if_branches), else_branch(else_branch), stmt(ast_kind::stmt_if, position)
 		{
 		}
 		
 		bool equals(const stmt& rhs) const
 		{
-			const stmt_if& r = dynamic_cast<const stmt_if&>(rhs);
+			const stmt_if& r = static_cast<const stmt_if&>(rhs);
 
 			if(this->if_branches.size() != r.if_branches.size()) { return false; }
 			if(this->else_branch.size() != r.else_branch.size()) { return false; }
@@ -673,21 +883,26 @@ namespace arc
 			return true;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::stmt_if;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
 	struct stmt_block : public stmt
 	{
-		const std::vector<std::shared_ptr<stmt>> block;
+		const std::span<stmt* const> block;
 
-		stmt_block(const std::vector<std::shared_ptr<stmt>>& block, source_pos position)
-			: block(block), stmt(position)
+		stmt_block(std::span<stmt* const> block, source_pos position)
+			: block(block), stmt(ast_kind::stmt_block, position)
 		{
 		}
 		
 		bool equals(const stmt& rhs) const
 		{
-			const stmt_block& r = dynamic_cast<const stmt_block&>(rhs);
+			const stmt_block& r = static_cast<const stmt_block&>(rhs);
 
 			if(this->block.size() != r.block.size()) { return false; }
 
@@ -699,6 +914,32 @@ namespace arc
 			return true;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::stmt_block;
+		}
+
+		void accept(ast_visitor& v) const { v.visit(*this); }
+	};
+
+	// Stands in for a statement that failed to parse.
+	struct stmt_error : public stmt
+	{
+		stmt_error(source_pos position)
+			: stmt(ast_kind::stmt_error, position)
+		{
+		}
+
+		bool equals(const stmt&) const
+		{
+			return true;
+		}
+
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::stmt_error;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 	
@@ -708,14 +949,20 @@ namespace arc
 
 	struct decl : public ast_node
 	{
-		decl(source_pos position)
-			: ast_node(position)
+		decl(ast_kind kind, source_pos position)
+			: ast_node(kind, position)
+		{
+		}
+
+		static bool classof(const ast_node* node)
 		{
+			return node->kind >= ast_kind::decl_import && node->kind <= ast_kind::decl_error;
 		}
 
+		// equals is only called once the kinds are known to match.
 		bool operator==(const decl& rhs)
 		{
-			if(typeid(*this) != typeid(rhs)) { return false; }
+			if(kind != rhs.kind) { return false; }
 			return equals(rhs);
 		}
 
@@ -729,52 +976,65 @@ namespace arc
 
 	struct decl_import : public decl
 	{
-		const std::string path;
+		const std::string_view path;
 
-		decl_import(const std::string& path, source_pos position)
-			: path(path), decl(position)
+		decl_import(std::string_view path, source_pos position)
+			: path(path), decl(ast_kind::decl_import, position)
 		{
 		}
 
 		bool equals(const decl& rhs) const
 		{
-			const decl_import& r = dynamic_cast<const decl_import&>(rhs);
+			const decl_import& r = static_cast<const decl_import&>(rhs);
 			return this->path == r.path;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::decl_import;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
 	struct decl_namespace : public decl
 	{
-		const std::string name;
+		const std::string_view name;
 
-		decl_namespace(const std::string& name, source_pos position)
-			: name(name), decl(position)
+		decl_namespace(std::string_view name, source_pos position)
+			: name(name), decl(ast_kind::decl_namespace, position)
 		{
 		}
 
 		bool equals(const decl& rhs) const
 		{
-			const decl_namespace& r = dynamic_cast<const decl_namespace&>(rhs);
+			const decl_namespace& r = static_cast<const decl_namespace&>(rhs);
 			return this->name == r.name;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::decl_namespace;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
 	struct func_arg
 	{
-		const std::string name;
-		const std::shared_ptr<typespec> type;
+		const std::string_view name;
+		const symbol name_symbol;
+		typespec* const type;
 
-		struct
+		// Filled in by the type checker. Arguments are stored const in their
+		// decl_func, so this is the one part of them that changes later.
+		mutable struct
 		{
 			std::shared_ptr<arc::type> type = nullptr;
 		} types;
 
-		func_arg(const std::string& name, const std::shared_ptr<typespec>& type)
-			: name(name), type(type)
+		func_arg(std::string_view name, symbol name_symbol, typespec* type)
+			: name(name), name_symbol(name_symbol), type(type)
 		{
 		}
 
@@ -784,60 +1044,113 @@ namespace arc
 		}
 	};
 
+	// Parses the function bodies a lazy parse skipped over, see deferred_bodies.
+	class body_parser
+	{
+	public:
+		virtual void parse_body(const decl_func& func) = 0;
+	};
+
 	struct decl_func : public decl
 	{
-		const std::string name;
-		const std::vector<func_arg> arguments;
-		const std::shared_ptr<typespec> ret_type;
-		const std::vector<std::shared_ptr<stmt>> body;
+		const std::string_view name;
+		const std::span<const func_arg> arguments;
+		typespec* const ret_type;
+
+		// The tokens of a body that hasn't been parsed yet, braces included.
+		const uint32_t body_begin;
+		const uint32_t body_end;
 
 		struct
 		{
 			std::shared_ptr<arc::type> ret_type = nullptr;
 		} types;
+	private:
+		mutable std::span<stmt* const> _body;
+		mutable std::atomic<body_parser*> _body_parser;
+	public:
+		decl_func(
+			std::string_view name,
+			std::span<const func_arg> arguments,
+			typespec* ret_type,
+			std::span<stmt* const> body,
+			source_pos position
+		) : name(name), arguments(arguments), ret_type(ret_type), body_begin(0), body_end(0), _body(body), _body_parser(nullptr), decl(ast_kind::decl_func, position)
+		{
+		}
 
+		// A function whose body is parsed by body_parser when first asked for.
 		decl_func(
-			const std::string& name,
-			const std::vector<func_arg>& arguments,
-			const std::shared_ptr<typespec>& ret_type,
-			const std::vector<std::shared_ptr<stmt>>& body,
+			std::string_view name,
+			std::span<const func_arg> arguments,
+			typespec* ret_type,
+			body_parser* body_parser,
+			uint32_t body_begin,
+			uint32_t body_end,
 			source_pos position
-		) : name(name), arguments(arguments), ret_type(ret_type), body(body), decl(position)
+		) : name(name), arguments(arguments), ret_type(ret_type), body_begin(body_begin), body_end(body_end), _body_parser(body_parser), decl(ast_kind::decl_func, position)
+		{
+		}
+
+		// Parses the body first if it was skipped, safe to call from several threads.
+		std::span<stmt* const> body() const
+		{
+			if(auto parser = _body_parser.load(std::memory_order_acquire))
+			{
+				parser->parse_body(*this);
+			}
+			return _body;
+		}
+
+		bool body_parsed() const
 		{
+			return _body_parser.load(std::memory_order_acquire) == nullptr;
+		}
+
+		// Called by the body_parser once it's done.
+		void resolve_body(std::span<stmt* const> body) const
+		{
+			_body = body;
+			_body_parser.store(nullptr, std::memory_order_release);
 		}
 
 		bool equals(const decl& rhs) const
 		{
-			const decl_func& r = dynamic_cast<const decl_func&>(rhs);
+			const decl_func& r = static_cast<const decl_func&>(rhs);
 
 			if(this->name != r.name) { return false; }
 		
 			if(this->arguments.size() != r.arguments.size()) { return false; }
 
-			if(this->body.size() != r.body.size()) { return false; }
+			if(this->body().size() != r.body().size()) { return false; }
 
 			for(int i = 0; i < this->arguments.size(); i++)
 			{
 				if(!this->arguments[i].equals(r.arguments[i])) { return false; }
 			}
 			
-			for(int i = 0; i < this->body.size(); i++)
+			for(int i = 0; i < this->body().size(); i++)
 			{
-				if(*this->body[i] != *r.body[i]) { return false; }
+				if(*this->body()[i] != *r.body()[i]) { return false; }
 			}
 
 			return true;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::decl_func;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
 	struct struct_field
 	{
-		const std::string name;
-		const std::shared_ptr<typespec> type;
+		const std::string_view name;
+		typespec* const type;
 
-		struct_field(const std::string& name, const std::shared_ptr<typespec>& type)
+		struct_field(std::string_view name, typespec* type)
 			: name(name), type(type)
 		{
 		}
@@ -850,18 +1163,18 @@ namespace arc
 
 	struct decl_struct : public decl
 	{
-		const std::string name;
-		const std::vector<struct_field> fields;
-		const std::vector<std::shared_ptr<decl_func>> functions;
+		const std::string_view name;
+		const std::span<const struct_field> fields;
+		const std::span<decl_func* const> functions;
 
-		decl_struct(const std::string& name, const std::vector<struct_field>& fields, const std::vector<std::shared_ptr<decl_func>>& functions, source_pos position)
-			: name(name), fields(fields), functions(functions), decl(position)
+		decl_struct(std::string_view name, std::span<const struct_field> fields, std::span<decl_func* const> functions, source_pos position)
+			: name(name), fields(fields), functions(functions), decl(ast_kind::decl_struct, position)
 		{
 		}
 
 		bool equals(const decl& rhs) const
 		{
-			const decl_struct& r = dynamic_cast<const decl_struct&>(rhs);
+			const decl_struct& r = static_cast<const decl_struct&>(rhs);
 
 			if(this->name != r.name) { return false; }
 
@@ -882,144 +1195,224 @@ namespace arc
 			return true;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::decl_struct;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
 	struct decl_alias : public decl
 	{
-		const std::string name;
-		const std::shared_ptr<typespec> type;
+		const std::string_view name;
+		typespec* const type;
 
-		decl_alias(const std::string& name, const std::shared_ptr<typespec>& type, source_pos position)
-			: name(name), type(type), decl(position)
+		decl_alias(std::string_view name, typespec* type, source_pos position)
+			: name(name), type(type), decl(ast_kind::decl_alias, position)
 		{
 		}
 
 		bool equals(const decl& rhs) const
 		{
-			const decl_alias& r = dynamic_cast<const decl_alias&>(rhs);
+			const decl_alias& r = static_cast<const decl_alias&>(rhs);
 			return this->name == r.name && *this->type == *r.type;
 		}
 
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::decl_alias;
+		}
+
+		void accept(ast_visitor& v) const { v.visit(*this); }
+	};
+
+	// Stands in for a declaration that failed to parse.
+	struct decl_error : public decl
+	{
+		decl_error(source_pos position)
+			: decl(ast_kind::decl_error, position)
+		{
+		}
+
+		bool equals(const decl&) const
+		{
+			return true;
+		}
+
+		static bool classof(const ast_node* node)
+		{
+			return node->kind == ast_kind::decl_error;
+		}
+
 		void accept(ast_visitor& v) const { v.visit(*this); }
 	};
 
 	//
 	// Utilities
 	//
+	// Nodes are allocated in the arena passed in, and names and lists are copied
+	// into it, so the resulting tree lives exactly as long as the arena. Names
+	// are interned here unless the lexer's symbol is passed in.
+	//
+
+	static auto inline make_integer_expr(arena& arena, uint64_t value, source_pos position = source_pos())
+	{
+		return arena.make<expr_integer>(value, position);
+	}
 
-	static auto inline make_integer_expr(uint64_t value, source_pos position = source_pos())
+	static auto inline make_boolean_expr(arena& arena, bool value, source_pos position = source_pos())
 	{
-		return std::shared_ptr<expr_integer>(new expr_integer(value, position));
+		return arena.make<expr_boolean>(value, position);
 	}
 
-	static auto inline make_boolean_expr(bool value, source_pos position = source_pos())
+	static auto inline make_name_expr(arena& arena, std::string_view name, symbol name_symbol, source_pos position = source_pos())
 	{
-		return std::shared_ptr<expr_boolean>(new expr_boolean(value, position));
+		return arena.make<expr_name>(arena.copy(name), name_symbol, position);
 	}
 
-	static auto inline make_name_expr(const std::string& name, source_pos position = source_pos())
+	static auto inline make_name_expr(arena& arena, std::string_view name, source_pos position = source_pos())
 	{
-		return std::shared_ptr<expr_name>(new expr_name(name, position));
+		return make_name_expr(arena, name, symbol::intern(name), position);
 	}
 
-	static auto inline make_binary_expr(binary_op op, const std::shared_ptr<expr>& lhs, const std::shared_ptr<expr>& rhs, source_pos position = source_pos())
+	static auto inline make_binary_expr(arena& arena, binary_op op, expr* lhs, expr* rhs, source_pos position = source_pos())
 	{
-		return std::shared_ptr<expr_binary>(new expr_binary(op, lhs, rhs, position));
+		return arena.make<expr_binary>(op, lhs, rhs, position);
 	}
 
-	static auto inline make_unary_expr(unary_op op, const std::shared_ptr<expr>& rhs, source_pos position = source_pos())
+	static auto inline make_unary_expr(arena& arena, unary_op op, expr* rhs, source_pos position = source_pos())
 	{
-		return std::shared_ptr<expr_unary>(new expr_unary(op, rhs, position));
+		return arena.make<expr_unary>(op, rhs, position);
 	}
 
-	static auto inline make_call_expr(const std::shared_ptr<expr>& lhs, const std::vector<std::shared_ptr<expr>>& args, source_pos position = source_pos())
+	static auto inline make_call_expr(arena& arena, expr* lhs, const std::vector<expr*>& args, source_pos position = source_pos())
 	{
-		return std::shared_ptr<expr_call>(new expr_call(lhs, args, position));
+		return arena.make<expr_call>(lhs, arena.copy(args), position);
 	}
 
-	static auto inline make_index_expr(const std::shared_ptr<expr>& lhs, const std::shared_ptr<expr>& index, source_pos position = source_pos())
+	static auto inline make_index_expr(arena& arena, expr* lhs, expr* index, source_pos position = source_pos())
 	{
-		return std::shared_ptr<expr_index>(new expr_index(lhs, index, position));
+		return arena.make<expr_index>(lhs, index, position);
 	}
 
-	static auto inline make_access_expr(const std::shared_ptr<expr>& lhs, const std::string& field, source_pos position = source_pos())
+	static auto inline make_access_expr(arena& arena, expr* lhs, std::string_view field, source_pos position = source_pos())
 	{
-		return std::shared_ptr<expr_access>(new expr_access(lhs, field, position));
+		return arena.make<expr_access>(lhs, arena.copy(field), position);
 	}
 
-	static auto make_cast_expr(const std::shared_ptr<expr>& lhs, const std::shared_ptr<typespec>& to_type, source_pos position = source_pos())
+	static auto make_cast_expr(arena& arena, expr* lhs, typespec* to_type, source_pos position = source_pos())
 	{
-		return std::shared_ptr<expr_cast>(new expr_cast(lhs, to_type, position));
+		return arena.make<expr_cast>(lhs, to_type, position);
 	}
 
-	static auto inline make_name_typespec(const std::string& name, source_pos position = source_pos())
+	static auto inline make_error_expr(arena& arena, source_pos position = source_pos())
 	{
-		return std::shared_ptr<typespec_name>(new typespec_name(name, position));
+		return arena.make<expr_error>(position);
 	}
 
-	static auto inline make_pointer_typespec(const std::shared_ptr<typespec>& base, source_pos position = source_pos())
+	static auto inline make_name_typespec(arena& arena, std::string_view name, source_pos position = source_pos())
 	{
-		return std::shared_ptr<typespec_pointer>(new typespec_pointer(base, position));
+		return arena.make<typespec_name>(arena.copy(name), position);
 	}
 
-	static auto inline make_func_typespec(const std::vector<std::shared_ptr<typespec>>& argument_types, const std::shared_ptr<typespec>& return_type, source_pos position = source_pos())
+	static auto inline make_pointer_typespec(arena& arena, typespec* base, source_pos position = source_pos())
 	{
-		return std::shared_ptr<typespec_func>(new typespec_func(argument_types, return_type, position));
+		return arena.make<typespec_pointer>(base, position);
 	}
 
-	static auto inline make_expr_stmt(const std::shared_ptr<expr>& expression, source_pos position = source_pos())
+	static auto inline make_func_typespec(arena& arena, const std::vector<typespec*>& argument_types, typespec* return_type, source_pos position = source_pos())
 	{
-		return std::shared_ptr<stmt_expr>(new stmt_expr(expression, position));
+		return arena.make<typespec_func>(arena.copy(argument_types), return_type, position);
 	}
 
-	static auto inline make_let_stmt(const std::string& name, const std::shared_ptr<typespec>& type, const std::shared_ptr<expr>& initializer, source_pos position = source_pos())
+	static auto inline make_error_typespec(arena& arena, source_pos position = source_pos())
 	{
-		return std::shared_ptr<stmt_let>(new stmt_let(name, type, initializer, position));
+		return arena.make<typespec_error>(position);
 	}
 
-	static auto inline make_const_stmt(const std::string& name, const std::shared_ptr<typespec>& type, const std::shared_ptr<expr>& initializer, source_pos position = source_pos())
+	static auto inline make_expr_stmt(arena& arena, expr* expression, source_pos position = source_pos())
 	{
-		return std::shared_ptr<stmt_const>(new stmt_const(name, type, initializer, position));
+		return arena.make<stmt_expr>(expression, position);
 	}
 
-	static auto inline make_return_stmt(const std::shared_ptr<expr>& ret_expr, source_pos position = source_pos())
+	static auto inline make_let_stmt(arena& arena, std::string_view name, symbol name_symbol, typespec* type, expr* initializer, source_pos position = source_pos())
 	{
-		return std::shared_ptr<stmt_return>(new stmt_return(ret_expr, position));
+		return arena.make<stmt_let>(arena.copy(name), name_symbol, type, initializer, position);
 	}
 
-	static auto inline make_if_stmt(const std::vector<if_branch>& if_branches, const std::vector<std::shared_ptr<stmt>>& else_branch, source_pos position = source_pos())
+	static auto inline make_let_stmt(arena& arena, std::string_view name, typespec* type, expr* initializer, source_pos position = source_pos())
 	{
-		return std::shared_ptr<stmt_if>(new stmt_if(if_branches, else_branch, position));
+		return make_let_stmt(arena, name, symbol::intern(name), type, initializer, position);
 	}
 
-	static auto inline make_block_stmt(const std::vector<std::shared_ptr<stmt>>& block, source_pos position = source_pos())
+	static auto inline make_const_stmt(arena& arena, std::string_view name, symbol name_symbol, typespec* type, expr* initializer, source_pos position = source_pos())
 	{
-		return std::shared_ptr<stmt_block>(new stmt_block(block, position));
+		return arena.make<stmt_const>(arena.copy(name), name_symbol, type, initializer, position);
 	}
 
-	static auto inline make_import_decl(const std::string& path, source_pos position = source_pos())
+	static auto inline make_const_stmt(arena& arena, std::string_view name, typespec* type, expr* initializer, source_pos position = source_pos())
 	{
-		return std::shared_ptr<decl_import>(new decl_import(path, position));
+		return make_const_stmt(arena, name, symbol::intern(name), type, initializer, position);
 	}
 
-	static auto inline make_namespace_decl(const std::string& name, source_pos position = source_pos())
+	static auto inline make_return_stmt(arena& arena, expr* ret_expr, source_pos position = source_pos())
 	{
-		return std::shared_ptr<decl_namespace>(new decl_namespace(name, position));
+		return arena.make<stmt_return>(ret_expr, position);
 	}
 
-	static auto inline make_func_decl(const std::string& name, const std::vector<func_arg>& arguments, const std::shared_ptr<typespec>& ret_type, const std::vector<std::shared_ptr<stmt>>& body, source_pos position = source_pos())
+	static auto inline make_if_branch(arena& arena, expr* condition, const std::vector<stmt*>& body)
 	{
-		return std::shared_ptr<decl_func>(new decl_func(name, arguments, ret_type, body, position));
+		return if_branch(condition, arena.copy(body));
+	}
+
+	static auto inline make_if_stmt(arena& arena, const std::vector<if_branch>& if_branches, const std::vector<stmt*>& else_branch, source_pos position = source_pos())
+	{
+		return arena.make<stmt_if>(arena.copy(if_branches), arena.copy(else_branch), position);
+	}
+
+	static auto inline make_block_stmt(arena& arena, const std::vector<stmt*>& block, source_pos position = source_pos())
+	{
+		return arena.make<stmt_block>(arena.copy(block), position);
+	}
+
+	static auto inline make_error_stmt(arena& arena, source_pos position = source_pos())
+	{
+		return arena.make<stmt_error>(position);
+	}
+
+	static auto inline make_import_decl(arena& arena, std::string_view path, source_pos position = source_pos())
+	{
+		return arena.make<decl_import>(arena.copy(path), position);
+	}
+
+	static auto inline make_namespace_decl(arena& arena, std::string_view name, source_pos position = source_pos())
+	{
+		return arena.make<decl_namespace>(arena.copy(name), position);
+	}
+
+	static auto inline make_func_decl(arena& arena, std::string_view name, const std::vector<func_arg>& arguments, typespec* ret_type, const std::vector<stmt*>& body, source_pos position = source_pos())
+	{
+		return arena.make<decl_func>(arena.copy(name), arena.copy(arguments), ret_type, arena.copy(body), position);
 	}
 	
-	static auto inline make_struct_decl(const std::string name, const std::vector<struct_field>& fields, const std::vector<std::shared_ptr<decl_func>>& functions, source_pos position = source_pos())
+	static auto inline make_lazy_func_decl(arena& arena, std::string_view name, const std::vector<func_arg>& arguments, typespec* ret_type, body_parser* body_parser, uint32_t body_begin, uint32_t body_end, source_pos position = source_pos())
+	{
+		return arena.make<decl_func>(arena.copy(name), arena.copy(arguments), ret_type, body_parser, body_begin, body_end, position);
+	}
+
+	static auto inline make_struct_decl(arena& arena, std::string_view name, const std::vector<struct_field>& fields, const std::vector<decl_func*>& functions, source_pos position = source_pos())
+	{
+		return arena.make<decl_struct>(arena.copy(name), arena.copy(fields), arena.copy(functions), position);
+	}
+
+	static auto inline make_alias_decl(arena& arena, std::string_view name, typespec* type, source_pos position = source_pos())
 	{
-		return std::shared_ptr<decl_struct>(new decl_struct(name, fields, functions, position));
+		return arena.make<decl_alias>(arena.copy(name), type, position);
 	}
 
-	static auto inline make_alias_decl(const std::string& name, const std::shared_ptr<typespec>& type, source_pos position = source_pos())
+	static auto inline make_error_decl(arena& arena, source_pos position = source_pos())
 	{
-		return std::shared_ptr<decl_alias>(new decl_alias(name, type, position));
+		return arena.make<decl_error>(position);
 	}
-}
+}
\ No newline at end of file
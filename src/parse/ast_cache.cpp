@@ -0,0 +1,587 @@
+#include "ast_cache.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <unordered_map>
+
+#include "flat_ast.h"
+#include "../util/casting.h"
+
+namespace
+{
+    constexpr char cache_magic[4] = { 'A', 'R', 'C', 'A' };
+
+    struct cache_header
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t source_hash;
+        uint64_t source_size;
+        uint32_t node_count;
+        uint32_t extra_count;
+        uint32_t module_count;
+        uint32_t type_words;
+        uint32_t slot_count;
+        uint32_t string_count;
+        uint32_t string_bytes;
+        uint32_t unused;
+    };
+    static_assert(sizeof(cache_header) % 8 == 0);
+
+    // A flat_node with its padding spelled out, so the file doesn't depend on
+    // whatever happened to be in it.
+    struct cache_node
+    {
+        uint8_t kind;
+        uint8_t op;
+        uint16_t unused;
+        uint32_t lhs;
+        uint32_t rhs;
+    };
+
+    struct cache_slot
+    {
+        arc::node_index node;
+        uint32_t type;
+    };
+
+    // Types are written as a tag followed by its operands, other types are
+    // referred to by their position in the table plus one, zero is no type.
+    // Structs, and types built from them, are written as no type. They belong
+    // to one run of the type checker, which makes them again when the cached
+    // module is checked.
+    //
+    //   none, boolean
+    //   integer   is_signed, size
+    //   floating  size
+    //   pointer   base
+    //   func      return type, argument count, argument types...
+    enum class type_tag : uint32_t
+    {
+        none,
+        boolean,
+        integer,
+        floating,
+        pointer,
+        func
+    };
+
+    // Rotate, xor and multiply a word at a time, fast enough to run over every
+    // source file on every build. The size is checked separately.
+    uint64_t hash_source(const arc::source_file& source)
+    {
+        constexpr uint64_t multiplier = 0x9E3779B97F4A7C15;
+
+        auto data = source.buffer();
+        auto size = source.size();
+        uint64_t hash = 0;
+        size_t i = 0;
+        for(; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            hash = (std::rotl(hash, 5) ^ word) * multiplier;
+        }
+
+        uint64_t tail = 0;
+        std::memcpy(&tail, data + i, size - i);
+        hash = (std::rotl(hash, 5) ^ tail) * multiplier;
+        return hash ^ (hash >> 29);
+    }
+
+    class type_writer
+    {
+    private:
+        std::vector<uint32_t>& _words;
+        std::unordered_map<const arc::type*, uint32_t> _indices;
+    public:
+        type_writer(std::vector<uint32_t>& words)
+            : _words(words)
+        {
+        }
+
+        uint32_t write(const std::shared_ptr<arc::type>& type)
+        {
+            if(type == nullptr)
+            {
+                return 0;
+            }
+
+            auto it = _indices.find(type.get());
+            if(it != _indices.end())
+            {
+                return it->second;
+            }
+
+            switch(type->kind)
+            {
+            case arc::type_kind::none: {
+                _words.push_back(uint32_t(type_tag::none));
+            } break;
+            case arc::type_kind::boolean: {
+                _words.push_back(uint32_t(type_tag::boolean));
+            } break;
+            case arc::type_kind::integer: {
+                auto integer = arc::cast<arc::type_integer>(type);
+                _words.insert(_words.end(), { uint32_t(type_tag::integer), integer->is_signed, uint32_t(integer->size) });
+            } break;
+            case arc::type_kind::floating: {
+                _words.insert(_words.end(), { uint32_t(type_tag::floating), uint32_t(arc::cast<arc::type_float>(type)->size) });
+            } break;
+            case arc::type_kind::pointer: {
+                auto base = write(arc::cast<arc::type_pointer>(type)->base);
+                if(base == 0)
+                {
+                    return 0;
+                }
+                _words.insert(_words.end(), { uint32_t(type_tag::pointer), base });
+            } break;
+            case arc::type_kind::func: {
+                auto func = arc::cast<arc::type_func>(type);
+                std::vector<uint32_t> args;
+                for(const auto& arg : func->argument_types)
+                {
+                    args.push_back(write(arg));
+                }
+                auto ret = write(func->return_type);
+                if(ret == 0 || std::find(args.begin(), args.end(), 0) != args.end())
+                {
+                    return 0;
+                }
+                _words.insert(_words.end(), { uint32_t(type_tag::func), ret, uint32_t(args.size()) });
+                _words.insert(_words.end(), args.begin(), args.end());
+            } break;
+            case arc::type_kind::structure: {
+                return 0;
+            }
+            }
+
+            auto index = uint32_t(_indices.size() + 1);
+            _indices.emplace(type.get(), index);
+            return index;
+        }
+    };
+
+    // Rebuilds the ast from the sections of a cache file. Children always come
+    // before their parents, so one pass over the nodes builds everything.
+    class ast_reader
+    {
+    private:
+        arc::arena& _arena;
+        uint32_t _file;
+
+        std::span<const cache_node> _nodes;
+        std::span<const uint32_t> _positions;
+        std::span<const uint32_t> _extra;
+        std::span<const uint32_t> _module;
+        std::span<const uint32_t> _type_words;
+        std::span<const cache_slot> _slots;
+        std::span<const uint32_t> _string_offsets;
+        const char* _string_data;
+
+        // Nodes built so far, null for the ones that aren't ast_nodes of their
+        // own. Those are built along with their parent.
+        std::vector<arc::ast_node*> _built;
+        std::vector<std::shared_ptr<arc::type>> _types;
+        // Interned names by string index, filled in as they're first used.
+        std::vector<std::optional<arc::symbol>> _symbols;
+
+        std::vector<arc::func_arg> _args;
+        std::vector<arc::struct_field> _fields;
+        std::vector<arc::if_branch> _branches;
+    public:
+        ast_reader(arc::arena& arena, uint32_t file, const char* data, const cache_header& header)
+            : _arena(arena), _file(file)
+        {
+            auto take = [&]<typename T>(std::span<const T>& section, size_t count) {
+                section = { reinterpret_cast<const T*>(data), count };
+                data += count * sizeof(T);
+            };
+            take(_nodes, header.node_count);
+            take(_positions, header.node_count);
+            take(_extra, header.extra_count);
+            take(_module, header.module_count);
+            take(_type_words, header.type_words);
+            take(_slots, header.slot_count);
+            take(_string_offsets, header.string_count + 1);
+            _string_data = data;
+            _symbols.resize(header.string_count);
+        }
+
+        // Returns false if the type table doesn't make sense.
+        bool read_types(arc::type_interner& interner)
+        {
+            _types.push_back(nullptr);
+            for(size_t i = 0; i < _type_words.size();)
+            {
+                auto operand = [&](size_t n) {
+                    return i + n < _type_words.size() ? _type_words[i + n] : UINT32_MAX;
+                };
+                auto type = [&](size_t n) {
+                    auto index = operand(n);
+                    return index < _types.size() ? _types[index] : nullptr;
+                };
+
+                switch(type_tag(_type_words[i]))
+                {
+                case type_tag::none: {
+                    _types.push_back(interner.none());
+                    i += 1;
+                } break;
+                case type_tag::boolean: {
+                    _types.push_back(interner.boolean());
+                    i += 1;
+                } break;
+                case type_tag::integer: {
+                    _types.push_back(interner.integer(operand(1) != 0, operand(2)));
+                    i += 3;
+                } break;
+                case type_tag::floating: {
+                    _types.push_back(interner.floating(operand(1)));
+                    i += 2;
+                } break;
+                case type_tag::pointer: {
+                    auto base = type(1);
+                    if(base == nullptr)
+                    {
+                        return false;
+                    }
+                    _types.push_back(interner.pointer(base));
+                    i += 2;
+                } break;
+                case type_tag::func: {
+                    auto count = operand(2);
+                    if(count > _type_words.size() - i)
+                    {
+                        return false;
+                    }
+                    std::vector<std::shared_ptr<arc::type>> args;
+                    for(uint32_t a = 0; a < count; a++)
+                    {
+                        args.push_back(type(3 + a));
+                    }
+                    auto ret = type(1);
+                    if(ret == nullptr || std::find(args.begin(), args.end(), nullptr) != args.end())
+                    {
+                        return false;
+                    }
+                    _types.push_back(interner.func(ret, args));
+                    i += 3 + count;
+                } break;
+                default: {
+                    return false;
+                }
+                }
+            }
+
+            return std::all_of(_slots.begin(), _slots.end(), [&](const cache_slot& slot) {
+                return slot.type < _types.size();
+            });
+        }
+
+        std::vector<arc::decl*> read_module()
+        {
+            _built.resize(_nodes.size());
+            for(arc::node_index i = 0; i < _nodes.size(); i++)
+            {
+                _built[i] = read_node(i);
+            }
+
+            std::vector<arc::decl*> decls;
+            decls.reserve(_module.size());
+            for(auto index : _module)
+            {
+                decls.push_back(get<arc::decl>(index));
+            }
+            return decls;
+        }
+    private:
+        arc::ast_node* read_node(arc::node_index i)
+        {
+            const auto& node = _nodes[i];
+            arc::source_pos position { .offset = _positions[i], .file = _file };
+
+            switch(arc::ast_kind(node.kind))
+            {
+            case arc::ast_kind::typespec_func:
+                return _arena.make<arc::typespec_func>(list<arc::typespec>(node.rhs), get<arc::typespec>(node.lhs), position);
+            case arc::ast_kind::typespec_name:
+                return _arena.make<arc::typespec_name>(string(node.lhs), position);
+            case arc::ast_kind::typespec_pointer:
+                return _arena.make<arc::typespec_pointer>(get<arc::typespec>(node.lhs), position);
+            case arc::ast_kind::typespec_error:
+                return _arena.make<arc::typespec_error>(position);
+
+            case arc::ast_kind::decl_import:
+                return _arena.make<arc::decl_import>(string(node.lhs), position);
+            case arc::ast_kind::decl_namespace:
+                return _arena.make<arc::decl_namespace>(string(node.lhs), position);
+            case arc::ast_kind::decl_func: {
+                _args.clear();
+                for(auto arg : items(_extra[node.rhs]))
+                {
+                    _args.emplace_back(string(_nodes[arg].lhs), symbol(_nodes[arg].lhs), get<arc::typespec>(_nodes[arg].rhs));
+                    _args.back().types.type = type_of(arg);
+                }
+                auto func = _arena.make<arc::decl_func>(string(node.lhs), _arena.copy(_args), get<arc::typespec>(_extra[node.rhs + 1]), list<arc::stmt>(_extra[node.rhs + 2]), position);
+                func->types.ret_type = type_of(i);
+                return func;
+            }
+            case arc::ast_kind::decl_struct: {
+                _fields.clear();
+                for(auto field : items(_extra[node.rhs]))
+                {
+                    _fields.emplace_back(string(_nodes[field].lhs), get<arc::typespec>(_nodes[field].rhs));
+                }
+                return _arena.make<arc::decl_struct>(string(node.lhs), _arena.copy(_fields), list<arc::decl_func>(_extra[node.rhs + 1]), position);
+            }
+            case arc::ast_kind::decl_alias:
+                return _arena.make<arc::decl_alias>(string(node.lhs), get<arc::typespec>(node.rhs), position);
+            case arc::ast_kind::decl_error:
+                return _arena.make<arc::decl_error>(position);
+
+            case arc::ast_kind::stmt_expr:
+                return _arena.make<arc::stmt_expr>(get<arc::expr>(node.lhs), position);
+            case arc::ast_kind::stmt_let: {
+                auto let = _arena.make<arc::stmt_let>(string(node.lhs), symbol(node.lhs), get<arc::typespec>(_extra[node.rhs]), get<arc::expr>(_extra[node.rhs + 1]), position);
+                let->types.deduced_type = type_of(i);
+                return let;
+            }
+            case arc::ast_kind::stmt_const: {
+                auto constant = _arena.make<arc::stmt_const>(string(node.lhs), symbol(node.lhs), get<arc::typespec>(_extra[node.rhs]), get<arc::expr>(_extra[node.rhs + 1]), position);
+                constant->types.deduced_type = type_of(i);
+                return constant;
+            }
+            case arc::ast_kind::stmt_return:
+                return _arena.make<arc::stmt_return>(get<arc::expr>(node.lhs), position);
+            case arc::ast_kind::stmt_if: {
+                _branches.clear();
+                for(auto branch : items(node.lhs))
+                {
+                    _branches.emplace_back(get<arc::expr>(_nodes[branch].lhs), list<arc::stmt>(_nodes[branch].rhs));
+                }
+                return _arena.make<arc::stmt_if>(_arena.copy(_branches), list<arc::stmt>(node.rhs), position);
+            }
+            case arc::ast_kind::stmt_block:
+                return _arena.make<arc::stmt_block>(list<arc::stmt>(node.lhs), position);
+            case arc::ast_kind::stmt_error:
+                return _arena.make<arc::stmt_error>(position);
+
+            case arc::ast_kind::expr_integer:
+                return _arena.make<arc::expr_integer>(uint64_t(node.rhs) << 32 | node.lhs, position);
+            case arc::ast_kind::expr_boolean:
+                return _arena.make<arc::expr_boolean>(node.lhs != 0, position);
+            case arc::ast_kind::expr_name:
+                return _arena.make<arc::expr_name>(string(node.lhs), symbol(node.lhs), position);
+            case arc::ast_kind::expr_binary:
+                return _arena.make<arc::expr_binary>(arc::binary_op(node.op), get<arc::expr>(node.lhs), get<arc::expr>(node.rhs), position);
+            case arc::ast_kind::expr_unary:
+                return _arena.make<arc::expr_unary>(arc::unary_op(node.op), get<arc::expr>(node.lhs), position);
+            case arc::ast_kind::expr_call:
+                return _arena.make<arc::expr_call>(get<arc::expr>(node.lhs), list<arc::expr>(node.rhs), position);
+            case arc::ast_kind::expr_index:
+                return _arena.make<arc::expr_index>(get<arc::expr>(node.lhs), get<arc::expr>(node.rhs), position);
+            case arc::ast_kind::expr_access:
+                return _arena.make<arc::expr_access>(get<arc::expr>(node.lhs), string(node.rhs), position);
+            case arc::ast_kind::expr_cast: {
+                auto cast = _arena.make<arc::expr_cast>(get<arc::expr>(node.lhs), get<arc::typespec>(node.rhs), position);
+                cast->types.to_type = type_of(i);
+                return cast;
+            }
+            case arc::ast_kind::expr_error:
+                return _arena.make<arc::expr_error>(position);
+
+            default:
+                // if_branch, func_arg and struct_field, built by their parent.
+                return nullptr;
+            }
+        }
+
+        template<typename T>
+        T* get(arc::node_index index) const
+        {
+            return index == arc::flat_ast::null_index ? nullptr : static_cast<T*>(_built[index]);
+        }
+
+        std::span<const uint32_t> items(uint32_t list) const
+        {
+            return _extra.subspan(list + 1, _extra[list]);
+        }
+
+        template<typename T>
+        std::span<T* const> list(uint32_t index)
+        {
+            auto indices = items(index);
+            if(indices.empty())
+            {
+                return {};
+            }
+
+            auto nodes = static_cast<T**>(_arena.allocate(sizeof(T*) * indices.size(), alignof(T*)));
+            for(size_t i = 0; i < indices.size(); i++)
+            {
+                nodes[i] = get<T>(indices[i]);
+            }
+            return { nodes, indices.size() };
+        }
+
+        std::string_view string(uint32_t index) const
+        {
+            return { _string_data + _string_offsets[index], _string_offsets[index + 1] - _string_offsets[index] };
+        }
+
+        arc::symbol symbol(uint32_t index)
+        {
+            auto& sym = _symbols[index];
+            if(!sym)
+            {
+                sym = arc::symbol::intern(string(index));
+            }
+            return *sym;
+        }
+
+        std::shared_ptr<arc::type> type_of(arc::node_index node) const
+        {
+            auto it = std::lower_bound(_slots.begin(), _slots.end(), node, [](const cache_slot& slot, arc::node_index node) {
+                return slot.node < node;
+            });
+            return it != _slots.end() && it->node == node ? _types[it->type] : nullptr;
+        }
+    };
+
+    template<typename T>
+    void write_section(std::ofstream& out, const std::vector<T>& items)
+    {
+        out.write(reinterpret_cast<const char*>(items.data()), std::streamsize(items.size() * sizeof(T)));
+    }
+}
+
+namespace arc
+{
+    std::string ast_cache_path(const source_file& source)
+    {
+        return source.path() + ".astc";
+    }
+
+    bool write_ast_cache(const std::string& path, const source_file& source, const std::vector<decl*>& module)
+    {
+        auto ast = flatten(module);
+
+        std::vector<cache_node> nodes;
+        std::vector<uint32_t> positions;
+        nodes.reserve(ast.nodes.size());
+        positions.reserve(ast.nodes.size());
+        for(size_t i = 0; i < ast.nodes.size(); i++)
+        {
+            const auto& node = ast.nodes[i];
+            nodes.push_back({ uint8_t(node.kind), node.op, 0, node.lhs, node.rhs });
+            positions.push_back(ast.positions[i].offset);
+        }
+
+        std::vector<uint32_t> type_words;
+        std::vector<cache_slot> slots;
+        type_writer types(type_words);
+        for(const auto& [node, type] : ast.types)
+        {
+            slots.push_back({ node, types.write(type) });
+        }
+
+        std::vector<uint32_t> string_offsets = { 0 };
+        std::string string_data;
+        for(const auto& string : ast.strings)
+        {
+            string_data += string;
+            string_offsets.push_back(uint32_t(string_data.size()));
+        }
+
+        cache_header header = {};
+        std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+        header.version = ast_cache_version;
+        header.source_hash = hash_source(source);
+        header.source_size = source.size();
+        header.node_count = uint32_t(nodes.size());
+        header.extra_count = uint32_t(ast.extra.size());
+        header.module_count = uint32_t(ast.module.size());
+        header.type_words = uint32_t(type_words.size());
+        header.slot_count = uint32_t(slots.size());
+        header.string_count = uint32_t(ast.strings.size());
+        header.string_bytes = uint32_t(string_data.size());
+
+        auto temp_path = path + ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            write_section(out, nodes);
+            write_section(out, positions);
+            write_section(out, ast.extra);
+            write_section(out, ast.module);
+            write_section(out, type_words);
+            write_section(out, slots);
+            write_section(out, string_offsets);
+            out.write(string_data.data(), std::streamsize(string_data.size()));
+            out.close();
+            if(!out)
+            {
+                std::filesystem::remove(temp_path);
+                return false;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temp_path, path, error);
+        return !error;
+    }
+
+    cached_module::cached_module(std::unique_ptr<source_file> file)
+        : _file(std::move(file))
+    {
+    }
+
+    std::optional<cached_module> cached_module::load(const std::string& path, const source_file& source, type_interner& types)
+    {
+        // source_file maps the cache when it can, the names in the ast are
+        // left pointing into it.
+        auto file = std::make_unique<source_file>(path);
+        if(!file->exists() || file->size() < sizeof(cache_header))
+        {
+            return std::nullopt;
+        }
+
+        cache_header header;
+        std::memcpy(&header, file->buffer(), sizeof(header));
+        if(std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 || header.version != ast_cache_version)
+        {
+            return std::nullopt;
+        }
+        if(header.source_size != source.size() || header.source_hash != hash_source(source))
+        {
+            return std::nullopt;
+        }
+
+        uint64_t expected_size = sizeof(cache_header)
+            + uint64_t(header.node_count) * (sizeof(cache_node) + sizeof(uint32_t))
+            + (uint64_t(header.extra_count) + header.module_count + header.type_words) * sizeof(uint32_t)
+            + uint64_t(header.slot_count) * sizeof(cache_slot)
+            + (uint64_t(header.string_count) + 1) * sizeof(uint32_t)
+            + header.string_bytes;
+        if(file->size() != expected_size)
+        {
+            return std::nullopt;
+        }
+
+        // Past this point the contents are trusted, they can only have been
+        // written by write_ast_cache for this exact source.
+        cached_module module(std::move(file));
+        ast_reader reader(module._arena, source.id(), module._file->buffer() + sizeof(cache_header), header);
+        if(!reader.read_types(types))
+        {
+            return std::nullopt;
+        }
+        module._decls = reader.read_module();
+        return module;
+    }
+}
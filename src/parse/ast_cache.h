@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+#include "../type/type_interner.h"
+#include "../util/arena.h"
+#include "../util/source_file.h"
+
+namespace arc
+{
+    // The cache format is the flat ast written out section by section after a
+    // header, in native byte order since a cache is only ever read back on the
+    // machine that wrote it:
+    //
+    //   header     magic, format version, hash and size of the source, counts
+    //   nodes      kind, op and both operands of every flat_node
+    //   positions  source offset of every node
+    //   extra      flat_ast::extra
+    //   module     the top level declarations
+    //   types      the types the slots refer to, children before parents
+    //   slots      (node, type) pairs filling in the types side slots
+    //   strings    offset of every name, then all of their characters
+    //
+    // Bump ast_cache_version whenever the layout or the meaning of a node's
+    // operands changes.
+    constexpr uint32_t ast_cache_version = 1;
+
+    // Where the cache of a source file is kept.
+    std::string ast_cache_path(const source_file& source);
+
+    // Writes module to path, keyed by the contents of source. The file is
+    // written next to path and renamed into place, so a reader never sees half
+    // of one. Returns false if it could not be written.
+    bool write_ast_cache(const std::string& path, const source_file& source, const std::vector<decl*>& module);
+
+    // A module loaded from the cache. The names in the ast point into the
+    // mapped cache file, so the ast is only valid while this is alive.
+    class cached_module
+    {
+    private:
+        std::unique_ptr<source_file> _file;
+        arena _arena;
+        std::vector<decl*> _decls;
+    public:
+        // Fails if there is no cache at path or it was written by another
+        // version of the format or for other contents of source. The types in
+        // the ast are built through types, so they are the same objects the
+        // checker gets when it is given the same interner.
+        static std::optional<cached_module> load(const std::string& path, const source_file& source, type_interner& types);
+
+        const std::vector<decl*>& decls() const
+        {
+            return _decls;
+        }
+    private:
+        cached_module(std::unique_ptr<source_file> file);
+    };
+}
@@ -0,0 +1,291 @@
+#include "flat_ast.h"
+
+#include <unordered_map>
+
+namespace
+{
+    // Walks the tree and appends every node after its children.
+    class flattener : public arc::ast_visitor
+    {
+    private:
+        arc::flat_ast& _ast;
+        arc::node_index _result;
+
+        // List items that are still being collected, shared by every list so
+        // that building one doesn't need an allocation.
+        std::vector<arc::node_index> _items;
+
+        std::unordered_map<std::string_view, uint32_t> _names;
+    public:
+        flattener(arc::flat_ast& ast)
+            : _ast(ast), _result(arc::flat_ast::null_index)
+        {
+        }
+
+        template<typename T>
+        arc::node_index flatten(const T* node)
+        {
+            if(node == nullptr)
+            {
+                return arc::flat_ast::null_index;
+            }
+            node->accept(*this);
+            return _result;
+        }
+
+        template<typename T>
+        uint32_t flatten_list(std::span<T* const> nodes)
+        {
+            auto base = _items.size();
+            for(const auto& node : nodes)
+            {
+                auto index = flatten(node);
+                _items.push_back(index);
+            }
+            return add_items(base);
+        }
+
+        // Adds the items collected since base as a list.
+        uint32_t add_items(size_t base)
+        {
+            auto list = _ast.add_list(std::span(_items).subspan(base));
+            _items.resize(base);
+            return list;
+        }
+
+        uint32_t name(std::string_view text)
+        {
+            auto it = _names.find(text);
+            if(it != _names.end())
+            {
+                return it->second;
+            }
+
+            // Key the map by the copy, the original tree may not outlive the ast.
+            auto index = _ast.add_string(text);
+            _names.emplace(_ast.string(index), index);
+            return index;
+        }
+
+        void visit(const arc::typespec_func& spec) override
+        {
+            auto args = flatten_list(spec.argument_types);
+            auto ret = flatten(spec.return_type);
+            _result = _ast.add(arc::ast_kind::typespec_func, spec.position, ret, args);
+        }
+
+        void visit(const arc::typespec_name& spec) override
+        {
+            _result = _ast.add(arc::ast_kind::typespec_name, spec.position, name(spec.name));
+        }
+
+        void visit(const arc::typespec_pointer& spec) override
+        {
+            auto base = flatten(spec.base);
+            _result = _ast.add(arc::ast_kind::typespec_pointer, spec.position, base);
+        }
+
+        void visit(const arc::typespec_error& spec) override
+        {
+            _result = _ast.add(arc::ast_kind::typespec_error, spec.position);
+        }
+
+        void visit(const arc::decl_import& decl) override
+        {
+            _result = _ast.add(arc::ast_kind::decl_import, decl.position, name(decl.path));
+        }
+
+        void visit(const arc::decl_namespace& decl) override
+        {
+            _result = _ast.add(arc::ast_kind::decl_namespace, decl.position, name(decl.name));
+        }
+
+        void visit(const arc::decl_func& decl) override
+        {
+            auto base = _items.size();
+            for(const auto& arg : decl.arguments)
+            {
+                auto type = flatten(arg.type);
+                _items.push_back(_ast.add(arc::ast_kind::func_arg, arg.type->position, name(arg.name), type));
+                add_type(_items.back(), arg.types.type);
+            }
+            auto args_list = add_items(base);
+            auto ret_type = flatten(decl.ret_type);
+            auto body = flatten_list(decl.body());
+
+            auto extra = uint32_t(_ast.extra.size());
+            _ast.extra.insert(_ast.extra.end(), { args_list, ret_type, body });
+            _result = _ast.add(arc::ast_kind::decl_func, decl.position, name(decl.name), extra);
+            add_type(_result, decl.types.ret_type);
+        }
+
+        void visit(const arc::decl_struct& decl) override
+        {
+            auto base = _items.size();
+            for(const auto& field : decl.fields)
+            {
+                auto type = flatten(field.type);
+                _items.push_back(_ast.add(arc::ast_kind::struct_field, field.type->position, name(field.name), type));
+            }
+            auto fields_list = add_items(base);
+            auto functions = flatten_list(decl.functions);
+
+            auto extra = uint32_t(_ast.extra.size());
+            _ast.extra.insert(_ast.extra.end(), { fields_list, functions });
+            _result = _ast.add(arc::ast_kind::decl_struct, decl.position, name(decl.name), extra);
+        }
+
+        void visit(const arc::decl_alias& decl) override
+        {
+            auto type = flatten(decl.type);
+            _result = _ast.add(arc::ast_kind::decl_alias, decl.position, name(decl.name), type);
+        }
+
+        void visit(const arc::decl_error& decl) override
+        {
+            _result = _ast.add(arc::ast_kind::decl_error, decl.position);
+        }
+
+        void visit(const arc::stmt_expr& stmt) override
+        {
+            auto expression = flatten(stmt.expression);
+            _result = _ast.add(arc::ast_kind::stmt_expr, stmt.position, expression);
+        }
+
+        void visit(const arc::stmt_let& stmt) override
+        {
+            visit_variable(arc::ast_kind::stmt_let, stmt.name, stmt.type, stmt.initializer, stmt.position);
+            add_type(_result, stmt.types.deduced_type);
+        }
+
+        void visit(const arc::stmt_const& stmt) override
+        {
+            visit_variable(arc::ast_kind::stmt_const, stmt.name, stmt.type, stmt.initializer, stmt.position);
+            add_type(_result, stmt.types.deduced_type);
+        }
+
+        void visit(const arc::stmt_return& stmt) override
+        {
+            auto expression = flatten(stmt.expression);
+            _result = _ast.add(arc::ast_kind::stmt_return, stmt.position, expression);
+        }
+
+        void visit(const arc::stmt_if& stmt) override
+        {
+            auto base = _items.size();
+            for(const auto& branch : stmt.if_branches)
+            {
+                auto condition = flatten(branch.condition);
+                auto body = flatten_list(branch.body);
+                _items.push_back(_ast.add(arc::ast_kind::if_branch, branch.condition->position, condition, body));
+            }
+            auto branches_list = add_items(base);
+            auto else_branch = flatten_list(stmt.else_branch);
+            _result = _ast.add(arc::ast_kind::stmt_if, stmt.position, branches_list, else_branch);
+        }
+
+        void visit(const arc::stmt_block& stmt) override
+        {
+            auto block = flatten_list(stmt.block);
+            _result = _ast.add(arc::ast_kind::stmt_block, stmt.position, block);
+        }
+
+        void visit(const arc::stmt_error& stmt) override
+        {
+            _result = _ast.add(arc::ast_kind::stmt_error, stmt.position);
+        }
+
+        void visit(const arc::expr_integer& expr) override
+        {
+            _result = _ast.add(arc::ast_kind::expr_integer, expr.position, uint32_t(expr.value), uint32_t(expr.value >> 32));
+        }
+
+        void visit(const arc::expr_boolean& expr) override
+        {
+            _result = _ast.add(arc::ast_kind::expr_boolean, expr.position, expr.value);
+        }
+
+        void visit(const arc::expr_name& expr) override
+        {
+            _result = _ast.add(arc::ast_kind::expr_name, expr.position, name(expr.name));
+        }
+
+        void visit(const arc::expr_binary& expr) override
+        {
+            auto lhs = flatten(expr.lhs);
+            auto rhs = flatten(expr.rhs);
+            _result = _ast.add(arc::ast_kind::expr_binary, expr.position, lhs, rhs, uint8_t(expr.op));
+        }
+
+        void visit(const arc::expr_unary& expr) override
+        {
+            auto rhs = flatten(expr.rhs);
+            _result = _ast.add(arc::ast_kind::expr_unary, expr.position, rhs, 0, uint8_t(expr.op));
+        }
+
+        void visit(const arc::expr_call& expr) override
+        {
+            auto lhs = flatten(expr.lhs);
+            auto args = flatten_list(expr.args);
+            _result = _ast.add(arc::ast_kind::expr_call, expr.position, lhs, args);
+        }
+
+        void visit(const arc::expr_index& expr) override
+        {
+            auto lhs = flatten(expr.lhs);
+            auto index = flatten(expr.index);
+            _result = _ast.add(arc::ast_kind::expr_index, expr.position, lhs, index);
+        }
+
+        void visit(const arc::expr_access& expr) override
+        {
+            auto lhs = flatten(expr.lhs);
+            _result = _ast.add(arc::ast_kind::expr_access, expr.position, lhs, name(expr.field));
+        }
+
+        void visit(const arc::expr_cast& expr) override
+        {
+            auto lhs = flatten(expr.lhs);
+            auto to_type = flatten(expr.to_type);
+            _result = _ast.add(arc::ast_kind::expr_cast, expr.position, lhs, to_type);
+            add_type(_result, expr.types.to_type);
+        }
+
+        void visit(const arc::expr_error& expr) override
+        {
+            _result = _ast.add(arc::ast_kind::expr_error, expr.position);
+        }
+    private:
+        void add_type(arc::node_index node, const std::shared_ptr<arc::type>& type)
+        {
+            if(type != nullptr)
+            {
+                _ast.types.emplace_back(node, type);
+            }
+        }
+
+        void visit_variable(arc::ast_kind kind, std::string_view variable, const arc::typespec* type, const arc::expr* initializer, arc::source_pos position)
+        {
+            auto type_index = flatten(type);
+            auto initializer_index = flatten(initializer);
+
+            auto extra = uint32_t(_ast.extra.size());
+            _ast.extra.insert(_ast.extra.end(), { type_index, initializer_index });
+            _result = _ast.add(kind, position, name(variable), extra);
+        }
+    };
+}
+
+namespace arc
+{
+    flat_ast flatten(const std::vector<decl*>& module)
+    {
+        flat_ast ast;
+        flattener flattener(ast);
+        for(const auto& decl : module)
+        {
+            ast.module.push_back(flattener.flatten(decl));
+        }
+        return ast;
+    }
+}
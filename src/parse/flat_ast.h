@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ast.h"
+#include "../util/arena.h"
+
+namespace arc
+{
+    using node_index = uint32_t;
+
+    // A node of the flat ast: a kind tag and two 32-bit operands. What the operands
+    // mean depends on the kind, a "list" is an offset into flat_ast::extra where the
+    // number of items is stored followed by the items themselves.
+    //
+    //   typespec_name     lhs: name
+    //   typespec_pointer  lhs: base type
+    //   typespec_func     lhs: return type        rhs: list of argument types
+    //   decl_import       lhs: path
+    //   decl_namespace    lhs: name
+    //   decl_func         lhs: name               rhs: extra[rhs] = list of func_arg,
+    //                                                  extra[rhs + 1] = return type,
+    //                                                  extra[rhs + 2] = list of statements
+    //   decl_struct       lhs: name               rhs: extra[rhs] = list of struct_field,
+    //                                                  extra[rhs + 1] = list of decl_func
+    //   decl_alias        lhs: name               rhs: type
+    //   stmt_expr         lhs: expression
+    //   stmt_let/const    lhs: name               rhs: extra[rhs] = type or null_index,
+    //                                                  extra[rhs + 1] = initializer or null_index
+    //   stmt_return       lhs: expression or null_index
+    //   stmt_if           lhs: list of if_branch  rhs: list of else statements
+    //   stmt_block        lhs: list of statements
+    //   expr_integer      lhs: low 32 bits        rhs: high 32 bits
+    //   expr_boolean      lhs: value
+    //   expr_name         lhs: name
+    //   expr_binary       lhs: lhs                rhs: rhs                op: binary_op
+    //   expr_unary        lhs: operand                                    op: unary_op
+    //   expr_call         lhs: callee             rhs: list of arguments
+    //   expr_index        lhs: object             rhs: index
+    //   expr_access       lhs: object             rhs: field name
+    //   expr_cast         lhs: expression         rhs: type
+    //   if_branch         lhs: condition          rhs: list of statements
+    //   func_arg          lhs: name               rhs: type
+    //   struct_field      lhs: name               rhs: type
+    //   *_error           no operands, left where the parser recovered from an error
+    //
+    // Names are indices into flat_ast::strings.
+    struct flat_node
+    {
+        ast_kind kind;
+        uint8_t op;
+        uint32_t lhs;
+        uint32_t rhs;
+    };
+
+    // Compact, index based form of the ast. Nodes live in one contiguous array with
+    // their positions in a parallel one, and children are always stored before their
+    // parents, so bottom-up analyses can be done with a single linear scan.
+    class flat_ast
+    {
+    private:
+        arena _string_data;
+    public:
+        static constexpr node_index null_index = UINT32_MAX;
+
+        std::vector<flat_node> nodes;
+        std::vector<source_pos> positions;
+        std::vector<uint32_t> extra;
+        std::vector<std::string_view> strings;
+
+        // The top level declarations, in source order.
+        std::vector<node_index> module;
+
+        // Types the checker has filled in, by node in ascending order. Only
+        // expr_cast, stmt_let/const, func_arg and decl_func nodes have them.
+        std::vector<std::pair<node_index, std::shared_ptr<type>>> types;
+
+        node_index add(ast_kind kind, source_pos position, uint32_t lhs = 0, uint32_t rhs = 0, uint8_t op = 0)
+        {
+            nodes.push_back({ kind, op, lhs, rhs });
+            positions.push_back(position);
+            return node_index(nodes.size() - 1);
+        }
+
+        uint32_t add_list(std::span<const node_index> items)
+        {
+            auto index = uint32_t(extra.size());
+            extra.push_back(uint32_t(items.size()));
+            extra.insert(extra.end(), items.begin(), items.end());
+            return index;
+        }
+
+        uint32_t add_string(std::string_view text)
+        {
+            strings.push_back(_string_data.copy(text));
+            return uint32_t(strings.size() - 1);
+        }
+
+        std::span<const uint32_t> list(uint32_t index) const
+        {
+            return { extra.data() + index + 1, extra[index] };
+        }
+
+        std::string_view string(uint32_t index) const
+        {
+            return strings[index];
+        }
+
+        uint64_t integer(const flat_node& node) const
+        {
+            return uint64_t(node.rhs) << 32 | node.lhs;
+        }
+
+        std::span<const uint32_t> func_args(const flat_node& node) const
+        {
+            return list(extra[node.rhs]);
+        }
+
+        node_index func_ret_type(const flat_node& node) const
+        {
+            return extra[node.rhs + 1];
+        }
+
+        std::span<const uint32_t> func_body(const flat_node& node) const
+        {
+            return list(extra[node.rhs + 2]);
+        }
+    };
+
+    // Builds the flat form of a parsed module. The result does not refer back to
+    // the original tree.
+    flat_ast flatten(const std::vector<decl*>& module);
+}
@@ -0,0 +1,413 @@
+#include "incremental.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // Moves every node of a tree by the same number of bytes.
+    class position_shifter : public arc::ast_visitor
+    {
+    private:
+        const uint32_t _delta;
+    public:
+        position_shifter(int64_t delta)
+            : _delta(uint32_t(delta))
+        {
+        }
+
+        template<typename T>
+        void shift(const T* node)
+        {
+            if(node != nullptr)
+            {
+                node->accept(*this);
+            }
+        }
+
+        template<typename T>
+        void shift_list(std::span<T* const> nodes)
+        {
+            for(const auto& node : nodes)
+            {
+                shift(node);
+            }
+        }
+
+        void visit(const arc::typespec_func& spec) override
+        {
+            relocate(spec);
+            shift_list(spec.argument_types);
+            shift(spec.return_type);
+        }
+
+        void visit(const arc::typespec_name& spec) override
+        {
+            relocate(spec);
+        }
+
+        void visit(const arc::typespec_pointer& spec) override
+        {
+            relocate(spec);
+            shift(spec.base);
+        }
+
+        void visit(const arc::typespec_error& spec) override
+        {
+            relocate(spec);
+        }
+
+        void visit(const arc::decl_import& decl) override
+        {
+            relocate(decl);
+        }
+
+        void visit(const arc::decl_namespace& decl) override
+        {
+            relocate(decl);
+        }
+
+        void visit(const arc::decl_func& decl) override
+        {
+            relocate(decl);
+            for(const auto& arg : decl.arguments)
+            {
+                shift(arg.type);
+            }
+            shift(decl.ret_type);
+            shift_list(decl.body());
+        }
+
+        void visit(const arc::decl_struct& decl) override
+        {
+            relocate(decl);
+            for(const auto& field : decl.fields)
+            {
+                shift(field.type);
+            }
+            shift_list(decl.functions);
+        }
+
+        void visit(const arc::decl_alias& decl) override
+        {
+            relocate(decl);
+            shift(decl.type);
+        }
+
+        void visit(const arc::decl_error& decl) override
+        {
+            relocate(decl);
+        }
+
+        void visit(const arc::stmt_expr& stmt) override
+        {
+            relocate(stmt);
+            shift(stmt.expression);
+        }
+
+        void visit(const arc::stmt_let& stmt) override
+        {
+            relocate(stmt);
+            shift(stmt.type);
+            shift(stmt.initializer);
+        }
+
+        void visit(const arc::stmt_const& stmt) override
+        {
+            relocate(stmt);
+            shift(stmt.type);
+            shift(stmt.initializer);
+        }
+
+        void visit(const arc::stmt_return& stmt) override
+        {
+            relocate(stmt);
+            shift(stmt.expression);
+        }
+
+        void visit(const arc::stmt_if& stmt) override
+        {
+            relocate(stmt);
+            for(const auto& branch : stmt.if_branches)
+            {
+                shift(branch.condition);
+                shift_list(branch.body);
+            }
+            shift_list(stmt.else_branch);
+        }
+
+        void visit(const arc::stmt_block& stmt) override
+        {
+            relocate(stmt);
+            shift_list(stmt.block);
+        }
+
+        void visit(const arc::stmt_error& stmt) override
+        {
+            relocate(stmt);
+        }
+
+        void visit(const arc::expr_integer& expr) override
+        {
+            relocate(expr);
+        }
+
+        void visit(const arc::expr_boolean& expr) override
+        {
+            relocate(expr);
+        }
+
+        void visit(const arc::expr_name& expr) override
+        {
+            relocate(expr);
+        }
+
+        void visit(const arc::expr_binary& expr) override
+        {
+            relocate(expr);
+            shift(expr.lhs);
+            shift(expr.rhs);
+        }
+
+        void visit(const arc::expr_unary& expr) override
+        {
+            relocate(expr);
+            shift(expr.rhs);
+        }
+
+        void visit(const arc::expr_call& expr) override
+        {
+            relocate(expr);
+            shift(expr.lhs);
+            shift_list(expr.args);
+        }
+
+        void visit(const arc::expr_index& expr) override
+        {
+            relocate(expr);
+            shift(expr.lhs);
+            shift(expr.index);
+        }
+
+        void visit(const arc::expr_access& expr) override
+        {
+            relocate(expr);
+            shift(expr.lhs);
+        }
+
+        void visit(const arc::expr_cast& expr) override
+        {
+            relocate(expr);
+            shift(expr.lhs);
+            shift(expr.to_type);
+        }
+
+        void visit(const arc::expr_error& expr) override
+        {
+            relocate(expr);
+        }
+    private:
+        void relocate(const arc::ast_node& node)
+        {
+            // Nodes are only ever handed out as const, but are never created const.
+            const_cast<arc::ast_node&>(node).position.offset += _delta;
+        }
+    };
+
+    // The same error in a new version of the file, delta bytes further on.
+    arc::line_exception move_error(const arc::line_exception& error, const arc::source_file& source, int64_t delta = 0)
+    {
+        auto position = error.position;
+        position.offset += uint32_t(delta);
+        return arc::line_exception(error.error, source, position);
+    }
+
+    std::vector<arc::line_exception> move_errors(const std::vector<arc::line_exception>& errors, const arc::source_file& source, int64_t delta = 0)
+    {
+        std::vector<arc::line_exception> moved;
+        moved.reserve(errors.size());
+        for(const auto& error : errors)
+        {
+            moved.push_back(move_error(error, source, delta));
+        }
+        return moved;
+    }
+}
+
+namespace arc
+{
+    incremental_parser::incremental_parser(std::string_view text)
+        : _source(std::make_unique<source_file>(std::string(text), true)), _full_parse_bytes(0)
+    {
+        auto result = lexer(*_source).lex();
+        _tokens = std::move(result.tokens);
+        _lexer_errors = std::move(result.errors);
+        parse_all();
+    }
+
+    void incremental_parser::apply(const text_edit& edit)
+    {
+        auto old_text = _source->buffer();
+        auto old_size = _source->size();
+        if(edit.offset > old_size || edit.length > old_size - edit.offset)
+        {
+            throw internal_exception("edit is outside of the file");
+        }
+        auto edit_end = edit.offset + edit.length;
+        auto delta = int64_t(edit.text.size()) - int64_t(edit.length);
+
+        std::string text;
+        text.reserve(size_t(int64_t(old_size) + delta));
+        text.append(old_text, edit.offset).append(edit.text).append(old_text + edit_end, old_size - edit_end);
+        auto source = std::make_unique<source_file>(*_source, text);
+
+        // No token can span a newline, so the lines the edit touches can be lexed
+        // again on their own and everything around them stays the same.
+        auto line_begin = edit.offset;
+        while(line_begin > 0 && old_text[line_begin - 1] != '\n')
+        {
+            line_begin--;
+        }
+        auto newline = static_cast<const char*>(std::memchr(old_text + edit_end, '\n', old_size - edit_end));
+        auto old_line_end = newline != nullptr ? size_t(newline - old_text) + 1 : old_size;
+
+        lexer region_lexer(*source, line_begin, size_t(int64_t(old_line_end) + delta));
+        auto region = region_lexer.lex();
+        region.tokens.pop_back();
+
+        // Splice the new tokens in place of the ones on the old lines, the eof is
+        // never among them.
+        auto by_offset = [](const token& token, size_t offset) {
+            return token.position.offset < offset;
+        };
+        auto first = size_t(std::lower_bound(_tokens.begin(), _tokens.end() - 1, line_begin, by_offset) - _tokens.begin());
+        auto last = size_t(std::lower_bound(_tokens.begin() + first, _tokens.end() - 1, old_line_end, by_offset) - _tokens.begin());
+
+        auto old_first = _tokens[first];
+        _tokens.erase(_tokens.begin() + first, _tokens.begin() + last);
+        _tokens.insert(_tokens.begin() + first, region.tokens.begin(), region.tokens.end());
+        auto region_end = first + region.tokens.size();
+        for(auto i = region_end; i < _tokens.size(); i++)
+        {
+            _tokens[i].position.offset += uint32_t(delta);
+        }
+
+        std::vector<line_exception> lexer_errors;
+        for(const auto& error : _lexer_errors)
+        {
+            if(error.position.offset < line_begin)
+            {
+                lexer_errors.push_back(move_error(error, *source));
+            }
+        }
+        for(const auto& error : region.errors)
+        {
+            lexer_errors.push_back(error);
+        }
+        for(const auto& error : _lexer_errors)
+        {
+            if(error.position.offset >= old_line_end)
+            {
+                lexer_errors.push_back(move_error(error, *source, delta));
+            }
+        }
+        _lexer_errors = std::move(lexer_errors);
+
+        auto old_decls = std::move(_decls);
+        auto old_starts = std::move(_decl_starts);
+        auto old_errors = std::move(_decl_errors);
+        _decls.clear();
+        _decl_starts.clear();
+        _decl_errors.clear();
+
+        // The declaration before the first changed token may have looked at it
+        // to decide where it ends, then parsing has to start again from that one.
+        auto peeked_changed = _tokens[first].type != old_first.type || _tokens[first].position.offset != old_first.position.offset;
+        auto changed = std::upper_bound(old_starts.begin(), old_starts.end(), first > 0 && peeked_changed ? first - 1 : first);
+        auto keep = size_t(std::max(changed - old_starts.begin(), ptrdiff_t(1)) - 1);
+        auto start = old_starts.empty() ? 0 : old_starts[keep];
+        for(size_t i = 0; i < keep; i++)
+        {
+            _decls.push_back(old_decls[i]);
+            _decl_starts.push_back(old_starts[i]);
+            _decl_errors.push_back(move_errors(old_errors[i], *source));
+        }
+
+        // Declarations that start after the old lines don't depend on anything
+        // before them, the parse can stop as soon as it reaches one of them.
+        auto reusable_begin = size_t(std::lower_bound(old_starts.begin(), old_starts.end(), last) - old_starts.begin());
+        std::vector<size_t> reusable;
+        reusable.reserve(old_starts.size() - reusable_begin);
+        for(auto i = reusable_begin; i < old_starts.size(); i++)
+        {
+            reusable.push_back(old_starts[i] - last + region_end);
+        }
+
+        position_shifter shifter(delta);
+        for(auto i = reusable_begin + parse_decls(*source, start, reusable); i < old_decls.size(); i++)
+        {
+            if(delta != 0)
+            {
+                old_decls[i]->accept(shifter);
+            }
+            _decls.push_back(old_decls[i]);
+            _decl_starts.push_back(old_starts[i] - last + region_end);
+            _decl_errors.push_back(move_errors(old_errors[i], *source, delta));
+        }
+
+        _source = std::move(source);
+        if(_arena.bytes_reserved() > 2 * _full_parse_bytes)
+        {
+            parse_all();
+        }
+    }
+
+    std::vector<line_exception> incremental_parser::parse_errors() const
+    {
+        std::vector<line_exception> errors;
+        for(const auto& decl_errors : _decl_errors)
+        {
+            for(const auto& error : decl_errors)
+            {
+                errors.push_back(error);
+            }
+        }
+        return errors;
+    }
+
+    void incremental_parser::parse_all()
+    {
+        _decls.clear();
+        _decl_starts.clear();
+        _decl_errors.clear();
+        _arena = arena();
+
+        parse_decls(*_source, 0, {});
+        _full_parse_bytes = _arena.bytes_reserved();
+    }
+
+    size_t incremental_parser::parse_decls(const source_file& source, size_t start, std::span<const size_t> reusable)
+    {
+        parser parser(std::span<const token>(_tokens).subspan(start), source_pos(), source, _arena, parse_mode::recover, nullptr);
+
+        size_t next = 0;
+        while(!parser._stream.next_is(token_type::eof))
+        {
+            auto index = size_t(parser._stream.current() - _tokens.data());
+            while(next < reusable.size() && reusable[next] < index)
+            {
+                next++;
+            }
+            if(next < reusable.size() && reusable[next] == index)
+            {
+                return next;
+            }
+
+            auto error_count = parser._errors.size();
+            _decls.push_back(parser.parse_decl());
+            _decl_starts.push_back(index);
+            _decl_errors.emplace_back(parser._errors.begin() + error_count, parser._errors.end());
+        }
+        return reusable.size();
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "parser.h"
+
+namespace arc
+{
+    // Replaces length bytes at offset with text.
+    struct text_edit
+    {
+        size_t offset;
+        size_t length;
+        std::string_view text;
+    };
+
+    // Keeps the tokens and ast of an in-memory file up to date while it is being
+    // edited. An edit re-lexes only the lines it touches and re-parses only the
+    // top level declarations that use those tokens, the rest are kept and the
+    // ones after the edit have their positions moved along. Parses in recover
+    // mode, the result is always the same as lexing and parsing the new text
+    // from scratch.
+    class incremental_parser
+    {
+    private:
+        std::unique_ptr<source_file> _source;
+        std::vector<token> _tokens;
+        std::vector<line_exception> _lexer_errors;
+
+        // The top level declarations, the index of the first token of each and
+        // the parse errors found in each.
+        std::vector<decl*> _decls;
+        std::vector<size_t> _decl_starts;
+        std::vector<std::vector<line_exception>> _decl_errors;
+
+        // Replaced declarations stay in the arena until everything is parsed
+        // again from scratch, which happens once they take up as much room as
+        // the live ones.
+        arena _arena;
+        size_t _full_parse_bytes;
+    public:
+        incremental_parser(std::string_view text);
+
+        incremental_parser(const incremental_parser&) = delete;
+        incremental_parser& operator=(const incremental_parser&) = delete;
+
+        void apply(const text_edit& edit);
+
+        // The current version of the file. Replaced by every edit, along with
+        // the errors that refer to it.
+        const source_file& source() const
+        {
+            return *_source;
+        }
+
+        const std::vector<token>& tokens() const
+        {
+            return _tokens;
+        }
+
+        const std::vector<decl*>& decls() const
+        {
+            return _decls;
+        }
+
+        const std::vector<line_exception>& lexer_errors() const
+        {
+            return _lexer_errors;
+        }
+
+        // Parse errors in source order.
+        std::vector<line_exception> parse_errors() const;
+    private:
+        void parse_all();
+
+        // Parses declarations from token index start until one would begin at
+        // one of reusable, the sorted token indices where declarations that are
+        // still valid begin. Returns the index in reusable it stopped at, or its
+        // size if it reached the end of the file.
+        size_t parse_decls(const source_file& source, size_t start, std::span<const size_t> reusable);
+    };
+}
@@ -1,5 +1,10 @@
 #include "parser.h"
 
+#include <array>
+#include <exception>
+
+#include "../util/thread_pool.h"
+
 namespace
 {
     arc::unary_op classify_unary_op(arc::token_type type, bool is_postfix = false)
@@ -23,111 +28,339 @@ namespace
         throw arc::internal_exception("invalid token type for unary operator");
     }
 
+    // Binding powers of the infix operators, higher binds tighter. Anything that
+    // is not an infix operator has no binding power, which ends an expression.
+    enum binding_power : uint8_t
+    {
+        none,
+        assignment = 2,
+        logical_or,
+        logical_and,
+        bitwise_or,
+        bitwise_xor,
+        bitwise_and,
+        equality,
+        relational,
+        shift,
+        additive,
+        multiplicative,
+        cast
+    };
+
+    struct infix_operator
+    {
+        uint8_t power = binding_power::none;
+        bool right_associative = false;
+        arc::binary_op op = {};
+    };
+
+    constexpr auto make_infix_operators()
+    {
+        std::array<infix_operator, size_t(arc::token_type::eof) + 1> table {};
+        auto add = [&](arc::token_type type, binding_power power, arc::binary_op op) {
+            table[size_t(type)] = { power, power == binding_power::assignment, op };
+        };
+
+        add(arc::token_type::as,          binding_power::cast,           {});
+        add(arc::token_type::asterix,     binding_power::multiplicative, arc::binary_op::mul);
+        add(arc::token_type::slash,       binding_power::multiplicative, arc::binary_op::div);
+        add(arc::token_type::percent,     binding_power::multiplicative, arc::binary_op::mod);
+        add(arc::token_type::plus,        binding_power::additive,       arc::binary_op::add);
+        add(arc::token_type::minus,       binding_power::additive,       arc::binary_op::sub);
+        add(arc::token_type::dbl_less,    binding_power::shift,          arc::binary_op::lshift);
+        add(arc::token_type::dbl_grtr,    binding_power::shift,          arc::binary_op::rshift);
+        add(arc::token_type::less,        binding_power::relational,     arc::binary_op::less);
+        add(arc::token_type::less_eq,     binding_power::relational,     arc::binary_op::less_eq);
+        add(arc::token_type::grtr,        binding_power::relational,     arc::binary_op::greater);
+        add(arc::token_type::grtr_eq,     binding_power::relational,     arc::binary_op::greater_eq);
+        add(arc::token_type::dbl_eq,      binding_power::equality,       arc::binary_op::equality);
+        add(arc::token_type::bang_eq,     binding_power::equality,       arc::binary_op::inequality);
+        add(arc::token_type::amp,         binding_power::bitwise_and,    arc::binary_op::bitwise_and);
+        add(arc::token_type::caret,       binding_power::bitwise_xor,    arc::binary_op::bitwise_xor);
+        add(arc::token_type::pipe,        binding_power::bitwise_or,     arc::binary_op::bitwise_or);
+        add(arc::token_type::dbl_amp,     binding_power::logical_and,    arc::binary_op::logical_and);
+        add(arc::token_type::dbl_pipe,    binding_power::logical_or,     arc::binary_op::logical_or);
+        add(arc::token_type::eq,          binding_power::assignment,     arc::binary_op::assign);
+        add(arc::token_type::plus_eq,     binding_power::assignment,     arc::binary_op::add_assign);
+        add(arc::token_type::minus_eq,    binding_power::assignment,     arc::binary_op::sub_assign);
+        add(arc::token_type::asterix_eq,  binding_power::assignment,     arc::binary_op::mul_assign);
+        add(arc::token_type::slash_eq,    binding_power::assignment,     arc::binary_op::div_assign);
+        add(arc::token_type::percent_eq,  binding_power::assignment,     arc::binary_op::mod_assign);
+        add(arc::token_type::dbl_less_eq, binding_power::assignment,     arc::binary_op::lshift_assign);
+        add(arc::token_type::dbl_grtr_eq, binding_power::assignment,     arc::binary_op::rshift_assign);
+        add(arc::token_type::amp_eq,      binding_power::assignment,     arc::binary_op::bitwise_and_assign);
+        add(arc::token_type::caret_eq,    binding_power::assignment,     arc::binary_op::bitwise_xor_assign);
+        add(arc::token_type::pipe_eq,     binding_power::assignment,     arc::binary_op::bitwise_or_assign);
+
+        return table;
+    }
+
+    constexpr auto infix_operators = make_infix_operators();
+
+    constexpr arc::token_set decl_keywords = {
+        arc::token_type::import_,
+        arc::token_type::namespace_,
+        arc::token_type::func,
+        arc::token_type::struct_,
+        arc::token_type::alias
+    };
+
+    constexpr arc::token_set stmt_keywords = {
+        arc::token_type::let,
+        arc::token_type::const_,
+        arc::token_type::return_,
+        arc::token_type::if_,
+        arc::token_type::l_curly
+    };
+
+    constexpr arc::token_set typespec_start = {
+        arc::token_type::asterix,
+        arc::token_type::identifier,
+        arc::token_type::l_paren
+    };
+
+    constexpr arc::token_set struct_member_start = {
+        arc::token_type::identifier,
+        arc::token_type::func
+    };
+
+    // Where a broken declaration resumes.
+    constexpr arc::token_set decl_sync = arc::token_set { arc::token_type::eof } | decl_keywords;
+
+    // A declaration can't appear in a block, seeing one means the '}' is missing.
+    constexpr arc::token_set block_end = arc::token_set { arc::token_type::r_curly } | decl_sync;
+
+    // Struct bodies hold member functions, any other declaration means the '}' is missing.
+    constexpr arc::token_set struct_end = {
+        arc::token_type::r_curly,
+        arc::token_type::eof,
+        arc::token_type::import_,
+        arc::token_type::namespace_,
+        arc::token_type::struct_,
+        arc::token_type::alias
+    };
+
+    // Splits tokens into runs of whole top level declarations of at least
+    // min_tokens each and returns where each run starts, followed by the end.
+    // Only a ';' or '}' outside of any braces followed by a declaration keyword
+    // ends a run, the parser is always back at the module level at that point,
+    // even when recovering from errors, since it never consumes a declaration
+    // keyword inside a declaration without also being inside its braces.
+    std::vector<size_t> split_declarations(std::span<const arc::token> tokens, size_t min_tokens)
+    {
+        std::vector<size_t> bounds = { 0 };
+        size_t depth = 0;
+        for(size_t i = 0; i + 1 < tokens.size(); i++)
+        {
+            auto type = tokens[i].type;
+            if(type == arc::token_type::l_curly)
+            {
+                depth++;
+            }
+            else if(type == arc::token_type::r_curly && depth > 0)
+            {
+                depth--;
+            }
+
+            if(depth == 0 && (type == arc::token_type::semi_colon || type == arc::token_type::r_curly)
+                && i + 1 - bounds.back() >= min_tokens && decl_keywords.contains(tokens[i + 1].type))
+            {
+                bounds.push_back(i + 1);
+            }
+        }
+        bounds.push_back(tokens.size());
+        return bounds;
+    }
+
     arc::binary_op classify_binary_op(arc::token_type type)
     {
-        switch(type)
+        const auto& info = infix_operators[size_t(type)];
+        if(info.power == binding_power::none || type == arc::token_type::as)
         {
-        case arc::token_type::plus:        return arc::binary_op::add;
-		case arc::token_type::minus:       return arc::binary_op::sub;
-		case arc::token_type::asterix:     return arc::binary_op::mul;
-		case arc::token_type::slash:       return arc::binary_op::div;
-		case arc::token_type::percent:     return arc::binary_op::mod;
-		case arc::token_type::dbl_less:    return arc::binary_op::lshift;
-		case arc::token_type::dbl_grtr:    return arc::binary_op::rshift;
-		case arc::token_type::less:        return arc::binary_op::less;
-		case arc::token_type::less_eq:     return arc::binary_op::less_eq;
-		case arc::token_type::grtr:        return arc::binary_op::greater;
-		case arc::token_type::grtr_eq:     return arc::binary_op::greater_eq;
-		case arc::token_type::dbl_eq:      return arc::binary_op::equality;
-		case arc::token_type::bang_eq:     return arc::binary_op::inequality;
-		case arc::token_type::amp:         return arc::binary_op::bitwise_and;
-		case arc::token_type::caret:       return arc::binary_op::bitwise_xor;
-		case arc::token_type::pipe:        return arc::binary_op::bitwise_or;
-		case arc::token_type::dbl_amp:     return arc::binary_op::logical_and;
-		case arc::token_type::dbl_pipe:    return arc::binary_op::logical_or;
-		case arc::token_type::eq:          return arc::binary_op::assign;
-		case arc::token_type::plus_eq:     return arc::binary_op::add_assign;
-		case arc::token_type::minus_eq:    return arc::binary_op::sub_assign;
-		case arc::token_type::asterix_eq:  return arc::binary_op::mul_assign;
-		case arc::token_type::slash_eq:    return arc::binary_op::div_assign;
-		case arc::token_type::percent_eq:  return arc::binary_op::mod_assign;
-		case arc::token_type::dbl_less_eq: return arc::binary_op::lshift_assign;
-		case arc::token_type::dbl_grtr_eq: return arc::binary_op::rshift_assign;
-		case arc::token_type::amp_eq:      return arc::binary_op::bitwise_and_assign;
-		case arc::token_type::caret_eq:    return arc::binary_op::bitwise_xor_assign;
-		case arc::token_type::pipe_eq:     return arc::binary_op::bitwise_or_assign;
-        }
-
-        throw arc::internal_exception("invalid token type for binary operator");
+            throw arc::internal_exception("invalid token type for binary operator");
+        }
+        return info.op;
     }
 }
 
 namespace arc
 {
-    parser::parser(const std::vector<token>& tokens, const source_file& source)
-        : _stream(tokens), _source(source)
+    deferred_bodies::deferred_bodies(const std::vector<token>& tokens, const source_file& source, arena& arena, parse_mode mode)
+        : _tokens(tokens), _source(source), _arena(arena), _mode(mode)
     {
     }
 
-    line_exception parser::parse_error(const std::string& msg)
+    void deferred_bodies::parse_body(const decl_func& func)
     {
-        return line_exception(msg, _source, _stream.position());
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(func.body_parsed())
+        {
+            return;
+        }
+
+        // The body ends in its '}', so there is always a token after it.
+        auto tokens = std::span(_tokens).subspan(func.body_begin, func.body_end - func.body_begin);
+        parser body_parser(tokens, _tokens[func.body_end].position, _source, _arena, _mode, nullptr);
+        auto body = body_parser.parse_stmt_block();
+
+        for(const auto& error : body_parser.errors())
+        {
+            _errors.push_back(error);
+        }
+        func.resolve_body(_arena.copy(body));
     }
 
-    std::shared_ptr<expr> parser::parse_expr0()
+    std::vector<line_exception> deferred_bodies::errors()
     {
-        auto token = _stream.expect_one_of({
-            token_type::boolean,
-            token_type::integer,
-            token_type::float_,
-            token_type::identifier,
-            token_type::l_paren
-        }, [&]() { throw parse_error("expected expression"); });
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _errors;
+    }
 
-        switch(token.type)
+    parser::parser(const std::vector<token>& tokens, const source_file& source, arena& arena, parse_mode mode)
+        : _stream(tokens), _source(source), _arena(arena), _deferred(nullptr), _mode(mode), _panic(false)
+    {
+    }
+
+    parser::parser(lexer& lexer, const source_file& source, arena& arena, parse_mode mode)
+        : _stream(lexer), _source(source), _arena(arena), _deferred(nullptr), _mode(mode), _panic(false)
+    {
+    }
+
+    parser::parser(const source_file& source, arena& arena, deferred_bodies& deferred)
+        : _stream(deferred._tokens), _source(source), _arena(arena), _deferred(&deferred), _mode(deferred._mode), _panic(false)
+    {
+    }
+
+    parser::parser(std::span<const token> tokens, source_pos end, const source_file& source, arena& arena, parse_mode mode, deferred_bodies* deferred)
+        : _stream(tokens, end), _source(source), _arena(arena), _deferred(deferred), _mode(mode), _panic(false)
+    {
+    }
+
+    token parser::expect(token_type type, const char* msg)
+    {
+        if(_stream.next_is(type))
+        {
+            return _stream.next();
+        }
+
+        error(msg);
+        return _stream.peek();
+    }
+
+    void parser::error(const std::string& msg)
+    {
+        if(_mode == parse_mode::strict)
+        {
+            throw line_exception(msg, _source, _stream.position());
+        }
+
+        if(!_panic)
+        {
+            _errors.emplace_back(msg, _source, _stream.position());
+            _panic = true;
+        }
+    }
+
+    // Skips to the end of the current statement: past the next ';' or block, or
+    // up to a '}' or the start of a declaration, which the enclosing block or
+    // module loop deals with. Nothing is skipped if the statement that started
+    // at start already ended.
+    void parser::synchronize(source_pos start)
+    {
+        _panic = false;
+        if(_stream.position().offset != start.offset && statement_ended())
+        {
+            return;
+        }
+
+        size_t depth = 0;
+        while(!_stream.next_is_one_of(decl_sync))
+        {
+            if(_stream.next_is(token_type::r_curly) && depth == 0)
+            {
+                return;
+            }
+
+            switch(_stream.next().type)
+            {
+            case token_type::semi_colon: {
+                if(depth == 0)
+                {
+                    return;
+                }
+            } break;
+            case token_type::l_curly: {
+                depth++;
+            } break;
+            case token_type::r_curly: {
+                if(--depth == 0)
+                {
+                    return;
+                }
+            } break;
+            }
+        }
+    }
+
+    bool parser::statement_ended()
+    {
+        auto previous = _stream.previous_type();
+        return previous == token_type::semi_colon || previous == token_type::r_curly;
+    }
+
+    // literal
+    // name
+    // (expr)
+    expr* parser::parse_primary()
+    {
+        switch(_stream.peek_type())
         {
         case token_type::boolean: {
-            return make_boolean_expr(token.val_boolean(), token.position);
+            auto token = _stream.next();
+            return make_boolean_expr(_arena, token.val_boolean(), token.position);
         } break;
         case token_type::integer: {
-            return make_integer_expr(token.val_integer(), token.position);
+            auto token = _stream.next();
+            return make_integer_expr(_arena, token.val_integer(), token.position);
         } break;
         case token_type::float_: {
-            return make_integer_expr(token.val_double(), token.position);
+            auto token = _stream.next();
+            return make_integer_expr(_arena, token.val_double(), token.position);
         } break;
         case token_type::identifier: {
-            return make_name_expr(token.val_string(), token.position);
+            auto token = _stream.next();
+            return make_name_expr(_arena, token.text(_source), token.val_symbol(), token.position);
         } break;
         case token_type::l_paren: {
+            _stream.next();
             auto expr = parse_expr();
-            _stream.expect(token_type::r_paren, [&](){ throw parse_error("expected ')'"); });
+            expect(token_type::r_paren, "expected ')'");
             return expr;
         } break;
         }
 
-        throw internal_exception("unreachable");
+        // Left for the caller to skip over, it may well be a '}' or ';' that
+        // ends the statement.
+        auto position = _stream.position();
+        error("expected expression");
+        return make_error_expr(_arena, position);
     }
     
-    // expr0(expr)
-    // expr0[expr]
-    // expr0.access
-    // expr0++
-    // expr0--
-    std::shared_ptr<expr> parser::parse_expr1()
-    {
-        auto base_expr = parse_expr0();
-
-        while(_stream.next_is_one_of({
-            token_type::l_paren,
-            token_type::l_square,
-            token_type::dot,
-            token_type::dbl_plus,
-            token_type::dbl_minus
-        })) {
+    // expr(expr)
+    // expr[expr]
+    // expr.access
+    // expr++
+    // expr--
+    expr* parser::parse_postfix()
+    {
+        auto base_expr = parse_primary();
+
+        while(true)
+        {
             switch(_stream.peek_type())
             {
             case token_type::l_paren: {
-                std::vector<std::shared_ptr<expr>> args;
+                std::vector<expr*> args;
 
                 auto token = _stream.next();
                 if(!_stream.next_is(token_type::r_paren))
@@ -139,35 +372,33 @@ namespace arc
                         args.push_back(parse_expr());
                     }
                 }
-                _stream.expect(token_type::r_paren, [&]() { throw parse_error("expected ')'"); });
+                expect(token_type::r_paren, "expected ')'");
 
-                base_expr = make_call_expr(base_expr, args, token.position);
+                base_expr = make_call_expr(_arena, base_expr, args, token.position);
             } break;
             case token_type::l_square: {
                 auto token = _stream.next();
                 auto index = parse_expr();
-                _stream.expect(token_type::r_square, [&]() { throw parse_error("expected ']'"); });
+                expect(token_type::r_square, "expected ']'");
 
-                base_expr = make_index_expr(base_expr, index, token.position);
+                base_expr = make_index_expr(_arena, base_expr, index, token.position);
             } break;
             case token_type::dot: {
                 auto token = _stream.next();
-                auto field = _stream.expect(token_type::identifier, [&]() { throw parse_error("expected a field name"); });
+                auto field = expect(token_type::identifier, "expected a field name");
 
-                base_expr = make_access_expr(base_expr, field.val_string(), token.position);
-            } break;
-            case token_type::dbl_plus: {
-                auto token = _stream.next();
-                base_expr = make_unary_expr(classify_unary_op(token.type, true), base_expr, token.position);
+                base_expr = make_access_expr(_arena, base_expr, field.text(_source), token.position);
             } break;
+            case token_type::dbl_plus:
             case token_type::dbl_minus: {
                 auto token = _stream.next();
-                base_expr = make_unary_expr(classify_unary_op(token.type, true), base_expr, token.position);
+                base_expr = make_unary_expr(_arena, classify_unary_op(token.type, true), base_expr, token.position);
+            } break;
+            default: {
+                return base_expr;
             } break;
             }
         }
-
-        return base_expr;
     }
 
     // +expr
@@ -178,315 +409,95 @@ namespace arc
     // &expr
     // ~expr
     // !expr
-    std::shared_ptr<expr> parser::parse_expr2()
-    {
-        if(_stream.next_is_one_of({
-            token_type::plus,
-            token_type::minus,
-            token_type::dbl_plus,
-            token_type::dbl_minus,
-            token_type::asterix,
-            token_type::amp,
-            token_type::tilde,
-            token_type::bang
-        })) {
+    expr* parser::parse_unary()
+    {
+        switch(_stream.peek_type())
+        {
+        case token_type::plus:
+        case token_type::minus:
+        case token_type::dbl_plus:
+        case token_type::dbl_minus:
+        case token_type::asterix:
+        case token_type::amp:
+        case token_type::tilde:
+        case token_type::bang: {
             auto token = _stream.next();
             auto op = classify_unary_op(token.type, false);
             return make_unary_expr(
+                _arena,
                 op,
-                parse_expr2(),
+                parse_unary(),
                 token.position
             );
+        } break;
         }
 
-        return parse_expr1();
+        return parse_postfix();
     }
 
+    // lhs op rhs
     // expr as type
-    std::shared_ptr<expr> parser::parse_expr3()
-    {
-        auto expr = parse_expr2();
-
-        while(_stream.next_is(token_type::as))
+    //
+    // Binds every infix operator that binds tighter than min_power, the binding
+    // powers come from the infix operator table. Assignments are right associative,
+    // everything else is left associative.
+    expr* parser::parse_binary(uint8_t min_power)
+    {
+        auto expr = parse_unary();
+        while(true)
         {
-            auto token = _stream.next();
-
-            expr = make_cast_expr(
-                expr,
-                parse_typespec(),
-                token.position
-            );
-        }
-
-        return expr;
-    }
-
-    // lhs * rhs
-    // lhs / rhs
-    // lhs % rhs
-    std::shared_ptr<expr> parser::parse_expr4()
-    {
-        auto expr = parse_expr3();
-        while(_stream.next_is_one_of({
-            token_type::asterix,
-            token_type::slash,
-            token_type::percent
-        })) {
-            auto token = _stream.next();
-            auto op = classify_binary_op(token.type);
-            expr = make_binary_expr(
-                op,
-                expr,
-                parse_expr3(),
-                token.position
-            );
-        }
-        return expr;
-    }
-
-    // lhs + rhs
-    // lhs - rhs
-    std::shared_ptr<expr> parser::parse_expr5()
-    {
-        auto expr = parse_expr4();
-        while(_stream.next_is_one_of({
-            token_type::plus,
-            token_type::minus
-        })) {
-            auto token = _stream.next();
-            auto op = classify_binary_op(token.type);
-            expr = make_binary_expr(
-                op,
-                expr,
-                parse_expr4(),
-                token.position
-            );
-        }
-        return expr;
-    }
-
-    // lhs << rhs
-    // lhs >> rhs
-    std::shared_ptr<expr> parser::parse_expr6()
-    {
-        auto expr = parse_expr5();
-        while(_stream.next_is_one_of({
-            token_type::dbl_less,
-            token_type::dbl_grtr
-        })) {
-            auto token = _stream.next();
-            auto op = classify_binary_op(token.type);
-            expr = make_binary_expr(
-                op,
-                expr,
-                parse_expr5(),
-                token.position
-            );
-        }
-        return expr;
-    }
-
-    // lhs < rhs
-    // lhs <= rhs
-    // lhs > rhs
-    // lhs >= rhs
-    std::shared_ptr<expr> parser::parse_expr7()
-    {
-        auto expr = parse_expr6();
-        while(_stream.next_is_one_of({
-            token_type::less,
-            token_type::less_eq,
-            token_type::grtr,
-            token_type::grtr_eq
-        })) {
-            auto token = _stream.next();
-            auto op = classify_binary_op(token.type);
-            expr = make_binary_expr(
-                op,
-                expr,
-                parse_expr6(),
-                token.position
-            );
-        }
-        return expr;
-    }
-
-    // lhs == rhs
-    // lhs != rhs
-    std::shared_ptr<expr> parser::parse_expr8()
-    {
-        auto expr = parse_expr7();
-        while(_stream.next_is_one_of({
-            token_type::dbl_eq,
-            token_type::bang_eq
-        })) {
-            auto token = _stream.next();
-            auto op = classify_binary_op(token.type);
-            expr = make_binary_expr(
-                op,
-                expr,
-                parse_expr7(),
-                token.position
-            );
-        }
-        return expr;
-    }
-
-    // lhs & rhs
-    std::shared_ptr<expr> parser::parse_expr9()
-    {
-        auto expr = parse_expr8();
-        while(_stream.next_is_one_of({
-            token_type::amp
-        })) {
-            auto token = _stream.next();
-            auto op = classify_binary_op(token.type);
-            expr = make_binary_expr(
-                op,
-                expr,
-                parse_expr8(),
-                token.position
-            );
-        }
-        return expr;
-    }
+            auto type = _stream.peek_type();
+            const auto& info = infix_operators[size_t(type)];
+            if(info.power <= min_power)
+            {
+                return expr;
+            }
 
-    // lhs ^ rhs
-    std::shared_ptr<expr> parser::parse_expr10()
-    {
-        auto expr = parse_expr9();
-        while(_stream.next_is_one_of({
-            token_type::caret
-        })) {
             auto token = _stream.next();
-            auto op = classify_binary_op(token.type);
-            expr = make_binary_expr(
-                op,
-                expr,
-                parse_expr9(),
-                token.position
-            );
-        }
-        return expr;
-    }
+            if(type == token_type::as)
+            {
+                expr = make_cast_expr(
+                    _arena,
+                    expr,
+                    parse_typespec(),
+                    token.position
+                );
+                continue;
+            }
 
-    // lhs | rhs
-    std::shared_ptr<expr> parser::parse_expr11()
-    {
-        auto expr = parse_expr10();
-        while(_stream.next_is_one_of({
-            token_type::pipe
-        })) {
-            auto token = _stream.next();
-            auto op = classify_binary_op(token.type);
             expr = make_binary_expr(
-                op,
+                _arena,
+                classify_binary_op(type),
                 expr,
-                parse_expr10(),
+                parse_binary(info.right_associative ? info.power - 1 : info.power),
                 token.position
             );
         }
-        return expr;
     }
 
-    // lhs && rhs
-    std::shared_ptr<expr> parser::parse_expr12()
+    expr* parser::parse_expr()
     {
-        auto expr = parse_expr11();
-        while(_stream.next_is_one_of({
-            token_type::dbl_amp
-        })) {
-            auto token = _stream.next();
-            auto op = classify_binary_op(token.type);
-            expr = make_binary_expr(
-                op,
-                expr,
-                parse_expr11(),
-                token.position
-            );
-        }
-        return expr;
+        return parse_binary(binding_power::none);
     }
 
-    // lhs || rhs
-    std::shared_ptr<expr> parser::parse_expr13()
+    typespec* parser::parse_typespec()
     {
-        auto expr = parse_expr12();
-        while(_stream.next_is_one_of({
-            token_type::dbl_pipe
-        })) {
-            auto token = _stream.next();
-            auto op = classify_binary_op(token.type);
-            expr = make_binary_expr(
-                op,
-                expr,
-                parse_expr12(),
-                token.position
-            );
-        }
-        return expr;
-    }
-
-    // lhs = rhs
-    // lhs += rhs
-    // lhs -= rhs
-    // lhs *= rhs
-    // lhs /= rhs
-    // lhs %= rhs
-    // lhs <<= rhs
-    // lhs >>= rhs
-    // lhs &= rhs
-    // lhs ^= rhs
-    // lhs |= rhs
-    std::shared_ptr<expr> parser::parse_expr14()
-    {
-        auto expr = parse_expr13();
-        if(_stream.next_is_one_of({
-            token_type::eq,
-            token_type::plus_eq,
-            token_type::minus_eq,
-            token_type::asterix_eq,
-            token_type::slash_eq,
-            token_type::percent_eq,
-            token_type::dbl_less_eq,
-            token_type::dbl_grtr_eq,
-            token_type::amp_eq,
-            token_type::caret_eq,
-            token_type::pipe_eq
-        })) {
-            auto token = _stream.next();
-            auto op = classify_binary_op(token.type);
-            return make_binary_expr(
-                op,
-                expr,
-                parse_expr14(),
-                token.position
-            );
+        if(!_stream.next_is_one_of(typespec_start))
+        {
+            auto position = _stream.position();
+            error("expected a type");
+            return make_error_typespec(_arena, position);
         }
-        return expr;
-    }
-
-    std::shared_ptr<expr> parser::parse_expr()
-    {
-        return parse_expr14();
-    }
-
-    std::shared_ptr<typespec> parser::parse_typespec()
-    {
-        auto token = _stream.expect_one_of({
-            token_type::asterix,
-            token_type::identifier,
-            token_type::l_paren
-        }, [&]() { throw parse_error("expected a type"); });
 
+        auto token = _stream.next();
         switch(token.type)
         {
         case token_type::identifier: {
-            return make_name_typespec(token.val_string(), token.position);
+            return make_name_typespec(_arena, token.text(_source), token.position);
         } break;
         case token_type::l_paren: {
             // arguments
-            std::vector<std::shared_ptr<typespec>> args;
+            std::vector<typespec*> args;
             if(!_stream.next_is(token_type::r_paren))
             {
                 args.push_back(parse_typespec());
@@ -496,113 +507,120 @@ namespace arc
                     args.push_back(parse_typespec());
                 }
             }
-            _stream.expect(token_type::r_paren, [&]() { throw parse_error("expected ')'"); });
-            _stream.expect(token_type::colon, [&]() { throw parse_error("expected ':'"); });
+            expect(token_type::r_paren, "expected ')'");
+            expect(token_type::colon, "expected ':'");
 
             auto return_type = parse_typespec();
 
-            return make_func_typespec(args, return_type, token.position);  
+            return make_func_typespec(_arena, args, return_type, token.position);  
         } break;
         case token_type::asterix: {
-            return make_pointer_typespec(parse_typespec(), token.position);
+            return make_pointer_typespec(_arena, parse_typespec(), token.position);
         } break;
         }
 
         throw internal_exception("unreachable");
     }
 
-    std::shared_ptr<stmt_let> parser::parse_stmt_let()
+    stmt_let* parser::parse_stmt_let()
     {
-        auto token = _stream.expect(token_type::let, [&]() { throw parse_error("expected 'let'"); });
-        auto name = _stream.expect(token_type::identifier, [&]() { throw parse_error("expected variable name"); });
+        auto token = expect(token_type::let, "expected 'let'");
+        auto name = expect(token_type::identifier, "expected variable name");
 
-        std::shared_ptr<typespec> type = nullptr;
+        typespec* type = nullptr;
         if(_stream.next_is(token_type::colon))
         {
             _stream.next();
             type = parse_typespec();
         }
 
-        std::shared_ptr<expr> initializer = nullptr;
+        expr* initializer = nullptr;
         if(_stream.next_is(token_type::eq))
         {
             _stream.next();
             initializer = parse_expr();
         }
 
-        _stream.expect(token_type::semi_colon, [&]() { throw parse_error("expected ';'"); });
-        return make_let_stmt(name.val_string(), type, initializer, token.position);
+        expect(token_type::semi_colon, "expected ';'");
+        return make_let_stmt(_arena, name.text(_source), name.val_symbol(), type, initializer, token.position);
     }
 
-    std::shared_ptr<stmt_const> parser::parse_stmt_const()
+    stmt_const* parser::parse_stmt_const()
     {
-        auto token = _stream.expect(token_type::const_, [&]() { throw parse_error("expected 'const'"); });
-        auto name = _stream.expect(token_type::identifier, [&]() { throw parse_error("expected variable name"); });
+        auto token = expect(token_type::const_, "expected 'const'");
+        auto name = expect(token_type::identifier, "expected variable name");
         
-        std::shared_ptr<typespec> type = nullptr;
+        typespec* type = nullptr;
         if(_stream.next_is(token_type::colon))
         {
             _stream.next();
             type = parse_typespec();
         }
 
-        std::shared_ptr<expr> initializer = nullptr;
+        expr* initializer = nullptr;
         if(_stream.next_is(token_type::eq))
         {
             _stream.next();
             initializer = parse_expr();
         }
 
-        _stream.expect(token_type::semi_colon, [&]() { throw parse_error("expected ';'"); });
-        return make_const_stmt(name.val_string(), type, initializer, token.position);
+        expect(token_type::semi_colon, "expected ';'");
+        return make_const_stmt(_arena, name.text(_source), name.val_symbol(), type, initializer, token.position);
     }
 
-    std::shared_ptr<stmt_return> parser::parse_stmt_return()
+    stmt_return* parser::parse_stmt_return()
     {
-        auto token = _stream.expect(token_type::return_, [&]() { throw parse_error("expected 'return'"); });
-        std::shared_ptr<expr> ret_expr = nullptr;
+        auto token = expect(token_type::return_, "expected 'return'");
+        expr* ret_expr = nullptr;
         if(!_stream.next_is(token_type::semi_colon))
         {
             ret_expr = parse_expr();
         }
-        _stream.expect(token_type::semi_colon, [&]() { throw parse_error("expected ';'"); });
-        return make_return_stmt(ret_expr, token.position);
+        expect(token_type::semi_colon, "expected ';'");
+        return make_return_stmt(_arena, ret_expr, token.position);
     }
 
-    std::shared_ptr<stmt_if> parser::parse_stmt_if()
+    stmt_if* parser::parse_stmt_if()
     {
-        auto token = _stream.expect(token_type::if_, [&]() { throw parse_error("expected 'if'"); });
+        auto token = expect(token_type::if_, "expected 'if'");
         std::vector<if_branch> if_branches;
         auto expr = parse_expr();
         auto block = parse_stmt_block();
-        if_branches.emplace_back(expr, block);
+        if_branches.push_back(make_if_branch(_arena, expr, block));
         while(_stream.next_is(token_type::elif))
         {
             _stream.next();
             auto expr = parse_expr();
             auto block = parse_stmt_block();
-            if_branches.emplace_back(expr, block);
+            if_branches.push_back(make_if_branch(_arena, expr, block));
         }
 
-        std::vector<std::shared_ptr<stmt>> else_branch;
+        std::vector<stmt*> else_branch;
         if(_stream.next_is(token_type::else_))
         {
             _stream.next();
             else_branch = parse_stmt_block();
         }
 
-        return make_if_stmt(if_branches, else_branch, token.position);
+        return make_if_stmt(_arena, if_branches, else_branch, token.position);
+    }
+
+    stmt* parser::parse_stmt()
+    {
+        auto position = _stream.position();
+        auto stmt = parse_stmt_inner();
+        if(_panic)
+        {
+            synchronize(position);
+            return make_error_stmt(_arena, position);
+        }
+        return stmt;
     }
 
-    std::shared_ptr<stmt> parser::parse_stmt()
+    stmt* parser::parse_stmt_inner()
     {
-        if(_stream.next_is_one_of({
-            token_type::let,
-            token_type::const_,
-            token_type::return_,
-            token_type::if_,
-            token_type::l_curly
-        })) {
+        if(_stream.next_is_one_of(stmt_keywords))
+        {
             switch(_stream.peek_type())
             {
             case token_type::let: {
@@ -618,60 +636,97 @@ namespace arc
                 return parse_stmt_if();
             } break;
             case token_type::l_curly: {
-                return make_block_stmt(parse_stmt_block());
+                auto position = _stream.position();
+                return make_block_stmt(_arena, parse_stmt_block(), position);
             } break;
             }
         } else {
             auto expr = parse_expr();
-            _stream.expect(token_type::semi_colon, [&]() { throw parse_error("expected ';'"); });
-            return make_expr_stmt(expr, expr->position);
+            expect(token_type::semi_colon, "expected ';'");
+            return make_expr_stmt(_arena, expr, expr->position);
         }
 
         throw internal_exception("unreachable");
     }
     
-    std::vector<std::shared_ptr<stmt>> parser::parse_stmt_block()
+    std::vector<stmt*> parser::parse_stmt_block()
     {
-        std::vector<std::shared_ptr<stmt>> block;
-        _stream.expect(token_type::l_curly, [&]() { throw parse_error("expected '{'"); });
-        while(!_stream.next_is(token_type::r_curly))
+        std::vector<stmt*> block;
+        // Whatever this block belongs to is broken, leave the whole block to be
+        // skipped along with it.
+        if(_panic)
+        {
+            return block;
+        }
+
+        expect(token_type::l_curly, "expected '{'");
+        if(_panic)
+        {
+            return block;
+        }
+
+        while(!_stream.next_is_one_of(block_end))
         {
             block.push_back(parse_stmt());
         }
-        _stream.expect(token_type::r_curly, [&]() { throw parse_error("expected '}'"); });
+        expect(token_type::r_curly, "expected '}'");
         return block;
     }
  
-    std::shared_ptr<decl_import> parser::parse_decl_import()
+    // Skips over a block without parsing it and returns the end of it, or
+    // nullptr if the '}' is missing. Ends up where parse_stmt_block would on a
+    // block it can parse, a declaration keyword ends a block early either way.
+    const token* parser::skip_stmt_block()
+    {
+        size_t depth = 0;
+        while(!_stream.next_is_one_of(decl_sync))
+        {
+            auto type = _stream.peek_type();
+            auto end = _stream.current() + 1;
+            _stream.next();
+
+            if(type == token_type::l_curly)
+            {
+                depth++;
+            }
+            else if(type == token_type::r_curly && --depth == 0)
+            {
+                return end;
+            }
+        }
+        return nullptr;
+    }
+
+    decl_import* parser::parse_decl_import()
     {
-        auto token = _stream.expect(token_type::import_, [&]() { throw parse_error("expected 'import'"); });
-        auto path = _stream.expect(token_type::identifier, [&]() { throw parse_error("expected an import name"); });
-        _stream.expect(token_type::semi_colon, [&]() { throw parse_error("expected ';'"); });
-        return make_import_decl(path.val_string(), token.position);
+        auto token = expect(token_type::import_, "expected 'import'");
+        auto path = expect(token_type::identifier, "expected an import name");
+        expect(token_type::semi_colon, "expected ';'");
+        return make_import_decl(_arena, path.text(_source), token.position);
     }
 
-    std::shared_ptr<decl_namespace> parser::parse_decl_namespace()
+    decl_namespace* parser::parse_decl_namespace()
     {
-        auto token = _stream.expect(token_type::namespace_, [&]() { throw parse_error("expected 'namespace'"); });
-        auto name = _stream.expect(token_type::identifier, [&]() { throw parse_error("expected a namespace name"); });
-        _stream.expect(token_type::semi_colon, [&]() { throw parse_error("expected ';'"); });
-        return make_namespace_decl(name.val_string(), token.position);
+        auto token = expect(token_type::namespace_, "expected 'namespace'");
+        auto name = expect(token_type::identifier, "expected a namespace name");
+        expect(token_type::semi_colon, "expected ';'");
+        return make_namespace_decl(_arena, name.text(_source), token.position);
     }
 
-    std::shared_ptr<decl_func> parser::parse_decl_func()
+    decl_func* parser::parse_decl_func()
     {
-        auto token = _stream.expect(token_type::func, [&]() { throw parse_error("expected 'func''"); });
-        auto name = _stream.expect(token_type::identifier, [&]() { throw parse_error("expected a function name"); });
+        auto token = expect(token_type::func, "expected 'func''");
+        auto name = expect(token_type::identifier, "expected a function name");
 
         auto parse_named_arg = [&]() {
-            auto name = _stream.expect(token_type::identifier, [&]() { throw parse_error("expected a variable name"); });
-            _stream.expect(token_type::colon, [&]() { throw parse_error("expected ':'"); });
+            auto name = expect(token_type::identifier, "expected a variable name");
+            expect(token_type::colon, "expected ':'");
             auto type = parse_typespec();
-            return func_arg(name.val_string(), type);
+            return func_arg(_arena.copy(name.text(_source)), name.val_symbol(), type);
         };
 
         std::vector<func_arg> args;
-        _stream.expect(token_type::l_paren, [&]() { throw parse_error("expected '('"); });
+        expect(token_type::l_paren, "expected '('");
         if(!_stream.next_is(token_type::r_paren))
         {
             args.push_back(parse_named_arg());
@@ -681,72 +736,115 @@ namespace arc
                 args.push_back(parse_named_arg());
             }
         }
-        _stream.expect(token_type::r_paren, [&]() { throw parse_error("expected ')'"); });
-        _stream.expect(token_type::colon, [&]() { throw parse_error("expected ':'"); });
+        expect(token_type::r_paren, "expected ')'");
+        expect(token_type::colon, "expected ':'");
         auto ret_type = parse_typespec();
+
+        if(_deferred != nullptr && !_panic && _stream.next_is(token_type::l_curly))
+        {
+            auto begin = _stream.current();
+            auto end = skip_stmt_block();
+            if(end == nullptr)
+            {
+                error("expected '}'");
+                return make_func_decl(_arena, name.text(_source), args, ret_type, {}, token.position);
+            }
+
+            auto base = _deferred->_tokens.data();
+            return make_lazy_func_decl(_arena, name.text(_source), args, ret_type, _deferred, uint32_t(begin - base), uint32_t(end - base), token.position);
+        }
+
         auto body = parse_stmt_block();
 
-        return make_func_decl(name.val_string(), args, ret_type, body, token.position);
+        return make_func_decl(_arena, name.text(_source), args, ret_type, body, token.position);
     }
 
-    std::shared_ptr<decl_struct> parser::parse_decl_struct()
+    decl_struct* parser::parse_decl_struct()
     {
-        auto token = _stream.expect(token_type::struct_, [&]() { throw parse_error("expected 'struct''"); });
-        auto name = _stream.expect(token_type::identifier, [&]() { throw parse_error("expected a struct name"); });
+        auto token = expect(token_type::struct_, "expected 'struct''");
+        auto name = expect(token_type::identifier, "expected a struct name");
 
         std::vector<struct_field> fields;
-        std::vector<std::shared_ptr<decl_func>> functions;
+        std::vector<decl_func*> functions;
 
-        _stream.expect(token_type::l_curly, [&]() { throw parse_error("expected '{'"); });
-        while(!_stream.next_is(token_type::r_curly))
+        expect(token_type::l_curly, "expected '{'");
+        while(!_stream.next_is_one_of(struct_end))
         {
-            if(_stream.next_is_one_of({
-                token_type::identifier,
-                token_type::func
-            })) {
+            auto position = _stream.position();
+            if(_stream.next_is_one_of(struct_member_start))
+            {
                 switch(_stream.peek_type())
                 {
                 case token_type::identifier: {
-                    auto name = _stream.expect(token_type::identifier, [&]() { throw parse_error("expected variable name"); });
-                    _stream.expect(token_type::colon, [&]() { throw parse_error("expected ':'"); });
+                    auto name = expect(token_type::identifier, "expected variable name");
+                    expect(token_type::colon, "expected ':'");
                     auto type = parse_typespec();
-                    _stream.expect(token_type::semi_colon, [&]() { throw parse_error("expected ';'"); });
-                    fields.emplace_back(name.val_string(), type);
+                    expect(token_type::semi_colon, "expected ';'");
+                    if(!_panic)
+                    {
+                        fields.emplace_back(_arena.copy(name.text(_source)), type);
+                    }
                 } break;
                 case token_type::func: {
-                    functions.push_back(parse_decl_func());
+                    auto function = parse_decl_func();
+                    if(!_panic)
+                    {
+                        functions.push_back(function);
+                    }
                 } break;
                 }
             }
             else
             {
-                throw parse_error("expected field or member function");
+                error("expected field or member function");
+                _stream.next();
+            }
+
+            if(_panic)
+            {
+                synchronize(position);
             }
         }
-        _stream.expect(token_type::r_curly, [&]() { throw parse_error("expected '}'"); });
+        expect(token_type::r_curly, "expected '}'");
 
-        return make_struct_decl(name.val_string(), fields, functions, token.position);
+        return make_struct_decl(_arena, name.text(_source), fields, functions, token.position);
     }
 
-    std::shared_ptr<decl_alias> parser::parse_decl_alias()
+    decl_alias* parser::parse_decl_alias()
     {
-        auto token = _stream.expect(token_type::alias, [&]() { throw parse_error("expected 'alias''"); });
-        auto name = _stream.expect(token_type::identifier, [&]() { throw parse_error("expected a type name"); });
-        _stream.expect(token_type::eq, [&]() { throw parse_error("expected '='"); });
+        auto token = expect(token_type::alias, "expected 'alias''");
+        auto name = expect(token_type::identifier, "expected a type name");
+        expect(token_type::eq, "expected '='");
         auto type = parse_typespec();
-        _stream.expect(token_type::semi_colon, [&]() { throw parse_error("expected ';'"); });
-        return make_alias_decl(name.val_string(), type, token.position);
+        expect(token_type::semi_colon, "expected ';'");
+        return make_alias_decl(_arena, name.text(_source), type, token.position);
     }
 
-    std::shared_ptr<decl> parser::parse_decl()
+    decl* parser::parse_decl()
     {
-        if(_stream.next_is_one_of({
-            token_type::import_,
-            token_type::namespace_,
-            token_type::func,
-            token_type::struct_,
-            token_type::alias
-        })) {
+        auto position = _stream.position();
+        auto decl = parse_decl_inner();
+        if(_panic)
+        {
+            // Nothing inside a broken declaration can be trusted, skip straight
+            // to the next one unless it was cut short by its own ';' or '}'.
+            if(!statement_ended())
+            {
+                while(!_stream.next_is_one_of(decl_sync))
+                {
+                    _stream.next();
+                }
+            }
+            _panic = false;
+            return make_error_decl(_arena, position);
+        }
+        return decl;
+    }
+
+    decl* parser::parse_decl_inner()
+    {
+        if(_stream.next_is_one_of(decl_keywords))
+        {
             switch(_stream.peek_type())
             {
             case token_type::import_: {
@@ -768,20 +866,84 @@ namespace arc
         }
         else
         {
-            throw parse_error("expected a declaration");
+            error("expected a declaration");
+            if(!_stream.next_is(token_type::eof))
+            {
+                _stream.next();
+            }
+            return nullptr;
         }
 
         throw internal_exception("unreachable");
     }
 
     
-    std::vector<std::shared_ptr<decl>> parser::parse_module()
+    std::vector<decl*> parser::parse_module()
     {
-        std::vector<std::shared_ptr<decl>> decls;
+        std::vector<decl*> decls;
         while(!_stream.next_is(token_type::eof))
         {
             decls.push_back(parse_decl());
         }
         return decls;
     }
+
+    std::vector<decl*> parser::parse_module(thread_pool& pool, size_t min_chunk_tokens)
+    {
+        if(_stream.streaming() || pool.size() == 1)
+        {
+            return parse_module();
+        }
+
+        // The trailing eof is left out, each run gets an eof of its own placed
+        // where the next one starts.
+        auto tokens = _stream.remaining();
+        tokens = tokens.first(tokens.size() - 1);
+        auto bounds = split_declarations(tokens, std::max(min_chunk_tokens, tokens.size() / (pool.size() * 4) + 1));
+
+        struct chunk
+        {
+            arena nodes;
+            std::vector<decl*> decls;
+            std::vector<line_exception> errors;
+            std::exception_ptr failure;
+        };
+
+        auto chunks = bounds.size() - 1;
+        std::vector<chunk> results(chunks);
+        pool.parallel_for(chunks, [&](size_t i) {
+            auto& result = results[i];
+            auto end = bounds[i + 1] < tokens.size() ? tokens[bounds[i + 1]].position : _stream.remaining().back().position;
+            try
+            {
+                parser chunk_parser(tokens.subspan(bounds[i], bounds[i + 1] - bounds[i]), end, _source, result.nodes, _mode, _deferred);
+                result.decls = chunk_parser.parse_module();
+                result.errors = std::move(chunk_parser._errors);
+            }
+            catch(...)
+            {
+                result.failure = std::current_exception();
+            }
+        });
+
+        // Runs after a failed one are thrown away, in strict mode the serial
+        // parse would have stopped there too. Whatever a run threw is thrown
+        // again here, so nothing escapes onto the pool's threads.
+        std::vector<decl*> decls;
+        for(auto& result : results)
+        {
+            _arena.absorb(std::move(result.nodes));
+            if(result.failure)
+            {
+                std::rethrow_exception(result.failure);
+            }
+
+            decls.insert(decls.end(), result.decls.begin(), result.decls.end());
+            for(const auto& error : result.errors)
+            {
+                _errors.push_back(error);
+            }
+        }
+        return decls;
+    }
 }
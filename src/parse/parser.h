@@ -1,25 +1,71 @@
 #pragma once
 
+#include <mutex>
+#include <span>
 #include <vector>
-#include <initializer_list>
-#include <functional>
 
 #include "../lex/token.h"
+#include "../lex/lexer.h"
 #include "ast.h"
 #include "../error/exceptions.h"
 
 namespace arc
 {
+    class thread_pool;
+
     class token_stream
     {
     private:
-        const std::vector<token>& _tokens;
-
+        // The tokens currently available, either a whole lexed file or the
+        // latest batch pulled from a lexer in streaming mode.
+        const token* _tokens;
+        size_t _count;
         size_t _ptr;
+
+        lexer* _lexer;
+        std::vector<token> _buffer;
+
+        // Where the eof after a slice of tokens is placed.
+        source_pos _end;
+
+        token_type _previous;
     public:
+        // Number of tokens pulled from the lexer at a time when streaming.
+        static constexpr size_t stream_batch_size = 256;
+
         token_stream(const std::vector<token>& tokens)
-            : _tokens(tokens), _ptr(0)
+            : _tokens(tokens.data()), _count(tokens.size()), _ptr(0), _lexer(nullptr), _previous(token_type::eof)
+        {
+        }
+
+        // A slice of a token array that doesn't end in eof, an eof at the given
+        // position is produced once the slice runs out.
+        token_stream(std::span<const token> tokens, source_pos end)
+            : _tokens(tokens.data()), _count(tokens.size()), _ptr(0), _lexer(nullptr), _end(end), _previous(token_type::eof)
+        {
+            if(_count == 0)
+            {
+                refill();
+            }
+        }
+
+        token_stream(lexer& lexer)
+            : _tokens(nullptr), _count(0), _ptr(0), _lexer(&lexer), _previous(token_type::eof)
+        {
+            _buffer.reserve(stream_batch_size + 1);
+            refill();
+        }
+
+        bool streaming() const
         {
+            return _lexer != nullptr;
+        }
+
+        // The tokens that haven't been consumed yet. Only the whole rest of the
+        // file when not streaming.
+        std::span<const token> remaining() const
+        {
+            return { _tokens + _ptr, _count - _ptr };
         }
 
         source_pos position() const
@@ -29,7 +75,13 @@ namespace arc
 
         token next()
         {
-            return _tokens[_ptr++];
+            auto token = _tokens[_ptr++];
+            if(_ptr == _count)
+            {
+                refill();
+            }
+            _previous = token.type;
+            return token;
         }
 
         token_type peek_type() const
@@ -37,100 +89,178 @@ namespace arc
             return _tokens[_ptr].type;
         }
 
-        token expect_one_of(const std::initializer_list<token_type>& types, std::function<void()> cb)
+        // Type of the last token returned by next(), eof before the first one.
+        token_type previous_type() const
         {
-            for(const auto& expected : types)
-            {
-                if(peek_type() == expected)
-                {
-                    return next();
-                }
-            }
+            return _previous;
+        }
 
-            cb();
+        token peek() const
+        {
             return _tokens[_ptr];
         }
 
-        token expect(token_type type, std::function<void()> cb)
+        // Where the next token is stored, only meaningful when not streaming.
+        const token* current() const
         {
-            if(peek_type() == type)
-            {
-                return next();
-            }
+            return _tokens + _ptr;
+        }
 
-            cb();
-            return _tokens[_ptr];
+        bool next_is_one_of(const token_set& types) const
+        {
+            return types.contains(peek_type());
         }
-        
-        bool next_is_one_of(const std::initializer_list<token_type>& types)
+
+        bool next_is(token_type type) const
+        {
+            return peek_type() == type;
+        }
+    private:
+        void refill()
         {
-            for(const auto& type : types)
+            // The eof token is always the last one, keep pointing at it rather
+            // than asking for more.
+            if(_count != 0 && _tokens[_count - 1].type == token_type::eof)
             {
-                if(peek_type() == type)
-                {
-                    return true;
-                }
+                _ptr--;
+                return;
             }
-            return false;
-        }
 
-        bool next_is(token_type type)
-        {
-            if(peek_type() == type)
+            _buffer.clear();
+            if(_lexer != nullptr)
             {
-                return true;
+                _lexer->lex_some(_buffer, stream_batch_size);
             }
-            return false;
+            else
+            {
+                _buffer.emplace_back(token_type::eof, token_payload(), _end, 0);
+            }
+
+            _tokens = _buffer.data();
+            _count = _buffer.size();
+            _ptr = 0;
         }
     };
 
+    enum class parse_mode
+    {
+        // Throw a line_exception on the first error.
+        strict,
+        // Record errors, put error nodes in the ast and carry on after the next
+        // statement or declaration boundary.
+        recover
+    };
+
+    class parser;
+
+    // Parses the function bodies a lazy parse skipped over, the first time each
+    // one is asked for. Bodies are parsed one at a time under a lock and their
+    // nodes go in the arena given here, so it, the tokens and this object must
+    // all outlive the ast.
+    class deferred_bodies : public body_parser
+    {
+    private:
+        const std::vector<token>& _tokens;
+        const source_file& _source;
+        arena& _arena;
+        const parse_mode _mode;
+
+        std::mutex _mutex;
+        std::vector<line_exception> _errors;
+
+        friend class parser;
+    public:
+        deferred_bodies(const std::vector<token>& tokens, const source_file& source, arena& arena, parse_mode mode = parse_mode::strict);
+
+        // Throws the first error in the body in strict mode.
+        void parse_body(const decl_func& func) override;
+
+        // Errors found in the bodies parsed so far, in recover mode.
+        std::vector<line_exception> errors();
+    };
+
     class parser
     {
     private:
         const source_file& _source;
         token_stream _stream;
+        arena& _arena;
+
+        // Set in lazy mode, function bodies are skipped and left to it.
+        deferred_bodies* const _deferred;
+
+        friend class deferred_bodies;
+        friend class incremental_parser;
+
+        const parse_mode _mode;
+        // Set from an error until the parser has synchronized again, errors in
+        // between are knock-on effects of the first one and are dropped.
+        bool _panic;
+        std::vector<line_exception> _errors;
     public:
-        parser(const std::vector<token>& tokens, const source_file& source);
+        // Nodes are allocated in the given arena, which must outlive the ast.
+        parser(const std::vector<token>& tokens, const source_file& source, arena& arena, parse_mode mode = parse_mode::strict);
 
-        std::shared_ptr<expr> parse_expr();
+        // Pulls tokens from the lexer as they are needed instead of lexing the
+        // whole file up front. Lexer errors are left in the lexer.
+        parser(lexer& lexer, const source_file& source, arena& arena, parse_mode mode = parse_mode::strict);
+
+        // Lazy mode, only the signatures of functions are parsed and the bodies
+        // are left to deferred. Parses deferred's tokens, since the bodies are
+        // kept as ranges of them, and takes its parse mode as well.
+        parser(const source_file& source, arena& arena, deferred_bodies& deferred);
+
+        // Errors recorded in recover mode, in source order.
+        const std::vector<line_exception>& errors() const
+        {
+            return _errors;
+        }
 
-        std::shared_ptr<typespec> parse_typespec();
+        expr* parse_expr();
 
-        std::shared_ptr<stmt> parse_stmt();
+        typespec* parse_typespec();
 
-        std::vector<std::shared_ptr<stmt>> parse_stmt_block();
+        stmt* parse_stmt();
 
-        std::shared_ptr<decl> parse_decl();
+        std::vector<stmt*> parse_stmt_block();
 
-        std::vector<std::shared_ptr<decl>> parse_module();
+        decl* parse_decl();
+
+        std::vector<decl*> parse_module();
+
+        // Parses the rest of the module with the top level declarations split
+        // between the threads of the pool. Gives the same ast and errors as
+        // parse_module, which it falls back to when streaming from a lexer.
+        std::vector<decl*> parse_module(thread_pool& pool, size_t min_chunk_tokens = 16 * 1024);
     private:
-        line_exception parse_error(const std::string& msg);
-
-        std::shared_ptr<expr> parse_expr0();
-        std::shared_ptr<expr> parse_expr1();
-        std::shared_ptr<expr> parse_expr2();
-        std::shared_ptr<expr> parse_expr3();
-        std::shared_ptr<expr> parse_expr4();
-        std::shared_ptr<expr> parse_expr5();
-        std::shared_ptr<expr> parse_expr6();
-        std::shared_ptr<expr> parse_expr7();
-        std::shared_ptr<expr> parse_expr8();
-        std::shared_ptr<expr> parse_expr9();
-        std::shared_ptr<expr> parse_expr10();
-        std::shared_ptr<expr> parse_expr11();
-        std::shared_ptr<expr> parse_expr12();
-        std::shared_ptr<expr> parse_expr13();
-        std::shared_ptr<expr> parse_expr14();
-
-        std::shared_ptr<stmt_let> parse_stmt_let();
-        std::shared_ptr<stmt_const> parse_stmt_const();
-        std::shared_ptr<stmt_return> parse_stmt_return();
-        std::shared_ptr<stmt_if> parse_stmt_if();
-
-        std::shared_ptr<decl_import> parse_decl_import();
-        std::shared_ptr<decl_namespace> parse_decl_namespace();
-        std::shared_ptr<decl_func> parse_decl_func();
-        std::shared_ptr<decl_struct> parse_decl_struct();
-        std::shared_ptr<decl_alias> parse_decl_alias();
+        parser(std::span<const token> tokens, source_pos end, const source_file& source, arena& arena, parse_mode mode, deferred_bodies* deferred);
+
+        // Consumes the next token if it has the given type, otherwise reports msg
+        // and returns the next token without consuming it.
+        token expect(token_type type, const char* msg);
+
+        void error(const std::string& msg);
+        void synchronize(source_pos start);
+        bool statement_ended();
+
+        stmt* parse_stmt_inner();
+        const token* skip_stmt_block();
+        decl* parse_decl_inner();
+
+        expr* parse_primary();
+        expr* parse_postfix();
+        expr* parse_unary();
+        expr* parse_binary(uint8_t min_power);
+
+        stmt_let* parse_stmt_let();
+        stmt_const* parse_stmt_const();
+        stmt_return* parse_stmt_return();
+        stmt_if* parse_stmt_if();
+
+        decl_import* parse_decl_import();
+        decl_namespace* parse_decl_namespace();
+        decl_func* parse_decl_func();
+        decl_struct* parse_decl_struct();
+        decl_alias* parse_decl_alias();
     };
 }
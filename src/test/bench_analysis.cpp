@@ -0,0 +1,74 @@
+#include "catch.hpp"
+
+#include "bench_corpus.h"
+#include "../lex/lexer.h"
+#include "../parse/parser.h"
+#include "../parse/flat_ast.h"
+#include "../check/control_analyzer.h"
+#include "../check/type_checker.h"
+#include "../util/thread_pool.h"
+
+TEST_CASE("control analysis throughput", "[.benchmark][control_analyzer]")
+{
+    arc::source_file input(generate_bench_module(2000), true);
+    auto tokens = arc::lexer(input).lex().tokens;
+    arc::arena arena;
+    auto decls = arc::parser(tokens, input, arena).parse_module();
+
+    BENCHMARK("analyze 2000 functions") {
+        return arc::control_analyzer(decls, input).analyze().size();
+    };
+
+    BENCHMARK("flatten 2000 functions") {
+        return arc::flatten(decls).nodes.size();
+    };
+
+    auto ast = arc::flatten(decls);
+    BENCHMARK("analyze 2000 flattened functions") {
+        return arc::flat_control_analyzer(ast, input).analyze().size();
+    };
+}
+
+TEST_CASE("type checking throughput", "[.benchmark][type_checker]")
+{
+    arc::source_file input(generate_bench_module(2000), true);
+    auto tokens = arc::lexer(input).lex().tokens;
+    arc::arena arena;
+    auto decls = arc::parser(tokens, input, arena).parse_module();
+
+    BENCHMARK("check 2000 functions") {
+        return arc::type_checker(decls, input).check().size();
+    };
+}
+
+TEST_CASE("type checking deeply nested scopes", "[.benchmark][type_checker]")
+{
+    arc::source_file input(generate_bench_scopes(100, 64, 16), true);
+    auto tokens = arc::lexer(input).lex().tokens;
+    arc::arena arena;
+    auto decls = arc::parser(tokens, input, arena).parse_module();
+
+    BENCHMARK("check 100 functions 64 blocks deep") {
+        return arc::type_checker(decls, input).check().size();
+    };
+}
+
+TEST_CASE("parallel type checking throughput", "[.benchmark][type_checker]")
+{
+    arc::source_file input(generate_bench_module(20000), true);
+    auto tokens = arc::lexer(input).lex().tokens;
+    arc::arena arena;
+    auto decls = arc::parser(tokens, input, arena).parse_module();
+
+    BENCHMARK("check 20000 functions serially") {
+        return arc::type_checker(decls, input).check().size();
+    };
+
+    for(size_t threads : { 1, 2, 4, 8 })
+    {
+        arc::thread_pool pool(threads);
+        BENCHMARK("check 20000 functions on " + std::to_string(threads) + " threads") {
+            return arc::type_checker(decls, input).check(pool).size();
+        };
+    }
+}
@@ -0,0 +1,162 @@
+#include "bench_corpus.h"
+
+#include <random>
+#include <cstdio>
+
+std::string generate_bench_module(size_t functions)
+{
+    std::mt19937 rng(1234);
+    auto number = [&](uint32_t max) { return std::to_string(rng() % max); };
+
+    std::string out = "import std;\n\nnamespace lib;\n\n";
+    for(size_t i = 0; i < functions; i++)
+    {
+        auto n = std::to_string(i);
+
+        if(i % 50 == 0)
+        {
+            out += "struct data_" + n + " {\n    value: u32;\n    pointer: *u32;\n}\n\n";
+            out += "alias ptr_" + n + " = **u32;\n\n";
+        }
+
+        out += "func function_number_" + n + "(argument_a: u64, argument_b: u64, flag: bool) : u64 {\n";
+        out += "    let total: u64 = argument_a + argument_b * " + number(100000) + ";\n";
+        out += "    let other = (total << 3) ^ (argument_a | 0x" + number(0xFFFFFF) + ") & 0b1011;\n";
+        out += "    let ratio = " + number(1000) + "." + number(100000) + ";\n";
+        out += "    if flag {\n";
+        out += "        total = total + other;\n";
+        out += "        {\n";
+        out += "            let nested = total - " + number(10) + ";\n";
+        out += "            total = nested;\n";
+        out += "        }\n";
+        out += "    } elif total == other {\n";
+        out += "        return other;\n";
+        out += "    } else {\n";
+        out += "        total = total * 2;\n";
+        out += "    }\n";
+        out += "    return total;\n";
+        out += "}\n\n";
+    }
+
+    return out;
+}
+
+std::string generate_bench_literals(size_t count)
+{
+    std::mt19937 rng(1234);
+
+    std::string out;
+    for(size_t i = 0; i < count; i++)
+    {
+        auto value = uint64_t(rng()) << 16 | rng() % 0xFFFF;
+        switch(i % 5)
+        {
+        case 0: out += std::to_string(value); break;
+        case 1: out += std::to_string(rng() % 100000) + "." + std::to_string(rng()); break;
+        case 2: out += std::to_string(rng() % 1000) + "." + std::to_string(rng() % 1000) + "e-" + std::to_string(rng() % 30); break;
+        case 3: {
+            char hex[32];
+            std::snprintf(hex, sizeof(hex), "0x%llX", (unsigned long long)value);
+            out += hex;
+        } break;
+        case 4: out += "0o" + std::to_string(rng() % 7 + 1) + "0127"; break;
+        }
+        out += (i % 8 == 7) ? "\n" : " ";
+    }
+
+    return out;
+}
+
+std::string generate_bench_expressions(size_t count)
+{
+    static const char* binary_ops[] = {
+        "+", "-", "*", "/", "%", "<<", ">>", "<", "<=", ">", ">=",
+        "==", "!=", "&", "^", "|", "&&", "||"
+    };
+    static const char* unary_ops[] = { "-", "!", "~", "*", "&" };
+
+    std::mt19937 rng(1234);
+
+    std::string out;
+    auto operand = [&](auto& self, int depth) -> void {
+        switch(depth <= 0 ? rng() % 3 : rng() % 7)
+        {
+        case 0: out += std::to_string(rng() % 1000); break;
+        case 1: out += "value_" + std::to_string(rng() % 10); break;
+        case 2: out += "items[" + std::to_string(rng() % 16) + "].field"; break;
+        case 3: out += unary_ops[rng() % 5]; out += "value_" + std::to_string(rng() % 10); break;
+        case 4: out += "call("; self(self, depth - 1); out += ", "; self(self, depth - 1); out += ")"; break;
+        case 5: self(self, depth - 1); out += " as u64"; break;
+        default: {
+            out += "(";
+            self(self, depth - 1);
+            for(uint32_t i = rng() % 4; i > 0; i--)
+            {
+                out += " ";
+                out += binary_ops[rng() % 18];
+                out += " ";
+                self(self, depth - 1);
+            }
+            out += ")";
+        } break;
+        }
+    };
+
+    for(size_t i = 0; i < count; i++)
+    {
+        if(i % 100 == 0)
+        {
+            out += (i == 0 ? "" : "}\n\n");
+            out += "func expressions_" + std::to_string(i / 100) + "() : u64 {\n";
+        }
+
+        out += "    total = ";
+        operand(operand, 3);
+        for(int j = 0; j < 8; j++)
+        {
+            out += " ";
+            out += binary_ops[rng() % 18];
+            out += " ";
+            operand(operand, 3);
+        }
+        out += ";\n";
+    }
+    out += count == 0 ? "" : "}\n";
+
+    return out;
+}
+
+std::string generate_bench_scopes(size_t functions, size_t depth, size_t locals)
+{
+    std::string out;
+    for(size_t i = 0; i < functions; i++)
+    {
+        out += "func scopes_" + std::to_string(i) + "(argument: u64) : u64 {\n";
+
+        std::string indent = "    ";
+        std::string previous = "argument";
+        for(size_t d = 0; d < depth; d++)
+        {
+            for(size_t l = 0; l < locals; l++)
+            {
+                auto name = "local_" + std::to_string(d) + "_" + std::to_string(l);
+                out += indent + "let " + name + ": u64 = " + previous + " + local_0_0;\n";
+                previous = name;
+            }
+            // Shadow a name from the block above, then open a new one.
+            out += indent + "let shadowed = " + previous + ";\n";
+            out += indent + "{\n";
+            indent += "    ";
+        }
+        out += indent + "return shadowed + argument;\n";
+        for(size_t d = 0; d < depth; d++)
+        {
+            indent.resize(indent.size() - 4);
+            out += indent + "}\n";
+        }
+        out += "    return argument;\n";
+        out += "}\n\n";
+    }
+
+    return out;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+// Generates a syntactically valid module with the given number of functions,
+// used as input for the benchmarks.
+std::string generate_bench_module(size_t functions);
+
+// Generates a stream of integer and float literals in every base.
+std::string generate_bench_literals(size_t count);
+
+// Generates functions full of long, deeply nested operator expressions.
+std::string generate_bench_expressions(size_t count);
+
+// Generates functions that nest blocks depth deep, each declaring some locals
+// that refer back to ones from outer blocks.
+std::string generate_bench_scopes(size_t functions, size_t depth, size_t locals);
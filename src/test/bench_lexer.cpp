@@ -0,0 +1,22 @@
+#include "catch.hpp"
+
+#include "bench_corpus.h"
+#include "../lex/lexer.h"
+
+TEST_CASE("lexer throughput", "[.benchmark][lexer]")
+{
+    arc::source_file input(generate_bench_module(2000), true);
+
+    BENCHMARK("lex " + std::to_string(input.size() / 1024) + " KiB module") {
+        return arc::lexer(input).lex().tokens.size();
+    };
+}
+
+TEST_CASE("lexer literal throughput", "[.benchmark][lexer]")
+{
+    arc::source_file input(generate_bench_literals(100000), true);
+
+    BENCHMARK("lex 100k literals") {
+        return arc::lexer(input).lex().tokens.size();
+    };
+}
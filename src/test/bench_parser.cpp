@@ -0,0 +1,163 @@
+#include "catch.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+#include "bench_corpus.h"
+#include "../lex/lexer.h"
+#include "../parse/parser.h"
+#include "../parse/incremental.h"
+#include "../parse/ast_cache.h"
+#include "../util/thread_pool.h"
+
+TEST_CASE("parser throughput", "[.benchmark][parser]")
+{
+    arc::source_file input(generate_bench_module(2000), true);
+    auto tokens = arc::lexer(input).lex().tokens;
+
+    BENCHMARK("parse " + std::to_string(input.size() / 1024) + " KiB module") {
+        arc::arena arena;
+        return arc::parser(tokens, input, arena).parse_module().size();
+    };
+}
+
+TEST_CASE("lazy parser throughput", "[.benchmark][parser]")
+{
+    arc::source_file input(generate_bench_module(2000), true);
+    auto tokens = arc::lexer(input).lex().tokens;
+
+    BENCHMARK("parse signatures of " + std::to_string(input.size() / 1024) + " KiB module") {
+        arc::arena arena;
+        arc::deferred_bodies bodies(tokens, input, arena);
+        return arc::parser(input, arena, bodies).parse_module().size();
+    };
+}
+
+TEST_CASE("parallel parser throughput", "[.benchmark][parser]")
+{
+    arc::source_file input(generate_bench_module(20000), true);
+    auto tokens = arc::lexer(input).lex().tokens;
+    arc::thread_pool pool;
+
+    BENCHMARK("parse " + std::to_string(input.size() / 1024) + " KiB module serially") {
+        arc::arena arena;
+        return arc::parser(tokens, input, arena).parse_module().size();
+    };
+
+    BENCHMARK("parse " + std::to_string(input.size() / 1024) + " KiB module on " + std::to_string(pool.size()) + " threads") {
+        arc::arena arena;
+        return arc::parser(tokens, input, arena).parse_module(pool).size();
+    };
+}
+
+TEST_CASE("incremental parser edits", "[.benchmark][parser]")
+{
+    auto text = generate_bench_module(2000);
+    arc::incremental_parser parser(text);
+
+    // Somewhere in the middle of a function body.
+    auto offset = text.find("return", text.size() / 2);
+    bool typed = false;
+
+    BENCHMARK("lex and parse " + std::to_string(text.size() / 1024) + " KiB module from scratch") {
+        arc::source_file input(text, true);
+        arc::arena arena;
+        auto tokens = arc::lexer(input).lex().tokens;
+        return arc::parser(tokens, input, arena, arc::parse_mode::recover).parse_module().size();
+    };
+
+    BENCHMARK("type and delete a character in " + std::to_string(text.size() / 1024) + " KiB module") {
+        parser.apply(typed ? arc::text_edit { offset, 1, "" } : arc::text_edit { offset, 0, "x" });
+        typed = !typed;
+        return parser.decls().size();
+    };
+}
+
+TEST_CASE("ast cache loading", "[.benchmark][parser]")
+{
+    auto path = (std::filesystem::temp_directory_path() / "arc_bench_cache.arc").string();
+    std::ofstream(path, std::ios::binary) << generate_bench_module(2000);
+
+    arc::source_file input(path);
+    auto cache_path = arc::ast_cache_path(input);
+    {
+        arc::arena arena;
+        auto tokens = arc::lexer(input).lex().tokens;
+        REQUIRE(arc::write_ast_cache(cache_path, input, arc::parser(tokens, input, arena).parse_module()));
+    }
+
+    BENCHMARK("lex and parse " + std::to_string(input.size() / 1024) + " KiB module") {
+        arc::arena arena;
+        auto tokens = arc::lexer(input).lex().tokens;
+        return arc::parser(tokens, input, arena).parse_module().size();
+    };
+
+    BENCHMARK("load " + std::to_string(input.size() / 1024) + " KiB module from the cache") {
+        arc::type_interner types;
+        return arc::cached_module::load(cache_path, input, types)->decls().size();
+    };
+
+    std::filesystem::remove(cache_path);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("parser expression throughput", "[.benchmark][parser]")
+{
+    arc::source_file input(generate_bench_expressions(20000), true);
+    auto tokens = arc::lexer(input).lex().tokens;
+
+    BENCHMARK("parse 20k operator heavy statements") {
+        arc::arena arena;
+        return arc::parser(tokens, input, arena).parse_module().size();
+    };
+}
+
+TEST_CASE("token lookahead", "[.benchmark][parser]")
+{
+    arc::source_file input(generate_bench_module(2000), true);
+    auto tokens = arc::lexer(input).lex().tokens;
+
+    // The statement keywords, as the parser checks them before every statement.
+    constexpr arc::token_set set = {
+        arc::token_type::let,
+        arc::token_type::const_,
+        arc::token_type::return_,
+        arc::token_type::if_,
+        arc::token_type::l_curly
+    };
+
+    BENCHMARK("token_set lookahead over " + std::to_string(tokens.size()) + " tokens") {
+        arc::token_stream stream(tokens);
+        size_t matches = 0;
+        while(!stream.next_is(arc::token_type::eof))
+        {
+            matches += stream.next_is_one_of(set);
+            stream.next();
+        }
+        return matches;
+    };
+
+    // What next_is_one_of used to do, kept for comparison.
+    BENCHMARK("initializer_list lookahead over " + std::to_string(tokens.size()) + " tokens") {
+        arc::token_stream stream(tokens);
+        size_t matches = 0;
+        while(!stream.next_is(arc::token_type::eof))
+        {
+            for(auto type : {
+                arc::token_type::let,
+                arc::token_type::const_,
+                arc::token_type::return_,
+                arc::token_type::if_,
+                arc::token_type::l_curly
+            }) {
+                if(stream.peek_type() == type)
+                {
+                    matches++;
+                    break;
+                }
+            }
+            stream.next();
+        }
+        return matches;
+    };
+}
@@ -0,0 +1,121 @@
+#include "catch.hpp"
+
+#include "../util/arena.h"
+
+#include <string>
+
+namespace
+{
+    struct counted
+    {
+        int& destroyed;
+
+        counted(int& destroyed)
+            : destroyed(destroyed)
+        {
+        }
+
+        ~counted()
+        {
+            destroyed++;
+        }
+    };
+}
+
+TEST_CASE("arena allocates and releases memory", "[arena]")
+{
+    SECTION("allocations are aligned") {
+        arc::arena arena;
+        arena.make<char>('a');
+        auto value = arena.make<uint64_t>(42);
+        REQUIRE(reinterpret_cast<uintptr_t>(value) % alignof(uint64_t) == 0);
+        REQUIRE(*value == 42);
+    }
+
+    SECTION("many allocations span several blocks") {
+        arc::arena arena;
+        std::vector<uint64_t*> values;
+        for(uint64_t i = 0; i < 100000; i++)
+        {
+            values.push_back(arena.make<uint64_t>(i));
+        }
+        for(uint64_t i = 0; i < values.size(); i++)
+        {
+            REQUIRE(*values[i] == i);
+        }
+    }
+
+    SECTION("large allocations") {
+        arc::arena arena;
+        auto small = arena.make<int>(1);
+        auto large = static_cast<char*>(arena.allocate(1024 * 1024, 16));
+        large[0] = 'x';
+        large[1024 * 1024 - 1] = 'y';
+        REQUIRE(reinterpret_cast<uintptr_t>(large) % 16 == 0);
+        REQUIRE(*arena.make<int>(2) == 2);
+        REQUIRE(*small == 1);
+    }
+
+    SECTION("destructors run when the arena is dropped") {
+        int destroyed = 0;
+        {
+            arc::arena arena;
+            arena.make<counted>(destroyed);
+            std::vector<counted> items(3, counted(destroyed));
+            destroyed = 0;
+            arena.copy(items);
+            REQUIRE(destroyed == 0);
+        }
+        // The vector's three items, then the four objects in the arena.
+        REQUIRE(destroyed == 3 + 4);
+    }
+
+    SECTION("moving an arena transfers ownership") {
+        int destroyed = 0;
+        arc::arena other;
+        {
+            arc::arena arena;
+            arena.make<counted>(destroyed);
+            other = std::move(arena);
+        }
+        REQUIRE(destroyed == 0);
+        other = arc::arena();
+        REQUIRE(destroyed == 1);
+    }
+
+    SECTION("absorbing an arena transfers ownership") {
+        int destroyed = 0;
+        arc::arena owner;
+        auto kept = owner.make<uint64_t>(1);
+        {
+            arc::arena arena;
+            arena.make<counted>(destroyed);
+            for(uint64_t i = 0; i < 10000; i++)
+            {
+                arena.make<uint64_t>(i);
+            }
+            auto reserved = owner.bytes_reserved() + arena.bytes_reserved();
+            owner.absorb(std::move(arena));
+            REQUIRE(owner.bytes_reserved() == reserved);
+            REQUIRE(arena.bytes_reserved() == 0);
+        }
+        REQUIRE(destroyed == 0);
+        REQUIRE(*owner.make<uint64_t>(2) == 2);
+        REQUIRE(*kept == 1);
+        owner = arc::arena();
+        REQUIRE(destroyed == 1);
+    }
+
+    SECTION("copies") {
+        arc::arena arena;
+        std::string name = "some_name";
+        auto copy = arena.copy(std::string_view(name));
+        name[0] = 'x';
+        REQUIRE(copy == "some_name");
+
+        auto span = arena.copy(std::vector<int> { 1, 2, 3 });
+        REQUIRE(span.size() == 3);
+        REQUIRE(span[2] == 3);
+        REQUIRE(arena.copy(std::vector<int>()).empty());
+    }
+}
@@ -0,0 +1,192 @@
+#include "catch.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+#include "../lex/lexer.h"
+#include "../parse/parser.h"
+#include "../parse/flat_ast.h"
+#include "../parse/ast_cache.h"
+#include "../check/type_checker.h"
+#include "../type/builtins.h"
+#include "bench_corpus.h"
+
+namespace
+{
+    std::string write_temp_file(const std::string& name, const std::string& content)
+    {
+        auto path = (std::filesystem::temp_directory_path() / name).string();
+        std::ofstream output(path, std::ios::binary);
+        output << content;
+        return path;
+    }
+
+    bool decl_equals(arc::decl* lhs, arc::decl* rhs)
+    {
+        return *lhs == *rhs;
+    }
+
+    // Same nodes, positions and filled in types.
+    void require_same_module(const std::vector<arc::decl*>& lhs, const std::vector<arc::decl*>& rhs)
+    {
+        REQUIRE(lhs.size() == rhs.size());
+        for(size_t i = 0; i < lhs.size(); i++)
+        {
+            REQUIRE(decl_equals(lhs[i], rhs[i]));
+        }
+
+        auto l = arc::flatten(lhs);
+        auto r = arc::flatten(rhs);
+        REQUIRE(l.nodes.size() == r.nodes.size());
+        for(size_t i = 0; i < l.nodes.size(); i++)
+        {
+            REQUIRE(l.positions[i].offset == r.positions[i].offset);
+            REQUIRE(l.positions[i].file == r.positions[i].file);
+        }
+
+        REQUIRE(l.types.size() == r.types.size());
+        for(size_t i = 0; i < l.types.size(); i++)
+        {
+            REQUIRE(l.types[i].first == r.types[i].first);
+            REQUIRE(typeid(*l.types[i].second) == typeid(*r.types[i].second));
+        }
+    }
+}
+
+TEST_CASE("ast cache round trips modules", "[ast_cache]")
+{
+    arc::type_interner types;
+
+    SECTION("module with every kind of node") {
+        auto path = write_temp_file("arc_ast_cache_nodes.arc", R"(
+            import std;
+            namespace test;
+            alias word = u64;
+            struct pair {
+                first: u64;
+                second: *u64;
+                func sum() : u64 { return 0; }
+            }
+            func f(a: u64, b: (u64, *u64) : bool) : u64 {
+                let c: u64 = 0x123456789AB + true;
+                const d = c * 2;
+                if c < d { return c; } elif c == d { return d; } else { { return a[0].b(c, -d) as u64; } }
+            }
+        )" + generate_bench_module(5));
+        arc::source_file input(path);
+        arc::arena arena;
+        auto tokens = arc::lexer(input).lex().tokens;
+        auto decls = arc::parser(tokens, input, arena).parse_module();
+
+        auto cache_path = arc::ast_cache_path(input);
+        REQUIRE(arc::write_ast_cache(cache_path, input, decls));
+
+        auto cached = arc::cached_module::load(cache_path, input, types);
+        REQUIRE(cached.has_value());
+        require_same_module(decls, cached->decls());
+
+        std::filesystem::remove(cache_path);
+        std::filesystem::remove(path);
+    }
+
+    SECTION("types filled in by the checker") {
+        auto path = write_temp_file("arc_ast_cache_types.arc", R"(
+            func add(a: u64, b: *u64) : u64 {
+                let c: u64 = a + a;
+                const d = c;
+                return d;
+            }
+        )");
+        arc::source_file input(path);
+        arc::arena arena;
+        auto tokens = arc::lexer(input).lex().tokens;
+        auto decls = arc::parser(tokens, input, arena).parse_module();
+        REQUIRE(arc::type_checker(decls, input).check().empty());
+        REQUIRE(arc::flatten(decls).types.size() == 5);
+
+        auto cache_path = arc::ast_cache_path(input);
+        REQUIRE(arc::write_ast_cache(cache_path, input, decls));
+
+        auto cached = arc::cached_module::load(cache_path, input, types);
+        REQUIRE(cached.has_value());
+        require_same_module(decls, cached->decls());
+
+        // Builtins are the shared objects, and everything else comes from the
+        // interner the cache was loaded with, so it matches what a checker
+        // using that interner builds.
+        auto add = static_cast<arc::decl_func*>(cached->decls()[0]);
+        REQUIRE(add->arguments[0].types.type == add->types.ret_type);
+        REQUIRE(add->types.ret_type == arc::types::u64());
+        REQUIRE(add->arguments[1].types.type == types.pointer(arc::types::u64()));
+
+        REQUIRE(arc::type_checker(cached->decls(), input, types).check().empty());
+        REQUIRE(add->arguments[1].types.type == types.pointer(arc::types::u64()));
+
+        std::filesystem::remove(cache_path);
+        std::filesystem::remove(path);
+    }
+
+    SECTION("empty module") {
+        auto path = write_temp_file("arc_ast_cache_empty.arc", "");
+        arc::source_file input(path);
+        auto cache_path = arc::ast_cache_path(input);
+        REQUIRE(arc::write_ast_cache(cache_path, input, {}));
+
+        auto cached = arc::cached_module::load(cache_path, input, types);
+        REQUIRE(cached.has_value());
+        REQUIRE(cached->decls().empty());
+
+        std::filesystem::remove(cache_path);
+        std::filesystem::remove(path);
+    }
+}
+
+TEST_CASE("ast cache rejects caches that don't match", "[ast_cache]")
+{
+    arc::type_interner types;
+    auto path = write_temp_file("arc_ast_cache_stale.arc", generate_bench_module(5));
+    auto cache_path = path + ".astc";
+    {
+        arc::source_file input(path);
+        arc::arena arena;
+        auto tokens = arc::lexer(input).lex().tokens;
+        auto decls = arc::parser(tokens, input, arena).parse_module();
+        REQUIRE(arc::write_ast_cache(cache_path, input, decls));
+        REQUIRE(arc::cached_module::load(cache_path, input, types).has_value());
+    }
+
+    SECTION("missing cache") {
+        arc::source_file input(path);
+        REQUIRE(!arc::cached_module::load(cache_path + ".missing", input, types).has_value());
+    }
+
+    SECTION("source changed") {
+        auto source = generate_bench_module(5);
+        source[source.size() / 2] = 'x';
+        write_temp_file("arc_ast_cache_stale.arc", source);
+
+        arc::source_file input(path);
+        REQUIRE(!arc::cached_module::load(cache_path, input, types).has_value());
+    }
+
+    SECTION("other version of the format") {
+        std::fstream cache(cache_path, std::ios::binary | std::ios::in | std::ios::out);
+        cache.seekp(4);
+        uint32_t version = arc::ast_cache_version + 1;
+        cache.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        cache.close();
+
+        arc::source_file input(path);
+        REQUIRE(!arc::cached_module::load(cache_path, input, types).has_value());
+    }
+
+    SECTION("truncated cache") {
+        std::filesystem::resize_file(cache_path, std::filesystem::file_size(cache_path) - 1);
+
+        arc::source_file input(path);
+        REQUIRE(!arc::cached_module::load(cache_path, input, types).has_value());
+    }
+
+    std::filesystem::remove(cache_path);
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,210 @@
+#include "catch.hpp"
+
+#include "../lex/lexer.h"
+#include "../parse/parser.h"
+#include "../parse/flat_ast.h"
+#include "../check/control_analyzer.h"
+#include "bench_corpus.h"
+
+namespace
+{
+    arc::flat_ast flatten_source(const arc::source_file& input)
+    {
+        arc::arena arena;
+        auto tokens = arc::lexer(input).lex().tokens;
+        auto decls = arc::parser(tokens, input, arena).parse_module();
+        return arc::flatten(decls);
+    }
+
+    // Also requires the errors to be in source order.
+    std::vector<std::string> analyze(const std::string& source)
+    {
+        arc::source_file input(source, true);
+        auto ast = flatten_source(input);
+
+        std::vector<std::string> errors;
+        auto found = arc::flat_control_analyzer(ast, input).analyze();
+        for(size_t i = 0; i < found.size(); i++)
+        {
+            if(i > 0) { REQUIRE(found[i - 1].position.offset <= found[i].position.offset); }
+            errors.push_back(found[i].error);
+        }
+        return errors;
+    }
+}
+
+TEST_CASE("flattening produces correct nodes", "[flat_ast]")
+{
+    SECTION("function") {
+        arc::source_file input(R"(
+            func add(a: u64, b: *u64) : u64 {
+                let c: u64 = a + *b;
+                return c;
+            }
+        )", true);
+        auto ast = flatten_source(input);
+
+        REQUIRE(ast.module.size() == 1);
+        const auto& func = ast.nodes[ast.module[0]];
+        REQUIRE(func.kind == arc::ast_kind::decl_func);
+        REQUIRE(ast.string(func.lhs) == "add");
+
+        auto args = ast.func_args(func);
+        REQUIRE(args.size() == 2);
+        REQUIRE(ast.nodes[args[0]].kind == arc::ast_kind::func_arg);
+        REQUIRE(ast.string(ast.nodes[args[1]].lhs) == "b");
+        REQUIRE(ast.nodes[ast.nodes[args[1]].rhs].kind == arc::ast_kind::typespec_pointer);
+        REQUIRE(ast.nodes[ast.func_ret_type(func)].kind == arc::ast_kind::typespec_name);
+
+        auto body = ast.func_body(func);
+        REQUIRE(body.size() == 2);
+
+        const auto& let = ast.nodes[body[0]];
+        REQUIRE(let.kind == arc::ast_kind::stmt_let);
+        REQUIRE(ast.string(let.lhs) == "c");
+
+        const auto& init = ast.nodes[ast.extra[let.rhs + 1]];
+        REQUIRE(init.kind == arc::ast_kind::expr_binary);
+        REQUIRE(arc::binary_op(init.op) == arc::binary_op::add);
+        REQUIRE(ast.nodes[init.rhs].kind == arc::ast_kind::expr_unary);
+        REQUIRE(arc::unary_op(ast.nodes[init.rhs].op) == arc::unary_op::deref);
+
+        const auto& ret = ast.nodes[body[1]];
+        REQUIRE(ret.kind == arc::ast_kind::stmt_return);
+        REQUIRE(ast.nodes[ret.lhs].kind == arc::ast_kind::expr_name);
+        REQUIRE(input.location(ast.positions[body[1]]).line == 4);
+    }
+
+    SECTION("literals and optional children") {
+        arc::source_file input("func f() : u64 { let x = 0x123456789AB; return; }", true);
+        auto ast = flatten_source(input);
+
+        auto body = ast.func_body(ast.nodes[ast.module[0]]);
+        const auto& let = ast.nodes[body[0]];
+        REQUIRE(ast.extra[let.rhs] == arc::flat_ast::null_index);
+        REQUIRE(ast.integer(ast.nodes[ast.extra[let.rhs + 1]]) == 0x123456789AB);
+        REQUIRE(ast.nodes[body[1]].lhs == arc::flat_ast::null_index);
+    }
+
+    SECTION("children come before their parents") {
+        arc::source_file input(generate_bench_module(20), true);
+        auto ast = flatten_source(input);
+
+        auto check_list = [&](uint32_t list, arc::node_index parent) {
+            for(auto child : ast.list(list))
+            {
+                REQUIRE(child < parent);
+            }
+        };
+
+        for(arc::node_index i = 0; i < ast.nodes.size(); i++)
+        {
+            const auto& node = ast.nodes[i];
+            switch(node.kind)
+            {
+            case arc::ast_kind::expr_binary:
+            case arc::ast_kind::expr_index: {
+                REQUIRE(node.lhs < i);
+                REQUIRE(node.rhs < i);
+            } break;
+            case arc::ast_kind::stmt_block: {
+                check_list(node.lhs, i);
+            } break;
+            case arc::ast_kind::stmt_if: {
+                check_list(node.lhs, i);
+                check_list(node.rhs, i);
+            } break;
+            case arc::ast_kind::if_branch: {
+                REQUIRE(node.lhs < i);
+                check_list(node.rhs, i);
+            } break;
+            case arc::ast_kind::decl_func: {
+                check_list(ast.extra[node.rhs], i);
+                check_list(ast.extra[node.rhs + 2], i);
+            } break;
+            }
+        }
+    }
+
+    SECTION("names are shared") {
+        arc::source_file input("func f(value: u64) : u64 { return value + value; }", true);
+        auto ast = flatten_source(input);
+        REQUIRE(ast.strings.size() == 3);
+    }
+}
+
+TEST_CASE("flat control analysis reports the right errors", "[control_analyzer]")
+{
+    SECTION("all paths return") {
+        REQUIRE(analyze(R"(
+            func f(a: bool) : u64 {
+                if a {
+                    return 1;
+                } elif a {
+                    { return 2; }
+                } else {
+                    return 3;
+                }
+            }
+        )").empty());
+    }
+
+    SECTION("missing return") {
+        auto errors = analyze(R"(
+            func f(a: bool) : u64 {
+                if a {
+                    return 1;
+                }
+            }
+        )");
+        REQUIRE(errors == std::vector<std::string> { "not all control paths return a value" });
+    }
+
+    SECTION("unreachable code") {
+        auto errors = analyze(R"(
+            func f(a: bool) : u64 {
+                if a {
+                    return 1;
+                    a = false;
+                }
+                return 2;
+                return 3;
+            }
+        )");
+        REQUIRE(errors == std::vector<std::string> { "unreachable code", "unreachable code" });
+    }
+
+    SECTION("member functions") {
+        auto errors = analyze(R"(
+            struct data {
+                func f() : u64 {
+                }
+            }
+        )");
+        REQUIRE(errors == std::vector<std::string> { "not all control paths return a value" });
+    }
+
+    SECTION("errors come in source order") {
+        auto errors = analyze(R"(
+            func f(a: bool) : u64 {
+                {
+                    return 1;
+                    { return 2; return 3; }
+                }
+            }
+        )");
+        REQUIRE(errors == std::vector<std::string> { "unreachable code", "unreachable code" });
+    }
+
+    SECTION("missing return after unreachable code") {
+        auto errors = analyze(R"(
+            func f(a: bool) : u64 {
+                if a {
+                    return 1;
+                    return 2;
+                }
+            }
+        )");
+        REQUIRE(errors == std::vector<std::string> { "not all control paths return a value", "unreachable code" });
+    }
+}
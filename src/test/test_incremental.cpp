@@ -0,0 +1,164 @@
+#include "catch.hpp"
+
+#include <random>
+
+#include "../lex/lexer.h"
+#include "../parse/parser.h"
+#include "../parse/incremental.h"
+#include "../parse/flat_ast.h"
+#include "bench_corpus.h"
+
+namespace
+{
+    bool decl_equals(arc::decl* lhs, arc::decl* rhs)
+    {
+        return *lhs == *rhs;
+    }
+
+    bool errors_equal(const std::vector<arc::line_exception>& lhs, const std::vector<arc::line_exception>& rhs)
+    {
+        if(lhs.size() != rhs.size())
+        {
+            return false;
+        }
+        for(size_t i = 0; i < lhs.size(); i++)
+        {
+            if(lhs[i].error != rhs[i].error || lhs[i].position.offset != rhs[i].position.offset)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Lexes and parses the current text of the incremental parser from scratch
+    // and checks that it got the same result.
+    void require_same_as_full_parse(const arc::incremental_parser& incremental)
+    {
+        const auto& source = incremental.source();
+        arc::source_file input(std::string(source.buffer(), source.size()), true);
+        arc::arena arena;
+        auto lexed = arc::lexer(input).lex();
+        arc::parser parser(lexed.tokens, input, arena, arc::parse_mode::recover);
+        auto decls = parser.parse_module();
+
+        const auto& tokens = incremental.tokens();
+        REQUIRE(tokens.size() == lexed.tokens.size());
+        for(size_t i = 0; i < tokens.size(); i++)
+        {
+            REQUIRE(tokens[i].type == lexed.tokens[i].type);
+            REQUIRE(tokens[i].position.offset == lexed.tokens[i].position.offset);
+            REQUIRE(tokens[i].length == lexed.tokens[i].length);
+        }
+        REQUIRE(errors_equal(incremental.lexer_errors(), lexed.errors));
+
+        REQUIRE(incremental.decls().size() == decls.size());
+        for(size_t i = 0; i < decls.size(); i++)
+        {
+            REQUIRE(decl_equals(incremental.decls()[i], decls[i]));
+        }
+        REQUIRE(errors_equal(incremental.parse_errors(), parser.errors()));
+
+        // equals ignores positions, the flat form has them all in one place.
+        auto full = arc::flatten(decls);
+        auto updated = arc::flatten(incremental.decls());
+        REQUIRE(updated.positions.size() == full.positions.size());
+        for(size_t i = 0; i < full.positions.size(); i++)
+        {
+            REQUIRE(updated.positions[i].offset == full.positions[i].offset);
+            REQUIRE(updated.positions[i].file == source.id());
+        }
+    }
+}
+
+TEST_CASE("incremental parsing matches parsing from scratch", "[parser][incremental]")
+{
+    SECTION("only the edited declaration is parsed again") {
+        arc::incremental_parser parser(R"(
+            func a() : u64 { return 1; }
+            func b() : u64 { return 2; }
+            func c() : u64 { return 3; }
+        )");
+        auto before = parser.decls();
+        REQUIRE(before.size() == 3);
+
+        std::string_view text(parser.source().buffer(), parser.source().size());
+        parser.apply({ .offset = text.find("2"), .length = 1, .text = "20 + 22" });
+        require_same_as_full_parse(parser);
+
+        const auto& after = parser.decls();
+        REQUIRE(after.size() == 3);
+        REQUIRE(after[0] == before[0]);
+        REQUIRE(after[1] != before[1]);
+        REQUIRE(after[2] == before[2]);
+    }
+
+    SECTION("edits that change declaration boundaries") {
+        arc::incremental_parser parser("func a() : u64 { return 1; }\nfunc b() : u64 { return 2; }\n");
+
+        // Opening a block swallows the next function until it is closed again.
+        parser.apply({ .offset = 17, .length = 0, .text = "{ " });
+        require_same_as_full_parse(parser);
+        REQUIRE(parser.parse_errors().size() > 0);
+
+        parser.apply({ .offset = 17, .length = 2, .text = "" });
+        require_same_as_full_parse(parser);
+        REQUIRE(parser.parse_errors().empty());
+        REQUIRE(parser.decls().size() == 2);
+
+        // Joining and splitting lines.
+        parser.apply({ .offset = 28, .length = 1, .text = " " });
+        require_same_as_full_parse(parser);
+        parser.apply({ .offset = 0, .length = 0, .text = "alias t = u64;\n" });
+        require_same_as_full_parse(parser);
+        REQUIRE(parser.decls().size() == 3);
+
+        parser.apply({ .offset = 0, .length = parser.source().size(), .text = "" });
+        require_same_as_full_parse(parser);
+        REQUIRE(parser.decls().empty());
+    }
+
+    SECTION("edits outside the file are rejected") {
+        arc::incremental_parser parser("func a() : u64 { return 1; }");
+        REQUIRE_THROWS_AS(parser.apply({ .offset = 20, .length = 20, .text = "" }), arc::internal_exception);
+    }
+
+    SECTION("randomized edits") {
+        const char* fragments[] = {
+            "func", "struct", "alias", "import", "namespace", "let", "const", "return", "if", "elif", "else",
+            "{", "}", "(", ")", ";", ":", ",", "=", "+", "*", "->", " as ", "u64", "name", "42",
+            "99999999999999999999999", "@", " ", "\n", "\n\n",
+            "func f(a: u64) : u64 { return a; }\n", "let x: u64 = 1 + 2;", "if a { return; } else { }"
+        };
+
+        std::mt19937 random(12345);
+        auto pick = [&](size_t count) {
+            return std::uniform_int_distribution<size_t>(0, count)(random);
+        };
+
+        arc::incremental_parser parser(generate_bench_module(10));
+        for(size_t i = 0; i < 400; i++)
+        {
+            std::string_view text(parser.source().buffer(), parser.source().size());
+            auto offset = pick(text.size());
+            auto length = std::min(pick(16), text.size() - offset);
+
+            // Mostly small insertions and deletions like typing, with the odd
+            // paste of some other part of the file.
+            std::string replacement;
+            if(pick(9) == 0 && !text.empty())
+            {
+                auto from = pick(text.size() - 1);
+                replacement = text.substr(from, pick(200));
+            }
+            else if(pick(2) != 0)
+            {
+                replacement = fragments[pick(std::size(fragments) - 1)];
+            }
+
+            INFO("edit " << i << ": " << length << " bytes at " << offset << " replaced with '" << replacement << "'");
+            parser.apply({ .offset = offset, .length = length, .text = replacement });
+            require_same_as_full_parse(parser);
+        }
+    }
+}
@@ -1,6 +1,8 @@
 #include "catch.hpp"
 
 #include "../lex/lexer.h"
+#include "../lex/scanner.h"
+#include "bench_corpus.h"
 
 TEST_CASE("lexer completes or fails properly", "[lexer]")
 {
@@ -27,6 +29,34 @@ TEST_CASE("lexer completes or fails properly", "[lexer]")
         REQUIRE(!result.succeeded());
     }
 
+    SECTION("integer literal overflow fail") {
+        auto too_large = {
+            "18446744073709551616",
+            "0x10000000000000000",
+            "0o2000000000000000000000",
+            "0b10000000000000000000000000000000000000000000000000000000000000000"
+        };
+
+        for(auto literal : too_large)
+        {
+            arc::source_file input(literal, true);
+            REQUIRE(!arc::lexer(input).lex().succeeded());
+        }
+
+        arc::source_file input("18446744073709551615 0xFFFFFFFFFFFFFFFF 0o1777777777777777777777", true);
+        REQUIRE(arc::lexer(input).lex().succeeded());
+    }
+
+    SECTION("integer literal overflow in the middle of a chunk fail") {
+        arc::source_file input("99999999999999999999999", true);
+        REQUIRE(!arc::lexer(input).lex().succeeded());
+    }
+
+    SECTION("float literal out of range fail") {
+        arc::source_file input("1e400", true);
+        REQUIRE(!arc::lexer(input).lex().succeeded());
+    }
+
     SECTION("malformed binary literal fail") {
         arc::source_file input("0b2", true);
         auto result = arc::lexer(input).lex();
@@ -78,24 +108,32 @@ TEST_CASE("lexer lexes correct token types", "[lexer]")
     }
 
     SECTION("keywords") {
-        arc::source_file input("func return if as", true);
+        std::string source;
+        for(const auto& kw : arc::keywords)
+        {
+            source += std::string(kw.text) + " ";
+        }
+
+        arc::source_file input(source, true);
         auto tokens = arc::lexer(input).lex().tokens;
 
-        auto expected_types = {
-            arc::token_type::func,
-            arc::token_type::return_,
-            arc::token_type::if_,
-            arc::token_type::as,
-            arc::token_type::eof
-        };
+        REQUIRE(tokens.size() == std::size(arc::keywords) + 1);
 
-        REQUIRE(tokens.size() == expected_types.size());
+        for(size_t i = 0; i < std::size(arc::keywords); i++)
+        {
+            REQUIRE(tokens[i].type == arc::keywords[i].type);
+        }
+    }
 
-        int i = 0;
-        for(auto expected : expected_types)
+    SECTION("keyword lookalikes") {
+        arc::source_file input("fun funcs Func iff _if as_ elsif structs true1 falsey namespac", true);
+        auto tokens = arc::lexer(input).lex().tokens;
+
+        REQUIRE(tokens.size() == 12);
+
+        for(size_t i = 0; i < tokens.size() - 1; i++)
         {
-            REQUIRE(tokens[i].type == expected);
-            i++;
+            REQUIRE(tokens[i].type == arc::token_type::identifier);
         }
     }
 
@@ -214,11 +252,11 @@ TEST_CASE("lexer parses correct token values", "[lexer]")
         REQUIRE(tokens.size() == 3);
 
         auto& t1 = tokens[0];
-        REQUIRE(t1.has_type<bool>());
+        REQUIRE(t1.type == arc::token_type::boolean);
         REQUIRE(t1.val_boolean() == true);
 
         auto& t2 = tokens[1];
-        REQUIRE(t2.has_type<bool>());
+        REQUIRE(t2.type == arc::token_type::boolean);
         REQUIRE(t2.val_boolean() == false);
     }
 
@@ -229,22 +267,47 @@ TEST_CASE("lexer parses correct token values", "[lexer]")
         REQUIRE(tokens.size() == 5);
 
         auto& t1 = tokens[0];
-        REQUIRE(t1.has_type<uint64_t>());
+        REQUIRE(t1.type == arc::token_type::integer);
         REQUIRE(t1.val_integer() == 12345);
 
         auto& t2 = tokens[1];
-        REQUIRE(t2.has_type<uint64_t>());
+        REQUIRE(t2.type == arc::token_type::integer);
         REQUIRE(t2.val_integer() == 11);
 
         auto& t3 = tokens[2];
-        REQUIRE(t3.has_type<uint64_t>());
+        REQUIRE(t3.type == arc::token_type::integer);
         REQUIRE(t3.val_integer() == 2390);
 
         auto& t4 = tokens[3];
-        REQUIRE(t4.has_type<uint64_t>());
+        REQUIRE(t4.type == arc::token_type::integer);
         REQUIRE(t4.val_integer() == 0xABC2);
     }
 
+    SECTION("hex digits in either case") {
+        arc::source_file input("0xabcdef 0xABCDEF 0xaBc9", true);
+        auto tokens = arc::lexer(input).lex().tokens;
+
+        REQUIRE(tokens.size() == 4);
+        REQUIRE(tokens[0].val_integer() == 0xABCDEF);
+        REQUIRE(tokens[1].val_integer() == 0xABCDEF);
+        REQUIRE(tokens[2].val_integer() == 0xABC9);
+    }
+
+    SECTION("long decimal integers") {
+        // Lengths either side of the 8 digit chunks.
+        std::string digits = "1234567890123456789";
+        for(size_t length = 1; length <= digits.size(); length++)
+        {
+            auto literal = digits.substr(0, length);
+            arc::source_file input(literal + " " + literal + "x", true);
+            auto tokens = arc::lexer(input).lex().tokens;
+
+            REQUIRE(tokens.size() == 4);
+            REQUIRE(tokens[0].val_integer() == std::stoull(literal));
+            REQUIRE(tokens[1].val_integer() == std::stoull(literal));
+        }
+    }
+
     SECTION("floats") {
         arc::source_file input("3.1415926535 2.0 2.5", true);
         auto tokens = arc::lexer(input).lex().tokens;
@@ -252,18 +315,53 @@ TEST_CASE("lexer parses correct token values", "[lexer]")
         REQUIRE(tokens.size() == 4);
 
         auto& t1 = tokens[0];
-        REQUIRE(t1.has_type<double>());
+        REQUIRE(t1.type == arc::token_type::float_);
         REQUIRE(t1.val_double() == Approx(3.1415926535));
 
         auto& t2 = tokens[1];
-        REQUIRE(t2.has_type<double>());
+        REQUIRE(t2.type == arc::token_type::float_);
         REQUIRE(t2.val_double() == Approx(2.0));
 
         auto& t3 = tokens[2];
-        REQUIRE(t3.has_type<double>());
+        REQUIRE(t3.type == arc::token_type::float_);
         REQUIRE(t3.val_double() == Approx(2.5));
     }
 
+    SECTION("floats are correctly rounded") {
+        arc::source_file input("0.1 0.3 2.2250738585072014 123456789012345678901234.5", true);
+        auto tokens = arc::lexer(input).lex().tokens;
+
+        REQUIRE(tokens.size() == 5);
+        REQUIRE(tokens[0].val_double() == 0.1);
+        REQUIRE(tokens[1].val_double() == 0.3);
+        REQUIRE(tokens[2].val_double() == 2.2250738585072014);
+        REQUIRE(tokens[3].val_double() == 123456789012345678901234.5);
+    }
+
+    SECTION("exponents") {
+        arc::source_file input("1e3 2.5E-2 6e+1 1.e2 7e x1e5", true);
+        auto tokens = arc::lexer(input).lex().tokens;
+
+        REQUIRE(tokens.size() == 8);
+
+        REQUIRE(tokens[0].type == arc::token_type::float_);
+        REQUIRE(tokens[0].val_double() == 1e3);
+        REQUIRE(tokens[1].type == arc::token_type::float_);
+        REQUIRE(tokens[1].val_double() == 2.5e-2);
+        REQUIRE(tokens[2].type == arc::token_type::float_);
+        REQUIRE(tokens[2].val_double() == 6e1);
+        REQUIRE(tokens[3].type == arc::token_type::float_);
+        REQUIRE(tokens[3].val_double() == 1e2);
+
+        // Without digits after it the 'e' is not part of the literal.
+        REQUIRE(tokens[4].type == arc::token_type::integer);
+        REQUIRE(tokens[4].val_integer() == 7);
+        REQUIRE(tokens[5].type == arc::token_type::identifier);
+        REQUIRE(tokens[5].text(input) == "e");
+        REQUIRE(tokens[6].type == arc::token_type::identifier);
+        REQUIRE(tokens[6].text(input) == "x1e5");
+    }
+
     SECTION("identifiers") {
         arc::source_file input("test.b _a12 7test", true);
         auto tokens = arc::lexer(input).lex().tokens;
@@ -271,19 +369,130 @@ TEST_CASE("lexer parses correct token values", "[lexer]")
         REQUIRE(tokens.size() == 7);
 
         auto& t1 = tokens[0];
-        REQUIRE(t1.has_type<std::string>());
-        REQUIRE(t1.val_string() == "test");
+        REQUIRE(t1.type == arc::token_type::identifier);
+        REQUIRE(t1.text(input) == "test");
 
         auto& t2 = tokens[2];
-        REQUIRE(t2.has_type<std::string>());
-        REQUIRE(t2.val_string() == "b");
+        REQUIRE(t2.type == arc::token_type::identifier);
+        REQUIRE(t2.text(input) == "b");
 
         auto& t3 = tokens[3];
-        REQUIRE(t3.has_type<std::string>());
-        REQUIRE(t3.val_string() == "_a12");
+        REQUIRE(t3.type == arc::token_type::identifier);
+        REQUIRE(t3.text(input) == "_a12");
 
         auto& t4 = tokens[5];
-        REQUIRE(t4.has_type<std::string>());
-        REQUIRE(t4.val_string() == "test");
+        REQUIRE(t4.type == arc::token_type::identifier);
+        REQUIRE(t4.text(input) == "test");
+    }
+
+    SECTION("token text") {
+        arc::source_file input("func <<= 0x1F 2.5 true", true);
+        auto tokens = arc::lexer(input).lex().tokens;
+
+        REQUIRE(tokens.size() == 6);
+        REQUIRE(tokens[0].text(input) == "func");
+        REQUIRE(tokens[1].text(input) == "<<=");
+        REQUIRE(tokens[2].text(input) == "0x1F");
+        REQUIRE(tokens[3].text(input) == "2.5");
+        REQUIRE(tokens[4].text(input) == "true");
+        REQUIRE(tokens[5].text(input) == "");
+    }
+}
+
+TEST_CASE("scanners find the end of character runs", "[lexer]")
+{
+    // Run lengths either side of the 16 and 32 byte vector widths.
+    for(size_t length = 0; length < 80; length++)
+    {
+        auto whitespace = std::string(length, ' ') + "x";
+        REQUIRE(arc::scan_whitespace(whitespace.data(), whitespace.size()) == length);
+
+        auto identifier = std::string(length, 'a') + "+";
+        REQUIRE(arc::scan_identifier(identifier.data(), identifier.size()) == length);
+
+        auto digits = std::string(length, '7') + "a";
+        REQUIRE(arc::scan_digits(digits.data(), digits.size()) == length);
+    }
+
+    std::string mixed = "\t\r\n Az_09[";
+    REQUIRE(arc::scan_whitespace(mixed.data(), mixed.size()) == 4);
+    REQUIRE(arc::scan_identifier(mixed.data() + 4, mixed.size() - 4) == 5);
+    REQUIRE(arc::scan_identifier("@`{[/:", 6) == 0);
+    REQUIRE(arc::scan_whitespace("    ", 4) == 4);
+}
+
+TEST_CASE("lexer positions are byte offsets", "[lexer]")
+{
+    arc::source_file input("a\n" + std::string(40, ' ') + "b \n\n  \t c", true);
+    auto tokens = arc::lexer(input).lex().tokens;
+
+    REQUIRE(tokens.size() == 4);
+    REQUIRE(tokens[0].position.offset == 0);
+    REQUIRE(tokens[1].position.offset == 42);
+    REQUIRE(tokens[2].position.offset == 50);
+    REQUIRE(tokens[3].position.offset == input.size());
+    REQUIRE(tokens[0].position.file == input.id());
+
+    auto location = input.location(tokens[1].position);
+    REQUIRE(location.line == 2);
+    REQUIRE(location.column == 41);
+
+    location = input.location(tokens[2].position);
+    REQUIRE(location.line == 4);
+    REQUIRE(location.column == 5);
+}
+
+TEST_CASE("parallel lexing matches serial lexing", "[lexer]")
+{
+    auto source = generate_bench_module(300);
+
+    // Sprinkle in some bad characters so errors have to be merged as well.
+    for(size_t i = 1000; i < source.size(); i += 7919)
+    {
+        source[i] = '#';
     }
+
+    arc::source_file input(source, true);
+    arc::thread_pool pool(4);
+
+    auto serial = arc::lexer(input).lex();
+    auto parallel = arc::lexer::lex_parallel(input, pool, 1024);
+
+    REQUIRE(serial.tokens.size() == parallel.tokens.size());
+    for(size_t i = 0; i < serial.tokens.size(); i++)
+    {
+        const auto& s = serial.tokens[i];
+        const auto& p = parallel.tokens[i];
+        REQUIRE(s.type == p.type);
+        REQUIRE(s.length == p.length);
+        REQUIRE(s.position.offset == p.position.offset);
+        REQUIRE(s.position.file == p.position.file);
+        REQUIRE(s.payload.integer == p.payload.integer);
+    }
+
+    REQUIRE(serial.errors.size() > 0);
+    REQUIRE(serial.errors.size() == parallel.errors.size());
+    for(size_t i = 0; i < serial.errors.size(); i++)
+    {
+        REQUIRE(serial.errors[i].error == parallel.errors[i].error);
+        REQUIRE(serial.errors[i].position.offset == parallel.errors[i].position.offset);
+    }
+}
+
+TEST_CASE("identifiers are interned as symbols", "[lexer]")
+{
+    arc::source_file input("apple banana apple func banana_split", true);
+    auto tokens = arc::lexer(input).lex().tokens;
+
+    REQUIRE(tokens.size() == 6);
+    REQUIRE(tokens[0].val_symbol() == tokens[2].val_symbol());
+    REQUIRE(tokens[0].val_symbol() != tokens[1].val_symbol());
+    REQUIRE(tokens[1].val_symbol() != tokens[4].val_symbol());
+    REQUIRE(tokens[0].val_symbol() == arc::symbol::intern("apple"));
+    REQUIRE(tokens[1].val_symbol().text() == "banana");
+    REQUIRE(tokens[4].val_symbol().text() == "banana_split");
+
+    // Keywords aren't identifiers and have no name of their own.
+    REQUIRE(tokens[3].val_symbol() == arc::symbol());
+    REQUIRE(arc::symbol().text().empty());
 }
@@ -2,45 +2,78 @@
 
 #include "../lex/lexer.h"
 #include "../parse/parser.h"
+#include "../parse/flat_ast.h"
+#include "../util/thread_pool.h"
+#include "bench_corpus.h"
 
 namespace
 {
-    bool expr_equals(const std::shared_ptr<arc::expr>& lhs, const std::shared_ptr<arc::expr>& rhs)
+    // Nodes built by the tests are kept around until the end of the run.
+    arc::arena arena;
+
+    bool expr_equals(arc::expr* lhs, arc::expr* rhs)
     {
         return *lhs == *rhs;
     }
     
-    bool typespec_equals(const std::shared_ptr<arc::typespec>& lhs, const std::shared_ptr<arc::typespec>& rhs)
+    bool typespec_equals(arc::typespec* lhs, arc::typespec* rhs)
     {
         return *lhs == *rhs;
     }
     
-    bool stmt_equals(const std::shared_ptr<arc::stmt>& lhs, const std::shared_ptr<arc::stmt>& rhs)
+    bool stmt_equals(arc::stmt* lhs, arc::stmt* rhs)
     {
         return *lhs == *rhs;
     }
 
-    bool decl_equals(const std::shared_ptr<arc::decl>& lhs, const std::shared_ptr<arc::decl>& rhs)
+    bool decl_equals(arc::decl* lhs, arc::decl* rhs)
     {
         return *lhs == *rhs;
     }
+
+    // Compares the flattened form, which also covers positions.
+    bool module_identical(const std::vector<arc::decl*>& lhs, const std::vector<arc::decl*>& rhs)
+    {
+        auto l = arc::flatten(lhs);
+        auto r = arc::flatten(rhs);
+
+        if(l.nodes.size() != r.nodes.size() || l.extra != r.extra || l.strings != r.strings || l.module != r.module)
+        {
+            return false;
+        }
+
+        for(size_t i = 0; i < l.nodes.size(); i++)
+        {
+            const auto& a = l.nodes[i];
+            const auto& b = r.nodes[i];
+            if(a.kind != b.kind || a.op != b.op || a.lhs != b.lhs || a.rhs != b.rhs)
+            {
+                return false;
+            }
+            if(l.positions[i].offset != r.positions[i].offset || l.positions[i].file != r.positions[i].file)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
 }
 
 TEST_CASE("expression parsing completes or fails properly", "[parser]")
 {
     SECTION("basic pass case") {
         arc::source_file input("(1 + 2) + (3 - 4) + (5 * 6) + (7 / 8)", true);
-        REQUIRE_NOTHROW(arc::parser(arc::lexer(input).lex().tokens, input).parse_expr());
+        REQUIRE_NOTHROW(arc::parser(arc::lexer(input).lex().tokens, input, arena).parse_expr());
     }
     
     SECTION("expected expression fail") {
         arc::source_file input("()", true);
-        REQUIRE_THROWS(arc::parser(arc::lexer(input).lex().tokens, input).parse_expr());
+        REQUIRE_THROWS(arc::parser(arc::lexer(input).lex().tokens, input, arena).parse_expr());
     }
     
     SECTION("mismatched parenthesis fail") {
         arc::source_file input("1 + ((2)", true);
-        REQUIRE_THROWS(arc::parser(arc::lexer(input).lex().tokens, input).parse_expr());
+        REQUIRE_THROWS(arc::parser(arc::lexer(input).lex().tokens, input, arena).parse_expr());
     }
 }
 
@@ -49,12 +82,13 @@ TEST_CASE("expression parsing produces correct ast", "[parser]")
     SECTION("basic expression case") {
         arc::source_file input("1 + 2", true);
         auto tokens = arc::lexer(input).lex().tokens;
-        auto expr = arc::parser(tokens, input).parse_expr();
+        auto expr = arc::parser(tokens, input, arena).parse_expr();
 
         auto expected = arc::make_binary_expr(
+            arena,
             arc::binary_op::add,
-            arc::make_integer_expr(1),
-            arc::make_integer_expr(2)
+            arc::make_integer_expr(arena, 1),
+            arc::make_integer_expr(arena, 2)
         );
 
         REQUIRE(expr_equals(expr, expected));
@@ -63,34 +97,42 @@ TEST_CASE("expression parsing produces correct ast", "[parser]")
     SECTION("complex expression case") {
         arc::source_file input("-1 + 2 / 3 == hello.world - my.array[7]", true);
         auto tokens = arc::lexer(input).lex().tokens;
-        auto expr = arc::parser(tokens, input).parse_expr();
+        auto expr = arc::parser(tokens, input, arena).parse_expr();
     
         auto expected = arc::make_binary_expr(
+            arena,
             arc::binary_op::equality,
             arc::make_binary_expr(
+                arena,
                 arc::binary_op::add,
                 arc::make_unary_expr(
+                    arena,
                     arc::unary_op::negative,
-                    arc::make_integer_expr(1)
+                    arc::make_integer_expr(arena, 1)
                 ),
                 arc::make_binary_expr(
+                    arena,
                     arc::binary_op::div,
-                    arc::make_integer_expr(2),
-                    arc::make_integer_expr(3)
+                    arc::make_integer_expr(arena, 2),
+                    arc::make_integer_expr(arena, 3)
                 )
             ),
             arc::make_binary_expr(
+                arena,
                 arc::binary_op::sub,
                 arc::make_access_expr(
-                    arc::make_name_expr("hello"),
+                    arena,
+                    arc::make_name_expr(arena, "hello"),
                     "world"
                 ),
                 arc::make_index_expr(
+                    arena,
                     arc::make_access_expr(
-                        arc::make_name_expr("my"),
+                        arena,
+                        arc::make_name_expr(arena, "my"),
                         "array"
                     ),
-                    arc::make_integer_expr(7)
+                    arc::make_integer_expr(arena, 7)
                 )
             )
         );
@@ -101,17 +143,19 @@ TEST_CASE("expression parsing produces correct ast", "[parser]")
     SECTION("function call") {
         arc::source_file input("some.function(1, 2, 3)", true);
         auto tokens = arc::lexer(input).lex().tokens;
-        auto expr = arc::parser(tokens, input).parse_expr();
+        auto expr = arc::parser(tokens, input, arena).parse_expr();
     
         auto expected = arc::make_call_expr(
+            arena,
             arc::make_access_expr(
-                arc::make_name_expr("some"),
+                arena,
+                arc::make_name_expr(arena, "some"),
                 "function"
             ),
             {
-                arc::make_integer_expr(1),
-                arc::make_integer_expr(2),
-                arc::make_integer_expr(3)    
+                arc::make_integer_expr(arena, 1),
+                arc::make_integer_expr(arena, 2),
+                arc::make_integer_expr(arena, 3)    
             }
         );
 
@@ -121,26 +165,32 @@ TEST_CASE("expression parsing produces correct ast", "[parser]")
     SECTION("casting") {
         arc::source_file input("123 == ~my_data.field++ as u32 as u8", true);
         auto tokens = arc::lexer(input).lex().tokens;
-        auto expr = arc::parser(tokens, input).parse_expr();
+        auto expr = arc::parser(tokens, input, arena).parse_expr();
 
         auto expected = arc::make_binary_expr(
+            arena,
             arc::binary_op::equality,
-            arc::make_integer_expr(123),
+            arc::make_integer_expr(arena, 123),
             arc::make_cast_expr(
+                arena,
                 arc::make_cast_expr(
+                    arena,
                     arc::make_unary_expr(
+                        arena,
                         arc::unary_op::bitwise_not,
                         arc::make_unary_expr(
+                            arena,
                             arc::unary_op::postfix_add,
                             arc::make_access_expr(
-                                arc::make_name_expr("my_data"),
+                                arena,
+                                arc::make_name_expr(arena, "my_data"),
                                 "field"
                             )
                         )
                     ),
-                    arc::make_name_typespec("u32")
+                    arc::make_name_typespec(arena, "u32")
                 ),
-                arc::make_name_typespec("u8")
+                arc::make_name_typespec(arena, "u8")
             )
         );
 
@@ -150,12 +200,71 @@ TEST_CASE("expression parsing produces correct ast", "[parser]")
     SECTION("boolean literals") {
         arc::source_file input("true == false", true);
         auto tokens = arc::lexer(input).lex().tokens;
-        auto expr = arc::parser(tokens, input).parse_expr();
+        auto expr = arc::parser(tokens, input, arena).parse_expr();
 
         auto expected = arc::make_binary_expr(
+            arena,
             arc::binary_op::equality,
-            arc::make_boolean_expr(true),
-            arc::make_boolean_expr(false)
+            arc::make_boolean_expr(arena, true),
+            arc::make_boolean_expr(arena, false)
+        );
+
+        REQUIRE(expr_equals(expr, expected));
+    }
+
+    SECTION("assignment is right associative") {
+        arc::source_file input("a = b += c - d - e", true);
+        auto tokens = arc::lexer(input).lex().tokens;
+        auto expr = arc::parser(tokens, input, arena).parse_expr();
+
+        auto expected = arc::make_binary_expr(
+            arena,
+            arc::binary_op::assign,
+            arc::make_name_expr(arena, "a"),
+            arc::make_binary_expr(
+                arena,
+                arc::binary_op::add_assign,
+                arc::make_name_expr(arena, "b"),
+                arc::make_binary_expr(
+                    arena,
+                    arc::binary_op::sub,
+                    arc::make_binary_expr(
+                        arena,
+                        arc::binary_op::sub,
+                        arc::make_name_expr(arena, "c"),
+                        arc::make_name_expr(arena, "d")
+                    ),
+                    arc::make_name_expr(arena, "e")
+                )
+            )
+        );
+
+        REQUIRE(expr_equals(expr, expected));
+    }
+
+    SECTION("casts bind tighter than binary operators but looser than unary ones") {
+        arc::source_file input("-a as u32 * b as u64 || c", true);
+        auto tokens = arc::lexer(input).lex().tokens;
+        auto expr = arc::parser(tokens, input, arena).parse_expr();
+
+        auto expected = arc::make_binary_expr(
+            arena,
+            arc::binary_op::logical_or,
+            arc::make_binary_expr(
+                arena,
+                arc::binary_op::mul,
+                arc::make_cast_expr(
+                    arena,
+                    arc::make_unary_expr(arena, arc::unary_op::negative, arc::make_name_expr(arena, "a")),
+                    arc::make_name_typespec(arena, "u32")
+                ),
+                arc::make_cast_expr(
+                    arena,
+                    arc::make_name_expr(arena, "b"),
+                    arc::make_name_typespec(arena, "u64")
+                )
+            ),
+            arc::make_name_expr(arena, "c")
         );
 
         REQUIRE(expr_equals(expr, expected));
@@ -167,13 +276,13 @@ TEST_CASE("type parsing completes or fails properly", "[parser]")
     SECTION("basic pass case") {
         arc::source_file input("u32 bool u32* u32** (u32, u8):bool ():u8* ():(u8):bool", true);
         auto tokens = arc::lexer(input).lex().tokens;
-        REQUIRE_NOTHROW(arc::parser(tokens, input).parse_typespec());
+        REQUIRE_NOTHROW(arc::parser(tokens, input, arena).parse_typespec());
     }
 
     SECTION("func type fail") {
         arc::source_file input("(u8", true);
         auto tokens = arc::lexer(input).lex().tokens;
-        REQUIRE_THROWS(arc::parser(tokens, input).parse_typespec());
+        REQUIRE_THROWS(arc::parser(tokens, input, arena).parse_typespec());
     }
 }
 
@@ -182,22 +291,22 @@ TEST_CASE("type parsing produces correct ast", "[parser]")
     SECTION("basic types") {
         arc::source_file input("u32 ():none (u32):none (u32, bool):none", true);
         auto tokens = arc::lexer(input).lex().tokens;
-        auto parser = arc::parser(tokens, input);
+        auto parser = arc::parser(tokens, input, arena);
 
-        std::vector<std::shared_ptr<arc::typespec>> expected_types = {
-            arc::make_name_typespec("u32"),
+        std::vector<arc::typespec*> expected_types = {
+            arc::make_name_typespec(arena, "u32"),
 
-            arc::make_func_typespec({
-            }, arc::make_name_typespec("none")),
+            arc::make_func_typespec(arena, {
+            }, arc::make_name_typespec(arena, "none")),
 
-            arc::make_func_typespec({
-                arc::make_name_typespec("u32")
-            }, arc::make_name_typespec("none")),
+            arc::make_func_typespec(arena, {
+                arc::make_name_typespec(arena, "u32")
+            }, arc::make_name_typespec(arena, "none")),
 
-            arc::make_func_typespec({
-                arc::make_name_typespec("u32"),
-                arc::make_name_typespec("bool")
-            }, arc::make_name_typespec("none"))
+            arc::make_func_typespec(arena, {
+                arc::make_name_typespec(arena, "u32"),
+                arc::make_name_typespec(arena, "bool")
+            }, arc::make_name_typespec(arena, "none"))
         };
 
         for(const auto& expected : expected_types)
@@ -209,31 +318,39 @@ TEST_CASE("type parsing produces correct ast", "[parser]")
     SECTION("pointer types") {
         arc::source_file input("*u32 **u32 ***u32 *():*u32", true);
         auto tokens = arc::lexer(input).lex().tokens;
-        auto parser = arc::parser(tokens, input);
+        auto parser = arc::parser(tokens, input, arena);
 
-        std::vector<std::shared_ptr<arc::typespec>> expected_types = {
+        std::vector<arc::typespec*> expected_types = {
             arc::make_pointer_typespec(
-                arc::make_name_typespec("u32")
+                arena,
+                arc::make_name_typespec(arena, "u32")
             ),
 
             arc::make_pointer_typespec(
+                arena,
                 arc::make_pointer_typespec(
-                    arc::make_name_typespec("u32")
+                    arena,
+                    arc::make_name_typespec(arena, "u32")
                 )
             ),
 
             arc::make_pointer_typespec(
+                arena,
                 arc::make_pointer_typespec(
+                    arena,
                     arc::make_pointer_typespec(
-                        arc::make_name_typespec("u32")
+                        arena,
+                        arc::make_name_typespec(arena, "u32")
                     )
                 )
             ),
 
             arc::make_pointer_typespec(
-                arc::make_func_typespec({
+                arena,
+                arc::make_func_typespec(arena, {
                 }, arc::make_pointer_typespec(
-                    arc::make_name_typespec("u32")
+                    arena,
+                    arc::make_name_typespec(arena, "u32")
                 ))
             )
         };
@@ -265,50 +382,58 @@ TEST_CASE("statement parsing produces correct ast", "[parser]")
         )", true);
 
         auto tokens = arc::lexer(input).lex().tokens;
-        auto parser = arc::parser(tokens, input);
+        auto parser = arc::parser(tokens, input, arena);
 
         auto stmt = parser.parse_stmt();
 
-        auto expected = arc::make_if_stmt({
-            arc::if_branch(
+        auto expected = arc::make_if_stmt(arena, {
+            arc::make_if_branch(
+                arena,
                 arc::make_binary_expr(
+                    arena,
                     arc::binary_op::equality,
-                    arc::make_integer_expr(1),
-                    arc::make_integer_expr(1)
+                    arc::make_integer_expr(arena, 1),
+                    arc::make_integer_expr(arena, 1)
                 ),
                 {
                     arc::make_expr_stmt(
+                        arena,
                         arc::make_binary_expr(
+                            arena,
                             arc::binary_op::add,
-                            arc::make_integer_expr(1),
-                            arc::make_integer_expr(1)
+                            arc::make_integer_expr(arena, 1),
+                            arc::make_integer_expr(arena, 1)
                         )
                     )
                 }
             ),
-            arc::if_branch(
+            arc::make_if_branch(
+                arena,
                 arc::make_binary_expr(
+                    arena,
                     arc::binary_op::equality,
-                    arc::make_integer_expr(2),
-                    arc::make_integer_expr(2)
+                    arc::make_integer_expr(arena, 2),
+                    arc::make_integer_expr(arena, 2)
                 ),
                 {
-                    arc::make_let_stmt("a", nullptr, arc::make_integer_expr(2)),
-                    arc::make_let_stmt("b", arc::make_name_typespec("u32"), arc::make_integer_expr(2)),
-                    arc::make_let_stmt("c", arc::make_name_typespec("u32"), nullptr)
+                    arc::make_let_stmt(arena, "a", nullptr, arc::make_integer_expr(arena, 2)),
+                    arc::make_let_stmt(arena, "b", arc::make_name_typespec(arena, "u32"), arc::make_integer_expr(arena, 2)),
+                    arc::make_let_stmt(arena, "c", arc::make_name_typespec(arena, "u32"), nullptr)
                 }
             ),
-            arc::if_branch(
-                arc::make_boolean_expr(true),
+            arc::make_if_branch(
+                arena,
+                arc::make_boolean_expr(arena, true),
                 {
-                    arc::make_const_stmt("a", nullptr, arc::make_integer_expr(2)),
-                    arc::make_const_stmt("b", arc::make_name_typespec("u32"), arc::make_integer_expr(2)),
-                    arc::make_const_stmt("c", arc::make_name_typespec("u32"), nullptr)
+                    arc::make_const_stmt(arena, "a", nullptr, arc::make_integer_expr(arena, 2)),
+                    arc::make_const_stmt(arena, "b", arc::make_name_typespec(arena, "u32"), arc::make_integer_expr(arena, 2)),
+                    arc::make_const_stmt(arena, "c", arc::make_name_typespec(arena, "u32"), nullptr)
                 }
             )
         }, {
             arc::make_return_stmt(
-                arc::make_boolean_expr(true)
+                arena,
+                arc::make_boolean_expr(arena, true)
             )
         });
 
@@ -321,9 +446,9 @@ TEST_CASE("decl parsing produces correct ast", "[parser]")
     SECTION("import") {
         arc::source_file input("import std;", true);
         auto tokens = arc::lexer(input).lex().tokens;
-        auto decl = arc::parser(tokens, input).parse_decl();
+        auto decl = arc::parser(tokens, input, arena).parse_decl();
 
-        auto expected = arc::make_import_decl("std");
+        auto expected = arc::make_import_decl(arena, "std");
 
         REQUIRE(decl_equals(decl, expected));
     }
@@ -331,9 +456,9 @@ TEST_CASE("decl parsing produces correct ast", "[parser]")
     SECTION("namespace") {
         arc::source_file input("namespace std;", true);
         auto tokens = arc::lexer(input).lex().tokens;
-        auto decl = arc::parser(tokens, input).parse_decl();
+        auto decl = arc::parser(tokens, input, arena).parse_decl();
 
-        auto expected = arc::make_namespace_decl("std");
+        auto expected = arc::make_namespace_decl(arena, "std");
 
         REQUIRE(decl_equals(decl, expected));
     }
@@ -341,12 +466,14 @@ TEST_CASE("decl parsing produces correct ast", "[parser]")
     SECTION("alias") {
         arc::source_file input("alias my_type = *u32;", true);
         auto tokens = arc::lexer(input).lex().tokens;
-        auto decl = arc::parser(tokens, input).parse_decl();
+        auto decl = arc::parser(tokens, input, arena).parse_decl();
 
         auto expected = arc::make_alias_decl(
+            arena,
             "my_type",
             arc::make_pointer_typespec(
-                arc::make_name_typespec("u32")
+                arena,
+                arc::make_name_typespec(arena, "u32")
             )
         );
 
@@ -360,27 +487,33 @@ TEST_CASE("decl parsing produces correct ast", "[parser]")
             }
         )", true);
         auto tokens = arc::lexer(input).lex().tokens;
-        auto decl = arc::parser(tokens, input).parse_decl();
+        auto decl = arc::parser(tokens, input, arena).parse_decl();
 
         auto expected = arc::make_func_decl(
+            arena,
             "main",
             {
-                arc::func_arg("argc", arc::make_name_typespec("u32")),
-                arc::func_arg("argv", arc::make_pointer_typespec(
+                arc::func_arg("argc", arc::symbol::intern("argc"), arc::make_name_typespec(arena, "u32")),
+                arc::func_arg("argv", arc::symbol::intern("argv"), arc::make_pointer_typespec(
+                    arena,
                     arc::make_pointer_typespec(
-                        arc::make_name_typespec("u8")
+                        arena,
+                        arc::make_name_typespec(arena, "u8")
                     )
                 ))
             },
-            arc::make_name_typespec("u32"),
+            arc::make_name_typespec(arena, "u32"),
             {
                 arc::make_return_stmt(
+                    arena,
                     arc::make_index_expr(
-                        arc::make_name_expr("argv"),
+                        arena,
+                        arc::make_name_expr(arena, "argv"),
                         arc::make_binary_expr(
+                            arena,
                             arc::binary_op::sub,
-                            arc::make_name_expr("argc"),
-                            arc::make_integer_expr(1)
+                            arc::make_name_expr(arena, "argc"),
+                            arc::make_integer_expr(arena, 1)
                         )
                     )
                 )
@@ -402,22 +535,24 @@ TEST_CASE("decl parsing produces correct ast", "[parser]")
             }
         )", true);
         auto tokens = arc::lexer(input).lex().tokens;
-        auto decl = arc::parser(tokens, input).parse_decl();
+        auto decl = arc::parser(tokens, input, arena).parse_decl();
 
         auto expected = arc::make_struct_decl(
+            arena,
             "some_data",
             {
-                arc::struct_field("my_field", arc::make_name_typespec("u32")),
-                arc::struct_field("a_pointer", arc::make_pointer_typespec(arc::make_name_typespec("bool"))),
+                arc::struct_field("my_field", arc::make_name_typespec(arena, "u32")),
+                arc::struct_field("a_pointer", arc::make_pointer_typespec(arena, arc::make_name_typespec(arena, "bool"))),
             },
             {
                 arc::make_func_decl(
+                    arena,
                     "member_function",
                     {
                     },
-                    arc::make_name_typespec("bool"),
+                    arc::make_name_typespec(arena, "bool"),
                     {
-                        arc::make_return_stmt(arc::make_boolean_expr(true))
+                        arc::make_return_stmt(arena, arc::make_boolean_expr(arena, true))
                     }
                 )
             }
@@ -426,3 +561,316 @@ TEST_CASE("decl parsing produces correct ast", "[parser]")
         REQUIRE(decl_equals(decl, expected));
     }
 }
+
+TEST_CASE("streaming parsing matches parsing a lexed token vector", "[parser]")
+{
+    // Large enough that the token stream has to refill many times.
+    arc::source_file input(generate_bench_module(50), true);
+
+    auto tokens = arc::lexer(input).lex().tokens;
+    REQUIRE(tokens.size() > 4 * arc::token_stream::stream_batch_size);
+    auto expected = arc::parser(tokens, input, arena).parse_module();
+
+    arc::lexer lexer(input);
+    auto decls = arc::parser(lexer, input, arena).parse_module();
+
+    REQUIRE(lexer.errors().empty());
+    REQUIRE(decls.size() == expected.size());
+    for(size_t i = 0; i < decls.size(); i++)
+    {
+        REQUIRE(decl_equals(decls[i], expected[i]));
+    }
+}
+
+TEST_CASE("recovering parser reports every error and keeps going", "[parser]")
+{
+    auto parse = [](const arc::source_file& input) {
+        auto tokens = arc::lexer(input).lex().tokens;
+        arc::parser parser(tokens, input, arena, arc::parse_mode::recover);
+        auto decls = parser.parse_module();
+
+        std::vector<std::string> errors;
+        for(const auto& error : parser.errors())
+        {
+            errors.push_back(error.what());
+        }
+        return std::make_pair(decls, errors);
+    };
+
+    SECTION("one error per broken statement") {
+        arc::source_file input(R"(
+            func f() : u64 {
+                let a = ;
+                let b = 1 +;
+                return a b;
+                return 1;
+            }
+        )", true);
+        auto [decls, errors] = parse(input);
+
+        REQUIRE(errors == std::vector<std::string> { "expected expression", "expected expression", "expected ';'" });
+        REQUIRE(decls.size() == 1);
+
+        auto func = dynamic_cast<arc::decl_func*>(decls[0]);
+        REQUIRE(func != nullptr);
+        REQUIRE(func->body().size() == 4);
+        REQUIRE(dynamic_cast<arc::stmt_error*>(func->body()[0]) != nullptr);
+        REQUIRE(dynamic_cast<arc::stmt_error*>(func->body()[1]) != nullptr);
+        REQUIRE(dynamic_cast<arc::stmt_error*>(func->body()[2]) != nullptr);
+        REQUIRE(stmt_equals(func->body()[3], arc::make_return_stmt(arena, arc::make_integer_expr(arena, 1))));
+    }
+
+    SECTION("broken declarations are replaced and the rest are kept") {
+        arc::source_file input(R"(
+            func f( : u64 { return 1; }
+            alias a = ;
+            1 + 2;
+            struct s {
+                x: u32;
+                5;
+                y: bool;
+            }
+            import std;
+        )", true);
+        auto [decls, errors] = parse(input);
+
+        REQUIRE(errors == std::vector<std::string> {
+            "expected a variable name",
+            "expected a type",
+            "expected a declaration",
+            "expected field or member function"
+        });
+        REQUIRE(decls.size() == 5);
+        REQUIRE(dynamic_cast<arc::decl_error*>(decls[0]) != nullptr);
+        REQUIRE(dynamic_cast<arc::decl_error*>(decls[1]) != nullptr);
+        REQUIRE(dynamic_cast<arc::decl_error*>(decls[2]) != nullptr);
+
+        auto data = dynamic_cast<arc::decl_struct*>(decls[3]);
+        REQUIRE(data != nullptr);
+        REQUIRE(data->fields.size() == 2);
+
+        REQUIRE(decl_equals(decls[4], arc::make_import_decl(arena, "std")));
+    }
+
+    SECTION("the block of a broken statement is skipped as a whole") {
+        arc::source_file input(R"(
+            func f(a: bool) : u64 {
+                if ) {
+                    a = 1;
+                    { a = 2; }
+                }
+                return 1;
+            }
+        )", true);
+        auto [decls, errors] = parse(input);
+
+        REQUIRE(errors == std::vector<std::string> { "expected expression" });
+        auto func = dynamic_cast<arc::decl_func*>(decls[0]);
+        REQUIRE(func != nullptr);
+        REQUIRE(func->body().size() == 2);
+        REQUIRE(dynamic_cast<arc::stmt_error*>(func->body()[0]) != nullptr);
+        REQUIRE(dynamic_cast<arc::stmt_return*>(func->body()[1]) != nullptr);
+    }
+
+    SECTION("a missing '}' doesn't swallow the next declaration") {
+        arc::source_file input(R"(
+            func f() : u64 {
+                return 1;
+
+            func g() : u64 {
+                return 2;
+            }
+        )", true);
+        auto [decls, errors] = parse(input);
+
+        REQUIRE(errors == std::vector<std::string> { "expected '}'" });
+        REQUIRE(decls.size() == 2);
+        REQUIRE(dynamic_cast<arc::decl_func*>(decls[1]) != nullptr);
+    }
+
+    SECTION("garbage input terminates") {
+        for(auto source : { "}}}", "func", "struct s { func", "((((", "func f() : u64 { { { ;", "let x = 1;", ";;;", "func f() : u64 { let if a { b; } elif c { d; } }" })
+        {
+            arc::source_file input(source, true);
+            auto [decls, errors] = parse(input);
+            REQUIRE(!errors.empty());
+        }
+    }
+
+    SECTION("valid input has no errors") {
+        arc::source_file input(generate_bench_module(5), true);
+        auto [decls, errors] = parse(input);
+        REQUIRE(errors.empty());
+        REQUIRE(arc::flatten(decls).nodes.size() > 0);
+    }
+}
+
+TEST_CASE("parallel parsing matches serial parsing", "[parser]")
+{
+    arc::thread_pool pool(4);
+
+    SECTION("valid module") {
+        arc::source_file input(generate_bench_module(300), true);
+        auto tokens = arc::lexer(input).lex().tokens;
+
+        arc::arena serial_arena;
+        auto serial = arc::parser(tokens, input, serial_arena).parse_module();
+
+        arc::arena parallel_arena;
+        auto parallel = arc::parser(tokens, input, parallel_arena).parse_module(pool, 64);
+
+        REQUIRE(serial.size() == parallel.size());
+        REQUIRE(module_identical(serial, parallel));
+    }
+
+    // Garbage sprinkled over the module, so runs end in the middle of broken
+    // declarations and blocks.
+    auto source = generate_bench_module(300);
+    const char* garbage[] = { "}", "{", ";", "func", ")", "struct", "let" };
+    for(size_t i = 500, n = 0; i < source.size(); i += 1553, n++)
+    {
+        source.insert(i, std::string(" ") + garbage[n % std::size(garbage)] + " ");
+    }
+    arc::source_file input(source, true);
+    auto tokens = arc::lexer(input).lex().tokens;
+
+    SECTION("recovering from errors") {
+        arc::arena serial_arena;
+        arc::parser serial_parser(tokens, input, serial_arena, arc::parse_mode::recover);
+        auto serial = serial_parser.parse_module();
+
+        arc::arena parallel_arena;
+        arc::parser parallel_parser(tokens, input, parallel_arena, arc::parse_mode::recover);
+        auto parallel = parallel_parser.parse_module(pool, 64);
+
+        REQUIRE(serial_parser.errors().size() > 10);
+        REQUIRE(serial_parser.errors().size() == parallel_parser.errors().size());
+        for(size_t i = 0; i < serial_parser.errors().size(); i++)
+        {
+            REQUIRE(serial_parser.errors()[i].error == parallel_parser.errors()[i].error);
+            REQUIRE(serial_parser.errors()[i].position.offset == parallel_parser.errors()[i].position.offset);
+        }
+        REQUIRE(module_identical(serial, parallel));
+    }
+
+    SECTION("strict mode throws the first error") {
+        arc::arena arena;
+        std::string serial_error, parallel_error;
+        uint32_t serial_offset = 0, parallel_offset = 0;
+        try
+        {
+            arc::parser(tokens, input, arena).parse_module();
+        }
+        catch(const arc::line_exception& ex)
+        {
+            serial_error = ex.error;
+            serial_offset = ex.position.offset;
+        }
+        try
+        {
+            arc::parser(tokens, input, arena).parse_module(pool, 64);
+        }
+        catch(const arc::line_exception& ex)
+        {
+            parallel_error = ex.error;
+            parallel_offset = ex.position.offset;
+        }
+
+        REQUIRE(!serial_error.empty());
+        REQUIRE(serial_error == parallel_error);
+        REQUIRE(serial_offset == parallel_offset);
+    }
+}
+
+TEST_CASE("lazy parsing defers function bodies until they are used", "[parser]")
+{
+    SECTION("bodies match an eager parse") {
+        arc::source_file input(generate_bench_module(50), true);
+        auto tokens = arc::lexer(input).lex().tokens;
+
+        arc::arena eager_arena;
+        auto eager = arc::parser(tokens, input, eager_arena).parse_module();
+
+        arc::arena lazy_arena;
+        arc::deferred_bodies bodies(tokens, input, lazy_arena);
+        auto lazy = arc::parser(input, lazy_arena, bodies).parse_module();
+
+        REQUIRE(lazy.size() == eager.size());
+        size_t functions = 0;
+        for(const auto& decl : lazy)
+        {
+            if(auto func = dynamic_cast<arc::decl_func*>(decl))
+            {
+                REQUIRE(!func->body_parsed());
+                REQUIRE(func->arguments.size() == 3);
+                functions++;
+            }
+        }
+        REQUIRE(functions > 0);
+
+        // Flattening walks, and so parses, every body.
+        REQUIRE(module_identical(lazy, eager));
+        for(const auto& decl : lazy)
+        {
+            if(auto func = dynamic_cast<arc::decl_func*>(decl))
+            {
+                REQUIRE(func->body_parsed());
+            }
+        }
+    }
+
+    SECTION("only signatures take less memory") {
+        arc::source_file input(generate_bench_module(200), true);
+        auto tokens = arc::lexer(input).lex().tokens;
+
+        arc::arena eager_arena;
+        arc::parser(tokens, input, eager_arena).parse_module();
+
+        arc::arena lazy_arena;
+        arc::deferred_bodies bodies(tokens, input, lazy_arena);
+        arc::parser(input, lazy_arena, bodies).parse_module();
+
+        REQUIRE(lazy_arena.bytes_reserved() * 3 < eager_arena.bytes_reserved());
+    }
+
+    SECTION("errors in a body show up once it is parsed") {
+        arc::source_file input(R"(
+            struct data {
+                func member() : u64 { let = 1; return 1; }
+            }
+            func f() : u64 { return; }
+            func g() : u64 { return )
+        )", true);
+        auto tokens = arc::lexer(input).lex().tokens;
+
+        arc::arena arena;
+        arc::deferred_bodies bodies(tokens, input, arena, arc::parse_mode::recover);
+        arc::parser parser(input, arena, bodies);
+        auto decls = parser.parse_module();
+
+        // The missing '}' is found while skipping the body.
+        REQUIRE(parser.errors().size() == 1);
+        REQUIRE(std::string(parser.errors()[0].what()) == "expected '}'");
+        REQUIRE(dynamic_cast<arc::decl_error*>(decls[2]) != nullptr);
+        REQUIRE(bodies.errors().empty());
+
+        auto member = dynamic_cast<arc::decl_struct*>(decls[0])->functions[0];
+        REQUIRE(member->body().size() == 2);
+        REQUIRE(dynamic_cast<arc::stmt_error*>(member->body()[0]) != nullptr);
+        REQUIRE(bodies.errors().size() == 1);
+
+        auto func = dynamic_cast<arc::decl_func*>(decls[1]);
+        REQUIRE(func->body().size() == 1);
+        REQUIRE(bodies.errors().size() == 1);
+    }
+
+    SECTION("strict mode throws from the body") {
+        arc::source_file input("func f() : u64 { return 1 }", true);
+        auto tokens = arc::lexer(input).lex().tokens;
+
+        arc::arena arena;
+        arc::deferred_bodies bodies(tokens, input, arena);
+        auto decls = arc::parser(input, arena, bodies).parse_module();
+        REQUIRE_THROWS_AS(dynamic_cast<arc::decl_func*>(decls[0])->body(), arc::line_exception);
+    }
+}
@@ -0,0 +1,124 @@
+#include "catch.hpp"
+
+#include "../util/source_file.h"
+
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    std::string write_temp_file(const std::string& name, const std::string& content)
+    {
+        auto path = (std::filesystem::temp_directory_path() / name).string();
+        std::ofstream output(path, std::ios::binary);
+        output << content;
+        return path;
+    }
+}
+
+TEST_CASE("source files load their contents", "[source_file]")
+{
+    SECTION("missing file") {
+        arc::source_file input("this/file/does/not/exist.arc");
+
+        REQUIRE(!input.exists());
+        REQUIRE(input.size() == 0);
+        REQUIRE(input.buffer()[0] == '\0');
+    }
+
+    SECTION("content") {
+        arc::source_file input("func main", true);
+
+        REQUIRE(input.exists());
+        REQUIRE(input.size() == 9);
+        REQUIRE(input.text(0, 4) == "func");
+        REQUIRE(input.buffer()[input.size()] == '\0');
+    }
+
+    SECTION("mapped file") {
+        std::string content = "import std;\nfunc main() : none {}\n";
+        auto path = write_temp_file("arc_source_file_mapped.arc", content);
+        arc::source_file input(path);
+
+        REQUIRE(input.exists());
+        REQUIRE(input.size() == content.size());
+        REQUIRE(input.text(0, input.size()) == content);
+        REQUIRE(input.buffer()[input.size()] == '\0');
+
+        std::filesystem::remove(path);
+    }
+
+    SECTION("file ending on a page boundary") {
+        std::string content(arc::mapped_file::page_size(), 'a');
+        auto path = write_temp_file("arc_source_file_page.arc", content);
+        arc::source_file input(path);
+
+        REQUIRE(input.exists());
+        REQUIRE(!input.is_mapped());
+        REQUIRE(input.size() == content.size());
+        REQUIRE(input.text(0, input.size()) == content);
+        REQUIRE(input.buffer()[input.size()] == '\0');
+
+        std::filesystem::remove(path);
+    }
+
+    SECTION("empty file") {
+        auto path = write_temp_file("arc_source_file_empty.arc", "");
+        arc::source_file input(path);
+
+        REQUIRE(input.exists());
+        REQUIRE(input.size() == 0);
+        REQUIRE(input.buffer()[0] == '\0');
+
+        std::filesystem::remove(path);
+    }
+
+    SECTION("file too large for 32-bit positions") {
+        // Sparse, so this doesn't need 4 GiB of disk.
+        auto path = write_temp_file("arc_source_file_large.arc", "");
+        std::filesystem::resize_file(path, arc::source_file::max_size + 1);
+
+        REQUIRE_THROWS_AS(arc::source_file(path), std::length_error);
+
+        std::filesystem::remove(path);
+    }
+}
+
+TEST_CASE("source files map offsets to lines and columns", "[source_file]")
+{
+    std::string content = "first\n\nthird line is longer than sixteen bytes\n  fourth";
+    arc::source_file input(content, true);
+
+    SECTION("line text") {
+        REQUIRE(input.line_count() == 4);
+        REQUIRE(input.get_line(1) == "first");
+        REQUIRE(input.get_line(2) == "");
+        REQUIRE(input.get_line(3) == "third line is longer than sixteen bytes");
+        REQUIRE(input.get_line(4) == "  fourth");
+        REQUIRE(input.get_line(5) == "");
+    }
+
+    SECTION("locations") {
+        for(size_t offset = 0; offset <= content.size(); offset++)
+        {
+            size_t line = 1 + std::count(content.begin(), content.begin() + offset, '\n');
+            size_t line_start = content.rfind('\n', offset == 0 ? 0 : offset - 1);
+            line_start = (line_start == std::string::npos || offset == 0) ? 0 : line_start + 1;
+
+            auto location = input.location(offset);
+            REQUIRE(location.line == line);
+            REQUIRE(location.column == offset - line_start + 1);
+        }
+    }
+
+    SECTION("trailing newline") {
+        arc::source_file trailing("a\nb\n", true);
+
+        REQUIRE(trailing.line_count() == 3);
+        REQUIRE(trailing.get_line(2) == "b");
+        REQUIRE(trailing.get_line(3) == "");
+        REQUIRE(trailing.location(4).line == 3);
+    }
+}
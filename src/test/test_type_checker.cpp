@@ -0,0 +1,241 @@
+#include "catch.hpp"
+
+#include "../lex/lexer.h"
+#include "../parse/parser.h"
+#include "../check/control_analyzer.h"
+#include "../check/type_checker.h"
+#include "../type/builtins.h"
+#include "../util/casting.h"
+#include "../util/thread_pool.h"
+#include "bench_corpus.h"
+
+namespace
+{
+    std::vector<arc::line_exception> check(const std::string& text)
+    {
+        arc::source_file input(text, true);
+        arc::arena arena;
+        auto tokens = arc::lexer(input).lex().tokens;
+        auto decls = arc::parser(tokens, input, arena).parse_module();
+        return arc::type_checker(decls, input).check();
+    }
+
+    // The checks the driver runs: type checking only happens once control
+    // analysis has passed.
+    std::vector<arc::line_exception> check_module(const std::string& text)
+    {
+        arc::source_file input(text, true);
+        arc::arena arena;
+        auto tokens = arc::lexer(input).lex().tokens;
+        auto decls = arc::parser(tokens, input, arena).parse_module();
+        auto errors = arc::control_analyzer(decls, input).analyze();
+        return errors.empty() ? arc::type_checker(decls, input).check() : errors;
+    }
+}
+
+TEST_CASE("lexical scopes resolve the innermost binding", "[lexical_scope]")
+{
+    auto a = arc::symbol::intern("scope_a");
+    auto b = arc::symbol::intern("scope_b");
+
+    arc::lexical_scope global;
+    global.add(a, arc::types::boolean());
+
+    arc::lexical_scope scope(&global);
+    REQUIRE(scope.get(a) == arc::types::boolean());
+    REQUIRE(scope.get(b) == nullptr);
+
+    scope.enter();
+    REQUIRE(scope.add(a, arc::types::u8()));
+    REQUIRE_FALSE(scope.add(a, arc::types::u16()));
+    REQUIRE(scope.get(a) == arc::types::u8());
+
+    scope.enter();
+    REQUIRE(scope.add(a, arc::types::u32()));
+    REQUIRE(scope.add(b, arc::types::u64()));
+    REQUIRE(scope.get(a) == arc::types::u32());
+    scope.leave();
+
+    REQUIRE(scope.get(a) == arc::types::u8());
+    REQUIRE(scope.get(b) == nullptr);
+    scope.leave();
+
+    REQUIRE(scope.get(a) == arc::types::boolean());
+}
+
+TEST_CASE("type checker scopes names by block", "[type_checker]")
+{
+    SECTION("nested blocks see outer names") {
+        REQUIRE(check(R"(
+            func f(a: u64) : u64 {
+                let b = a;
+                if true {
+                    let c = b;
+                    {
+                        return c + a;
+                    }
+                }
+                return b;
+            }
+        )").empty());
+    }
+
+    SECTION("names shadow outer blocks but not their own") {
+        REQUIRE(check("func f(a: u64) : none { { let a = true; } }").empty());
+        REQUIRE(check("func f(a: u64) : none { let a = true; }").size() == 1);
+        REQUIRE(check("func f() : none { let a = 1; let a = 2; }").size() == 1);
+    }
+
+    SECTION("names go out of scope with their block") {
+        REQUIRE(check("func f() : u64 { { let a = 1; } return a; }").size() == 2);
+    }
+}
+
+TEST_CASE("unsupported expressions are reported", "[type_checker]")
+{
+    auto errors = check("func f(a: u64) : none { let b = a as u8; let c = a[0]; }");
+    REQUIRE(errors.size() == 2);
+    REQUIRE(errors[0].error == "casts are not supported yet");
+    REQUIRE(errors[1].error == "indexing is not supported yet");
+
+    // Workers report them too instead of taking the process down.
+    std::string source;
+    for(size_t i = 0; i < 400; i++)
+    {
+        source += "func f_" + std::to_string(i) + "(a: u64) : none { let b = a as u8; }\n";
+    }
+    arc::source_file input(source, true);
+    arc::arena arena;
+    auto tokens = arc::lexer(input).lex().tokens;
+    auto decls = arc::parser(tokens, input, arena).parse_module();
+
+    arc::thread_pool pool(4);
+    REQUIRE(arc::type_checker(decls, input).check(pool).size() == 400);
+}
+
+TEST_CASE("parallel checking matches serial checking", "[type_checker]")
+{
+    // Every few functions has a mistake in it, so there are errors to merge.
+    auto source = generate_bench_module(300);
+    for(size_t i = 0; i < 300; i++)
+    {
+        auto n = std::to_string(i);
+        source += "func broken_" + n + "(a: u64) : bool {\n";
+        source += i % 3 == 0 ? "    let b: bool = a;\n" : "    let b = a;\n";
+        source += i % 5 == 0 ? "    return missing_" + n + ";\n" : "    return b == a;\n";
+        source += "}\n\n";
+    }
+
+    arc::source_file input(source, true);
+    arc::arena arena;
+    auto tokens = arc::lexer(input).lex().tokens;
+    auto decls = arc::parser(tokens, input, arena).parse_module();
+
+    auto serial = arc::type_checker(decls, input).check();
+    REQUIRE(serial.size() > 100);
+
+    for(size_t threads : { 1, 2, 4, 8 })
+    {
+        arc::thread_pool pool(threads);
+        auto parallel = arc::type_checker(decls, input).check(pool);
+
+        REQUIRE(serial.size() == parallel.size());
+        for(size_t i = 0; i < serial.size(); i++)
+        {
+            REQUIRE(serial[i].error == parallel[i].error);
+            REQUIRE(serial[i].position.offset == parallel[i].position.offset);
+        }
+    }
+}
+
+TEST_CASE("declarations are collected before bodies are checked", "[type_checker]")
+{
+    SECTION("functions can be called before they're declared") {
+        REQUIRE(check("func f() : u64 { return g(1); } func g(a: u64) : u64 { return a; }").empty());
+        REQUIRE(check("func f() : u64 { return g(true); } func g(a: u64) : u64 { return a; }").size() == 1);
+    }
+
+    SECTION("struct fields and methods") {
+        REQUIRE(check(R"(
+            func f(d: data) : u64 {
+                return d.value + d.get();
+            }
+            struct data {
+                value: u64;
+                func get() : u64 { return 1; }
+            }
+        )").empty());
+        REQUIRE(check("struct data { value: u64; } func f(d: data) : u64 { return d.other; }").size() == 2);
+    }
+
+    SECTION("member function bodies see the struct's members") {
+        REQUIRE(check(R"(
+            struct data {
+                value: u64;
+                func twice() : u64 { return value + get(); }
+                func get() : u64 { return value; }
+            }
+        )").empty());
+        REQUIRE(check("struct data { value: u64; func get() : bool { return value; } }").size() == 1);
+        REQUIRE(check("struct data { func get() : u64 { return missing; } }").size() == 2);
+        REQUIRE(check("struct data { value: u64; func f(value: bool) : bool { return value; } }").empty());
+        REQUIRE(check("struct data { value: u64; value: bool; }").size() == 1);
+    }
+
+    SECTION("struct types keep their members while the interner lives") {
+        arc::type_interner types;
+        arc::source_file input("struct data { value: u64; } func f(d: data) : none {}", true);
+        arc::arena arena;
+        auto tokens = arc::lexer(input).lex().tokens;
+        auto decls = arc::parser(tokens, input, arena).parse_module();
+        REQUIRE(arc::type_checker(decls, input, types).check().empty());
+
+        auto f = arc::cast<arc::decl_func>(decls[1]);
+        auto data = arc::dyn_cast<arc::type_struct>(f->arguments[0].types.type);
+        REQUIRE(data != nullptr);
+        REQUIRE(data->find_member("value") == arc::types::u64());
+    }
+
+    SECTION("aliases can refer to later declarations") {
+        REQUIRE(check("alias a = *b; alias b = data; struct data { value: u64; } func f(p: a) : none {}").empty());
+        auto errors = check("alias a = *nothing; func f(p: a) : none {}");
+        REQUIRE(errors.size() == 1);
+        REQUIRE(errors[0].error == "unknown type 'nothing'");
+    }
+
+    SECTION("alias cycles are reported once") {
+        auto errors = check("alias a = *b; alias b = a; alias c = a; func f(p: c) : none {}");
+        REQUIRE(errors.size() == 1);
+        REQUIRE(errors[0].error == "alias 'a' refers to itself");
+    }
+
+    SECTION("names are only declared once") {
+        REQUIRE(check("struct data { } struct data { }").size() == 1);
+        REQUIRE(check("alias u64 = bool;").size() == 1);
+        REQUIRE(check("func f() : none {} func f() : none {}").size() == 1);
+        // The second f is only reported, its body isn't checked.
+        REQUIRE(check("func f() : u64 { return 1; } func f() : bool { return 1; }").size() == 1);
+        REQUIRE(check("alias data = u64; struct data { }").size() == 1);
+        REQUIRE(check("struct data { } alias data = u64;").size() == 1);
+        REQUIRE(check("func f(a: u64, a: u64) : u64 { return a; }").size() == 1);
+    }
+}
+
+TEST_CASE("the driver accepts what it always has", "[type_checker][control_analyzer]")
+{
+    SECTION("member functions that return nothing") {
+        REQUIRE(check_module("struct s { func f() : none { } }").empty());
+    }
+
+    SECTION("functions must still return") {
+        auto errors = check_module("func f(a: bool) : u64 { if a { return 1; } }");
+        REQUIRE(errors.size() == 1);
+        REQUIRE(errors[0].error == "not all control paths return a value");
+    }
+
+    SECTION("unreachable code is reported once per function") {
+        auto errors = check_module("func f() : u64 { return 1; return 2; { return 3; return 4; } }");
+        REQUIRE(errors.size() == 1);
+        REQUIRE(errors[0].error == "unreachable code");
+    }
+}
@@ -0,0 +1,129 @@
+#include "catch.hpp"
+
+#include "../type/builtins.h"
+#include "../type/type_interner.h"
+#include "../type/type_map.h"
+#include "../util/arena.h"
+#include "../util/casting.h"
+
+#include <vector>
+
+TEST_CASE("types are interned by structure", "[type_interner]")
+{
+    SECTION("scalars") {
+        arc::type_interner types;
+        REQUIRE(types.integer(false, 64) == types.integer(false, 64));
+        REQUIRE(types.integer(false, 64) != types.integer(true, 64));
+        REQUIRE(types.integer(false, 32) != types.integer(false, 64));
+        REQUIRE(types.floating(32) == types.floating(32));
+        REQUIRE(types.floating(32) != types.floating(64));
+        REQUIRE(types.none() != types.boolean());
+    }
+
+    SECTION("builtins are shared by every interner") {
+        arc::type_interner a;
+        arc::type_interner b;
+        REQUIRE(a.integer(false, 64) == arc::types::u64());
+        REQUIRE(b.integer(false, 64) == arc::types::u64());
+        REQUIRE(a.floating(32) == arc::types::f32());
+        REQUIRE(a.boolean() == arc::types::boolean());
+        REQUIRE(a.integer(true, 128) != b.integer(true, 128));
+        REQUIRE(a.size() == 1);
+    }
+
+    SECTION("compound types") {
+        arc::type_interner types;
+        auto u8 = types.integer(false, 8);
+        auto u16 = types.integer(false, 16);
+
+        REQUIRE(types.pointer(u8) == types.pointer(u8));
+        REQUIRE(types.pointer(types.pointer(u8)) != types.pointer(u8));
+        REQUIRE(arc::cast<arc::type_pointer>(types.pointer(u8))->base == u8);
+
+        std::vector<std::shared_ptr<arc::type>> a = { u8 };
+        std::vector<std::shared_ptr<arc::type>> b = { u16 };
+        std::vector<std::shared_ptr<arc::type>> ab = { u8, u16 };
+        REQUIRE(types.func(u16, a) == types.func(u16, a));
+        REQUIRE(types.func(u16, a) != types.func(u8, b));
+        REQUIRE(types.func(u16, a) != types.func(u16, ab));
+        REQUIRE(types.func(u16, {}) != types.func(u16, a));
+    }
+
+    SECTION("millions of generated types") {
+        arc::type_interner types;
+        std::vector<std::shared_ptr<arc::type>> scalars;
+        for(size_t size : { 8, 16, 32, 64 })
+        {
+            scalars.push_back(types.integer(false, size));
+            scalars.push_back(types.integer(true, size));
+        }
+        scalars.push_back(types.floating(32));
+        scalars.push_back(types.floating(64));
+        scalars.push_back(types.none());
+        scalars.push_back(types.boolean());
+
+        // Function i returns scalar i % n and takes the base n digits of i / n,
+        // so every i gives a different function.
+        const size_t count = 1 << 19;
+        const size_t n = scalars.size();
+        auto make = [&](size_t i) {
+            std::vector<std::shared_ptr<arc::type>> args;
+            for(size_t rest = i / n; rest != 0; rest /= n)
+            {
+                args.push_back(scalars[rest % n]);
+            }
+            auto func = types.func(scalars[i % n], args);
+            return std::vector<std::shared_ptr<arc::type>>{ func, types.pointer(func), types.pointer(types.pointer(func)) };
+        };
+
+        std::vector<std::vector<std::shared_ptr<arc::type>>> made;
+        made.reserve(count);
+        for(size_t i = 0; i < count; i++)
+        {
+            made.push_back(make(i));
+        }
+        REQUIRE(types.size() == 3 * count);
+
+        for(size_t i = 0; i < count; i++)
+        {
+            if(make(i) != made[i]) { FAIL("type " << i << " was not interned"); }
+        }
+        REQUIRE(types.size() == 3 * count);
+    }
+}
+
+TEST_CASE("type maps resolve typespecs to canonical types", "[type_map]")
+{
+    arc::arena arena;
+    arc::type_map map;
+
+    auto name = [&](std::string_view name) { return arc::make_name_typespec(arena, name); };
+    auto pointer = [&](arc::typespec* base) { return arc::make_pointer_typespec(arena, base); };
+    auto func = [&](const std::vector<arc::typespec*>& args, arc::typespec* ret) { return arc::make_func_typespec(arena, args, ret); };
+
+    SECTION("names") {
+        REQUIRE(map.get(name("u8")) == map.types().integer(false, 8));
+        REQUIRE(map.get(name("i32")) == arc::types::i32());
+        REQUIRE(map.get(name("u128")) == nullptr);
+        REQUIRE_FALSE(map.add("u8", map.types().boolean()));
+        REQUIRE(map.add("byte", arc::types::u8()));
+        REQUIRE(map.get(name("byte")) == map.get(name("u8")));
+    }
+
+    SECTION("separately parsed typespecs share a type") {
+        REQUIRE(map.get(pointer(pointer(name("u8")))) == map.get(pointer(pointer(name("u8")))));
+        REQUIRE(map.get(func({ name("u8") }, name("u16"))) == map.get(func({ name("u8") }, name("u16"))));
+    }
+
+    SECTION("different typespecs never share a type") {
+        REQUIRE(map.get(pointer(name("u8"))) != map.get(pointer(pointer(name("u8")))));
+        REQUIRE(map.get(pointer(name("u8"))) != map.get(pointer(name("u16"))));
+        REQUIRE(map.get(func({ name("u8") }, name("u16"))) != map.get(func({ name("u16") }, name("u8"))));
+        REQUIRE(map.get(func({ name("u8"), name("u8") }, name("u8"))) != map.get(func({ name("u8") }, name("u8"))));
+    }
+
+    SECTION("unknown parts") {
+        REQUIRE(map.get(pointer(name("nothing"))) == nullptr);
+        REQUIRE(map.get(func({ name("nothing") }, name("u8"))) == nullptr);
+    }
+}
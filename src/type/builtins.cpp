@@ -0,0 +1,53 @@
+#include "builtins.h"
+
+namespace
+{
+	struct builtin_table
+	{
+		const arc::types::builtin none    = { "none", std::make_shared<arc::type_none>() };
+		const arc::types::builtin boolean = { "bool", std::make_shared<arc::type_bool>() };
+		const arc::types::builtin f32     = { "f32",  std::make_shared<arc::type_float>(32) };
+		const arc::types::builtin f64     = { "f64",  std::make_shared<arc::type_float>(64) };
+		const arc::types::builtin u8      = { "u8",   std::make_shared<arc::type_integer>(false, 8) };
+		const arc::types::builtin u16     = { "u16",  std::make_shared<arc::type_integer>(false, 16) };
+		const arc::types::builtin u32     = { "u32",  std::make_shared<arc::type_integer>(false, 32) };
+		const arc::types::builtin u64     = { "u64",  std::make_shared<arc::type_integer>(false, 64) };
+		const arc::types::builtin i8      = { "i8",   std::make_shared<arc::type_integer>(true, 8) };
+		const arc::types::builtin i16     = { "i16",  std::make_shared<arc::type_integer>(true, 16) };
+		const arc::types::builtin i32     = { "i32",  std::make_shared<arc::type_integer>(true, 32) };
+		const arc::types::builtin i64     = { "i64",  std::make_shared<arc::type_integer>(true, 64) };
+
+		const arc::types::builtin all[12] = { none, boolean, f32, f64, u8, u16, u32, u64, i8, i16, i32, i64 };
+	};
+
+	// Built on first use, which C++ makes thread safe.
+	const builtin_table& table()
+	{
+		static const builtin_table table;
+		return table;
+	}
+}
+
+namespace arc
+{
+	namespace types
+	{
+		const std::shared_ptr<type>& none()    { return table().none.type; }
+		const std::shared_ptr<type>& boolean() { return table().boolean.type; }
+		const std::shared_ptr<type>& f32()     { return table().f32.type; }
+		const std::shared_ptr<type>& f64()     { return table().f64.type; }
+		const std::shared_ptr<type>& u8()      { return table().u8.type; }
+		const std::shared_ptr<type>& u16()     { return table().u16.type; }
+		const std::shared_ptr<type>& u32()     { return table().u32.type; }
+		const std::shared_ptr<type>& u64()     { return table().u64.type; }
+		const std::shared_ptr<type>& i8()      { return table().i8.type; }
+		const std::shared_ptr<type>& i16()     { return table().i16.type; }
+		const std::shared_ptr<type>& i32()     { return table().i32.type; }
+		const std::shared_ptr<type>& i64()     { return table().i64.type; }
+
+		std::span<const builtin> all()
+		{
+			return table().all;
+		}
+	}
+}
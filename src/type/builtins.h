@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <string_view>
+
+#include "types.h"
+
+namespace arc
+{
+	// The builtin types, made once for the whole process and never changed, so
+	// every type_map and type_checker hands out the very same objects for them.
+	namespace types
+	{
+		struct builtin
+		{
+			std::string_view name;
+			std::shared_ptr<arc::type> type;
+		};
+
+		const std::shared_ptr<type>& none();
+		const std::shared_ptr<type>& boolean();
+		const std::shared_ptr<type>& f32();
+		const std::shared_ptr<type>& f64();
+		const std::shared_ptr<type>& u8();
+		const std::shared_ptr<type>& u16();
+		const std::shared_ptr<type>& u32();
+		const std::shared_ptr<type>& u64();
+		const std::shared_ptr<type>& i8();
+		const std::shared_ptr<type>& i16();
+		const std::shared_ptr<type>& i32();
+		const std::shared_ptr<type>& i64();
+
+		// Every builtin along with the name it's written as.
+		std::span<const builtin> all();
+	}
+}
@@ -0,0 +1,171 @@
+#include "type_interner.h"
+
+#include "builtins.h"
+#include "../util/casting.h"
+
+namespace
+{
+	size_t hash_combine(size_t seed, size_t value)
+	{
+		return seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+	}
+
+	size_t hash_func(const arc::type* return_type, std::span<const std::shared_ptr<arc::type>> argument_types)
+	{
+		size_t h = hash_combine(argument_types.size(), std::hash<const arc::type*>()(return_type));
+		for(const auto& a : argument_types)
+		{
+			h = hash_combine(h, std::hash<const arc::type*>()(a.get()));
+		}
+		return h;
+	}
+
+	bool same_func(const arc::type* return_type, std::span<const std::shared_ptr<arc::type>> argument_types, const arc::type_func& func)
+	{
+		if(return_type != func.return_type.get()) { return false; }
+		if(argument_types.size() != func.argument_types.size()) { return false; }
+
+		for(size_t i = 0; i < argument_types.size(); i++)
+		{
+			if(argument_types[i] != func.argument_types[i]) { return false; }
+		}
+
+		return true;
+	}
+}
+
+namespace arc
+{
+	size_t type_interner::func_hash::operator()(const func_key& key) const
+	{
+		return hash_func(key.return_type, key.argument_types);
+	}
+
+	size_t type_interner::func_hash::operator()(const std::shared_ptr<type_func>& func) const
+	{
+		return hash_func(func->return_type.get(), func->argument_types);
+	}
+
+	bool type_interner::func_equal::operator()(const func_key& lhs, const std::shared_ptr<type_func>& rhs) const
+	{
+		return same_func(lhs.return_type, lhs.argument_types, *rhs);
+	}
+
+	bool type_interner::func_equal::operator()(const std::shared_ptr<type_func>& lhs, const func_key& rhs) const
+	{
+		return same_func(rhs.return_type, rhs.argument_types, *lhs);
+	}
+
+	bool type_interner::func_equal::operator()(const std::shared_ptr<type_func>& lhs, const std::shared_ptr<type_func>& rhs) const
+	{
+		return lhs == rhs;
+	}
+
+	template<typename T>
+	std::shared_ptr<T> type_interner::make(std::shared_ptr<T> type)
+	{
+		_types.push_back(type);
+		return type;
+	}
+
+	type_interner::type_interner()
+	{
+		for(const auto& builtin : types::all())
+		{
+			if(auto integer = dyn_cast<type_integer>(builtin.type))
+			{
+				_integers[integer->size * 2 + integer->is_signed] = builtin.type;
+			}
+			if(auto floating = dyn_cast<type_float>(builtin.type))
+			{
+				_floats[floating->size] = builtin.type;
+			}
+		}
+	}
+
+	type_interner::~type_interner()
+	{
+		for(const auto& s : _structs)
+		{
+			s->fields.clear();
+			s->functions.clear();
+		}
+		_structs.clear();
+		_funcs.clear();
+		_pointers.clear();
+		while(!_types.empty())
+		{
+			_types.pop_back();
+		}
+	}
+
+	std::shared_ptr<type> type_interner::none() const
+	{
+		return types::none();
+	}
+
+	std::shared_ptr<type> type_interner::boolean() const
+	{
+		return types::boolean();
+	}
+
+	std::shared_ptr<type> type_interner::integer(bool is_signed, size_t size)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto& slot = _integers[size * 2 + is_signed];
+		if(slot == nullptr)
+		{
+			slot = make(std::make_shared<type_integer>(is_signed, size));
+		}
+		return slot;
+	}
+
+	std::shared_ptr<type> type_interner::floating(size_t size)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto& slot = _floats[size];
+		if(slot == nullptr)
+		{
+			slot = make(std::make_shared<type_float>(size));
+		}
+		return slot;
+	}
+
+	std::shared_ptr<type> type_interner::pointer(const std::shared_ptr<type>& base)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto& slot = _pointers[base.get()];
+		if(slot == nullptr)
+		{
+			slot = make(std::make_shared<type_pointer>(base));
+		}
+		return slot;
+	}
+
+	std::shared_ptr<type> type_interner::func(const std::shared_ptr<type>& return_type, std::span<const std::shared_ptr<type>> argument_types)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto f = _funcs.find(func_key{ return_type.get(), argument_types });
+		if(f != _funcs.end())
+		{
+			return *f;
+		}
+
+		std::vector<std::shared_ptr<type>> arguments(argument_types.begin(), argument_types.end());
+		return *_funcs.insert(make(std::make_shared<type_func>(return_type, arguments))).first;
+	}
+
+	std::shared_ptr<type_struct> type_interner::structure(std::string_view name)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto type = make(std::make_shared<type_struct>(name));
+		_structs.push_back(type);
+		return type;
+	}
+
+	size_t type_interner::size() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _types.size();
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "types.h"
+
+namespace arc
+{
+	// Hands out one canonical object per structurally distinct type, so two
+	// types are equal exactly when they are the same pointer. Compound types
+	// are keyed on their already interned parts, which makes hashing and
+	// comparing a key cost the same however deeply the type is nested. Safe to
+	// use from several threads at once.
+	//
+	// Struct members can refer back to the struct, so the interner breaks
+	// those cycles when it is destroyed. Struct types it made keep their
+	// members for as long as the interner is alive.
+	class type_interner
+	{
+	private:
+		struct func_key
+		{
+			const type* return_type;
+			std::span<const std::shared_ptr<type>> argument_types;
+		};
+
+		struct func_hash
+		{
+			using is_transparent = void;
+
+			size_t operator()(const func_key& key) const;
+			size_t operator()(const std::shared_ptr<type_func>& func) const;
+		};
+
+		struct func_equal
+		{
+			using is_transparent = void;
+
+			bool operator()(const func_key& lhs, const std::shared_ptr<type_func>& rhs) const;
+			bool operator()(const std::shared_ptr<type_func>& lhs, const func_key& rhs) const;
+			bool operator()(const std::shared_ptr<type_func>& lhs, const std::shared_ptr<type_func>& rhs) const;
+		};
+
+		// Every type in the order it was made. Parts are always made before the
+		// types built from them, so dropping these back to front never has to
+		// recurse down a long chain of pointers.
+		std::vector<std::shared_ptr<type>> _types;
+		mutable std::mutex _mutex;
+
+		std::unordered_map<size_t, std::shared_ptr<type>> _integers;
+		std::unordered_map<size_t, std::shared_ptr<type>> _floats;
+		std::unordered_map<const type*, std::shared_ptr<type>> _pointers;
+		std::unordered_set<std::shared_ptr<type_func>, func_hash, func_equal> _funcs;
+		std::vector<std::shared_ptr<type_struct>> _structs;
+	public:
+		type_interner();
+		~type_interner();
+
+		type_interner(const type_interner&) = delete;
+		type_interner& operator=(const type_interner&) = delete;
+
+		// Scalars of a builtin size are the process wide objects in builtins.h.
+		std::shared_ptr<type> none() const;
+		std::shared_ptr<type> boolean() const;
+		std::shared_ptr<type> integer(bool is_signed, size_t size);
+		std::shared_ptr<type> floating(size_t size);
+
+		// The parts passed in must have come from this interner.
+		std::shared_ptr<type> pointer(const std::shared_ptr<type>& base);
+		std::shared_ptr<type> func(const std::shared_ptr<type>& return_type, std::span<const std::shared_ptr<type>> argument_types);
+
+		// A new struct with no members yet. Every call makes a distinct type.
+		std::shared_ptr<type_struct> structure(std::string_view name);
+
+		// How many distinct types have been made, not counting the builtins.
+		size_t size() const;
+	private:
+		template<typename T>
+		std::shared_ptr<T> make(std::shared_ptr<T> type);
+	};
+}
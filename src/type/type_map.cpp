@@ -1,39 +1,72 @@
 #include "type_map.h"
 
+#include "builtins.h"
 #include "../util/casting.h"
 
 namespace arc
 {
-    std::shared_ptr<type> type_map::get(const std::shared_ptr<typespec>& key)
+	type_map::type_map()
+		: _own_types(std::make_unique<type_interner>()), _types(*_own_types)
 	{
-		auto f = _map.find(key->hash());
-		if(f != _map.end())
+		for(const auto& builtin : types::all())
 		{
-			return f->second;
+			_names.emplace(builtin.name, builtin.type);
 		}
+	}
 
-		if(auto spec = arc::is<typespec_name>(key))
+	type_map::type_map(type_interner& types)
+		: _types(types)
+	{
+		for(const auto& builtin : types::all())
 		{
-            return nullptr;
+			_names.emplace(builtin.name, builtin.type);
 		}
+	}
 
-		if(auto spec = arc::is<typespec_pointer>(key))
+	std::shared_ptr<type_struct> type_map::add_struct(std::string_view name)
+	{
+		if(_names.contains(name))
 		{
-			auto base = get(spec->base);
-			return add(key, new type_pointer(base));
+			return nullptr;
 		}
 
-		if(auto spec = arc::is<typespec_func>(key))
+		auto type = _types.structure(name);
+		add(name, type);
+		return type;
+	}
+
+    std::shared_ptr<type> type_map::get(typespec* key)
+	{
+		switch(key->kind)
 		{
+		case ast_kind::typespec_name: {
+			return get(cast<typespec_name>(key)->name);
+		}
+		case ast_kind::typespec_pointer: {
+			auto base = get(cast<typespec_pointer>(key)->base);
+			return base != nullptr ? _types.pointer(base) : nullptr;
+		}
+		case ast_kind::typespec_func: {
+			auto spec = cast<typespec_func>(key);
 			auto return_type = get(spec->return_type);
+			if(return_type == nullptr) { return nullptr; }
+
 			std::vector<std::shared_ptr<type>> argument_types;
 			for(const auto& a : spec->argument_types)
 			{
 				argument_types.push_back(get(a));
+				if(argument_types.back() == nullptr) { return nullptr; }
 			}
-			return add(key, new type_func(return_type, argument_types));
+			return _types.func(return_type, argument_types);
+		}
 		}
 
         return nullptr;
 	}
+
+	std::shared_ptr<type> type_map::get(std::string_view name)
+	{
+		auto f = _names.find(name);
+		return f != _names.end() ? f->second : nullptr;
+	}
 }
@@ -2,23 +2,64 @@
 
 #include <unordered_map>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "types.h"
+#include "type_interner.h"
 #include "../parse/ast.h"
 
 namespace arc
 {
+    // Resolves typespecs to their canonical types. Names are looked up in a
+    // table of declared types, everything else is built through the interner,
+    // so equal typespecs always give back the same type object. get can be
+    // called from several threads at once, as long as nothing is being added.
+    // The interner can be shared with whatever else builds types for the
+    // same module, such as the ast cache reader.
     class type_map
 	{
 	private:
-		std::unordered_map<size_t, std::shared_ptr<type>> _map;
+		struct name_hash
+		{
+			using is_transparent = void;
+
+			size_t operator()(std::string_view name) const
+			{
+				return std::hash<std::string_view>()(name);
+			}
+		};
+
+		// Only set when the map made its own interner.
+		std::unique_ptr<type_interner> _own_types;
+		type_interner& _types;
+		std::unordered_map<std::string, std::shared_ptr<type>, name_hash, std::equal_to<>> _names;
 	public:
-		template<typename T>
-		std::shared_ptr<type> add(const std::shared_ptr<typespec>& key, T* value)
+		// Starts out knowing the names of the builtin types.
+		type_map();
+		explicit type_map(type_interner& types);
+
+		type_map(const type_map&) = delete;
+		type_map& operator=(const type_map&) = delete;
+
+		// Returns false if the name is already taken.
+		bool add(std::string_view name, const std::shared_ptr<type>& type)
 		{
-			return _map[key->hash()] = std::shared_ptr<T>(value);
+			return _names.emplace(name, type).second;
 		}
 
-		std::shared_ptr<type> get(const std::shared_ptr<typespec>& key);
+		// Makes a struct type with no members yet and adds it under its name.
+		// Null if the name is already taken. The struct belongs to the
+		// interner, see type_interner for how long its members last.
+		std::shared_ptr<type_struct> add_struct(std::string_view name);
+
+		// Null if the typespec names a type that doesn't exist.
+		std::shared_ptr<type> get(typespec* key);
+
+		// Looks up a named type without having to build a typespec for it.
+		std::shared_ptr<type> get(std::string_view name);
+
+		type_interner& types() { return _types; }
 	};
 }
@@ -1,21 +1,61 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace arc
 {
+	enum class type_kind : uint8_t
+	{
+		none,
+		boolean,
+		integer,
+		floating,
+		pointer,
+		func,
+		structure
+	};
+
 	struct type
 	{
+		// Which type this is, see casting.h for isa, cast and dyn_cast.
+		const type_kind kind;
+
+		type(type_kind kind)
+			: kind(kind)
+		{
+		}
+
 		virtual ~type() = default;
 	};
 
 	struct type_none : public type
 	{
+		type_none()
+			: type(type_kind::none)
+		{
+		}
+
+		static bool classof(const type* t)
+		{
+			return t->kind == type_kind::none;
+		}
 	};
 
 	struct type_bool : public type
 	{
+		type_bool()
+			: type(type_kind::boolean)
+		{
+		}
+
+		static bool classof(const type* t)
+		{
+			return t->kind == type_kind::boolean;
+		}
 	};
 
 	struct type_integer : public type
@@ -24,9 +64,14 @@ namespace arc
 		const size_t size;
 
 		type_integer(bool is_signed, size_t size)
-			: is_signed(is_signed), size(size)
+			: type(type_kind::integer), is_signed(is_signed), size(size)
 		{
 		}
+
+		static bool classof(const type* t)
+		{
+			return t->kind == type_kind::integer;
+		}
 	};
 
 	struct type_float : public type
@@ -34,8 +79,13 @@ namespace arc
 		const size_t size;
 
 		type_float(size_t size)
-			: size(size)
+			: type(type_kind::floating), size(size)
+		{
+		}
+
+		static bool classof(const type* t)
 		{
+			return t->kind == type_kind::floating;
 		}
 	};
 
@@ -44,9 +94,14 @@ namespace arc
 		const std::shared_ptr<type> base;
 
 		type_pointer(const std::shared_ptr<type>& base)
-			: base(base)
+			: type(type_kind::pointer), base(base)
+		{
+		}
+
+		static bool classof(const type* t)
 		{
-		}	
+			return t->kind == type_kind::pointer;
+		}
 	};
 
 	struct type_func : public type
@@ -57,8 +112,53 @@ namespace arc
 		type_func(
 			const std::shared_ptr<type>& return_type,
 			const std::vector<std::shared_ptr<type>>& argument_types
-		) : return_type(return_type), argument_types(argument_types)
+		) : type(type_kind::func), return_type(return_type), argument_types(argument_types)
+		{
+		}
+
+		static bool classof(const type* t)
+		{
+			return t->kind == type_kind::func;
+		}
+	};
+
+	// Structs are told apart by declaration rather than by structure, so every
+	// decl_struct gets its own type_struct.
+	struct type_struct : public type
+	{
+		struct member
+		{
+			std::string name;
+			std::shared_ptr<arc::type> type;
+		};
+
+		const std::string name;
+		// Filled in after the type is made, since members can refer back to the
+		// struct itself. Nothing changes once bodies start being checked.
+		std::vector<member> fields;
+		std::vector<member> functions;
+
+		type_struct(std::string_view name)
+			: type(type_kind::structure), name(name)
+		{
+		}
+
+		// The type of the field or function called name, null if there isn't one.
+		std::shared_ptr<arc::type> find_member(std::string_view name) const
+		{
+			for(const auto& members : { &fields, &functions })
+			{
+				for(const auto& m : *members)
+				{
+					if(m.name == name) { return m.type; }
+				}
+			}
+			return nullptr;
+		}
+
+		static bool classof(const type* t)
 		{
+			return t->kind == type_kind::structure;
 		}
 	};
 }
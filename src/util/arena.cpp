@@ -0,0 +1,111 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace arc
+{
+    arena::arena()
+        : _ptr(nullptr), _end(nullptr), _blocks(nullptr), _reserved(0)
+    {
+    }
+
+    arena::~arena()
+    {
+        release();
+    }
+
+    arena::arena(arena&& other) noexcept
+        : _ptr(std::exchange(other._ptr, nullptr)),
+          _end(std::exchange(other._end, nullptr)),
+          _blocks(std::exchange(other._blocks, nullptr)),
+          _reserved(std::exchange(other._reserved, 0)),
+          _destructors(std::move(other._destructors))
+    {
+        other._destructors.clear();
+    }
+
+    arena& arena::operator=(arena&& other) noexcept
+    {
+        if(this != &other)
+        {
+            release();
+            _ptr = std::exchange(other._ptr, nullptr);
+            _end = std::exchange(other._end, nullptr);
+            _blocks = std::exchange(other._blocks, nullptr);
+            _reserved = std::exchange(other._reserved, 0);
+            _destructors = std::move(other._destructors);
+            other._destructors.clear();
+        }
+        return *this;
+    }
+
+    void arena::absorb(arena&& other)
+    {
+        if(this == &other || other._blocks == nullptr)
+        {
+            return;
+        }
+
+        auto last = other._blocks;
+        while(last->next != nullptr)
+        {
+            last = last->next;
+        }
+        last->next = _blocks;
+        _blocks = std::exchange(other._blocks, nullptr);
+        _reserved += std::exchange(other._reserved, 0);
+
+        _destructors.insert(_destructors.end(), other._destructors.begin(), other._destructors.end());
+        other._destructors.clear();
+        other._ptr = nullptr;
+        other._end = nullptr;
+    }
+
+    void* arena::allocate_slow(size_t size, size_t align)
+    {
+        // Large allocations get a block of their own, so that the rest of the
+        // current block isn't wasted.
+        auto header = (sizeof(block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+        auto capacity = std::max(block_size, header + size + align);
+
+        auto memory = static_cast<block*>(std::malloc(capacity));
+        if(memory == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        memory->next = _blocks;
+        memory->size = capacity;
+        _blocks = memory;
+        _reserved += capacity;
+
+        auto ptr = reinterpret_cast<char*>(memory) + header;
+        auto end = reinterpret_cast<char*>(memory) + capacity;
+        if(capacity > block_size)
+        {
+            auto address = (reinterpret_cast<uintptr_t>(ptr) + align - 1) & ~uintptr_t(align - 1);
+            return reinterpret_cast<void*>(address);
+        }
+
+        _ptr = ptr;
+        _end = end;
+        return allocate(size, align);
+    }
+
+    void arena::release()
+    {
+        for(auto it = _destructors.rbegin(); it != _destructors.rend(); it++)
+        {
+            it->destroy(it->objects, it->count);
+        }
+        _destructors.clear();
+
+        while(_blocks != nullptr)
+        {
+            std::free(std::exchange(_blocks, _blocks->next));
+        }
+        _ptr = nullptr;
+        _end = nullptr;
+        _reserved = 0;
+    }
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace arc
+{
+    // Bump allocator that owns everything allocated from it and frees it all at
+    // once when destroyed. Objects that are not trivially destructible have their
+    // destructors run (in reverse order of creation) at that point.
+    class arena
+    {
+    private:
+        struct block
+        {
+            block* next;
+            size_t size;
+        };
+
+        struct destructor
+        {
+            void(*destroy)(void*, size_t);
+            void* objects;
+            size_t count;
+        };
+
+        static constexpr size_t block_size = 64 * 1024;
+
+        char* _ptr;
+        char* _end;
+        block* _blocks;
+        size_t _reserved;
+
+        std::vector<destructor> _destructors;
+    public:
+        arena();
+        ~arena();
+
+        arena(const arena&) = delete;
+        arena& operator=(const arena&) = delete;
+
+        arena(arena&& other) noexcept;
+        arena& operator=(arena&& other) noexcept;
+
+        void* allocate(size_t size, size_t align)
+        {
+            auto address = (reinterpret_cast<uintptr_t>(_ptr) + align - 1) & ~uintptr_t(align - 1);
+            if(address + size > reinterpret_cast<uintptr_t>(_end))
+            {
+                return allocate_slow(size, align);
+            }
+            _ptr = reinterpret_cast<char*>(address + size);
+            return reinterpret_cast<void*>(address);
+        }
+
+        template<typename T, typename... Args>
+        T* make(Args&&... args)
+        {
+            auto object = new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            if constexpr(!std::is_trivially_destructible_v<T>)
+            {
+                _destructors.push_back({ &destroy<T>, object, 1 });
+            }
+            return object;
+        }
+
+        template<typename T>
+        std::span<const T> copy(std::span<const T> items)
+        {
+            if(items.empty())
+            {
+                return {};
+            }
+
+            auto objects = static_cast<T*>(allocate(sizeof(T) * items.size(), alignof(T)));
+            std::uninitialized_copy(items.begin(), items.end(), objects);
+            if constexpr(!std::is_trivially_destructible_v<T>)
+            {
+                _destructors.push_back({ &destroy<T>, objects, items.size() });
+            }
+            return { objects, items.size() };
+        }
+
+        template<typename T>
+        std::span<const T> copy(const std::vector<T>& items)
+        {
+            return copy(std::span<const T>(items));
+        }
+
+        std::string_view copy(std::string_view text)
+        {
+            if(text.empty())
+            {
+                return {};
+            }
+
+            auto data = static_cast<char*>(allocate(text.size(), 1));
+            std::memcpy(data, text.data(), text.size());
+            return { data, text.size() };
+        }
+
+        // Takes over everything allocated from other, which is left empty. Lets
+        // threads allocate from arenas of their own and hand the results to one
+        // owner at the end.
+        void absorb(arena&& other);
+
+        // Total size of the blocks requested from the system so far.
+        size_t bytes_reserved() const
+        {
+            return _reserved;
+        }
+    private:
+        void* allocate_slow(size_t size, size_t align);
+        void release();
+
+        template<typename T>
+        static void destroy(void* objects, size_t count)
+        {
+            std::destroy_n(static_cast<T*>(objects), count);
+        }
+    };
+}
@@ -1,12 +1,63 @@
 #pragma once
 
+#include <cassert>
 #include <memory>
 
 namespace arc
 {
+    // Checked casts between ast nodes or between types, going by the kind tag
+    // instead of RTTI. T::classof says which kinds a T can be, and the results
+    // are raw pointers so that nothing touches a reference count.
+
+    template<typename T, typename B>
+    bool isa(const B* b)
+    {
+        return T::classof(b);
+    }
+
+    template<typename T, typename B>
+    bool isa(const std::shared_ptr<B>& b)
+    {
+        return T::classof(b.get());
+    }
+
+    // b must be a T.
+    template<typename T, typename B>
+    T* cast(B* b)
+    {
+        assert(isa<T>(b));
+        return static_cast<T*>(b);
+    }
+
+    template<typename T, typename B>
+    const T* cast(const B* b)
+    {
+        assert(isa<T>(b));
+        return static_cast<const T*>(b);
+    }
+
+    template<typename T, typename B>
+    T* cast(const std::shared_ptr<B>& b)
+    {
+        return cast<T>(b.get());
+    }
+
+    // Null if b is null or not a T.
+    template<typename T, typename B>
+    T* dyn_cast(B* b)
+    {
+        return b != nullptr && isa<T>(b) ? static_cast<T*>(b) : nullptr;
+    }
+
+    template<typename T, typename B>
+    const T* dyn_cast(const B* b)
+    {
+        return b != nullptr && isa<T>(b) ? static_cast<const T*>(b) : nullptr;
+    }
+
     template<typename T, typename B>
-    std::shared_ptr<T> is(const std::shared_ptr<B>& b)
+    T* dyn_cast(const std::shared_ptr<B>& b)
     {
-        return std::dynamic_pointer_cast<T>(b);
+        return dyn_cast<T>(b.get());
     }
 }
@@ -0,0 +1,101 @@
+#include "mapped_file.h"
+
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/mman.h>
+    #include <unistd.h>
+    #define ARC_HAS_MMAP
+#endif
+
+namespace arc
+{
+    mapped_file::mapped_file()
+        : _data(nullptr), _size(0)
+    {
+    }
+
+    mapped_file::~mapped_file()
+    {
+        unmap();
+    }
+
+    mapped_file::mapped_file(mapped_file&& other) noexcept
+        : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0))
+    {
+    }
+
+    mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+    {
+        if(this != &other)
+        {
+            unmap();
+            _data = std::exchange(other._data, nullptr);
+            _size = std::exchange(other._size, 0);
+        }
+        return *this;
+    }
+
+    bool mapped_file::map(int fd, size_t size)
+    {
+        unmap();
+
+#ifdef ARC_HAS_MMAP
+        if(size == 0)
+        {
+            return false;
+        }
+
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED)
+        {
+            return false;
+        }
+
+        ::madvise(data, size, MADV_SEQUENTIAL);
+
+        _data = static_cast<const char*>(data);
+        _size = size;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void mapped_file::unmap()
+    {
+#ifdef ARC_HAS_MMAP
+        if(_data != nullptr)
+        {
+            ::munmap(const_cast<char*>(_data), _size);
+        }
+#endif
+        _data = nullptr;
+        _size = 0;
+    }
+
+    const char* mapped_file::data() const
+    {
+        return _data;
+    }
+
+    size_t mapped_file::size() const
+    {
+        return _size;
+    }
+
+    bool mapped_file::is_mapped() const
+    {
+        return _data != nullptr;
+    }
+
+    size_t mapped_file::page_size()
+    {
+#ifdef ARC_HAS_MMAP
+        static const size_t size = size_t(::sysconf(_SC_PAGESIZE));
+        return size;
+#else
+        return 4096;
+#endif
+    }
+}
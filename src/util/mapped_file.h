@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+
+namespace arc
+{
+    // A read-only, private memory mapping of a file's contents.
+    class mapped_file
+    {
+    private:
+        const char* _data;
+        size_t _size;
+    public:
+        mapped_file();
+        ~mapped_file();
+
+        mapped_file(mapped_file&& other) noexcept;
+        mapped_file& operator=(mapped_file&& other) noexcept;
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        // Maps the first size bytes of an open file descriptor. Returns false
+        // if the file could not be mapped, in which case the caller should read
+        // it instead.
+        bool map(int fd, size_t size);
+        void unmap();
+
+        const char* data() const;
+        size_t size() const;
+        bool is_mapped() const;
+
+        static size_t page_size();
+    };
+}
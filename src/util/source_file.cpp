@@ -1,13 +1,33 @@
 #include "source_file.h"
 
 #include <fstream>
-#include <iterator>
 #include <algorithm>
+#include <bit>
+#include <atomic>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define ARC_HAS_SSE2
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define ARC_HAS_POSIX_IO
+#endif
+
+namespace
+{
+    // File ids start at 1, so a default constructed source_pos never names a real file.
+    std::atomic<uint32_t> next_file_id = 1;
+}
 
 namespace arc
 {
     source_file::source_file(const std::string& path, bool is_content)
-        : _exists(false), _path(path)
+        : _id(next_file_id++), _exists(false), _path(path), _data(nullptr), _size(0)
     {
         if(is_content)
         {
@@ -17,28 +37,199 @@ namespace arc
         }
         else
         {
-            std::ifstream input(path, std::ios::binary);
-            if(input.is_open())
+            _exists = read_file(path);
+        }
+
+        if(!_mapping.is_mapped())
+        {
+            use_buffer();
+        }
+    }
+
+    source_file::source_file(const source_file& previous, std::string_view content)
+        : _id(previous._id), _exists(true), _path(previous._path), _data(nullptr), _size(0), _buffer(content.begin(), content.end())
+    {
+        use_buffer();
+    }
+
+    void source_file::check_size(size_t size) const
+    {
+        if(size > max_size)
+        {
+            throw std::length_error("'" + _path + "' is too large, source files must be under 4 GiB");
+        }
+    }
+
+    void source_file::use_buffer()
+    {
+        check_size(_buffer.size());
+        _size = _buffer.size();
+        _buffer.push_back('\0');
+        _data = _buffer.data();
+    }
+
+#ifdef ARC_HAS_POSIX_IO
+    bool source_file::read_file(const std::string& path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+        {
+            return false;
+        }
+
+        struct stat info;
+        if(::fstat(fd, &info) != 0 || S_ISDIR(info.st_mode))
+        {
+            ::close(fd);
+            return false;
+        }
+
+        if(S_ISREG(info.st_mode))
+        {
+            auto size = size_t(info.st_size);
+            if(size > max_size)
             {
-                _buffer = std::vector<char>(std::istreambuf_iterator<char>(input), {});
-                _exists = true;
+                ::close(fd);
+                check_size(size);
             }
+
+            // The kernel zero fills the rest of the last page, which gives us the
+            // NUL sentinel for free unless the file ends exactly on a page boundary.
+            if(size % mapped_file::page_size() != 0 && _mapping.map(fd, size))
+            {
+                _data = _mapping.data();
+                _size = size;
+                ::close(fd);
+                return true;
+            }
+
+            _buffer.reserve(size + 1);
         }
+
+        // Pipes and other streams have no size up front, so read until end of file.
+        size_t used = 0;
+        _buffer.resize(std::max<size_t>(_buffer.capacity(), 4096));
+        while(true)
+        {
+            if(used == _buffer.size())
+            {
+                _buffer.resize(_buffer.size() * 2);
+            }
+
+            auto count = ::read(fd, _buffer.data() + used, _buffer.size() - used);
+            if(count < 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            if(count == 0)
+            {
+                break;
+            }
+            used += size_t(count);
+            if(used > max_size)
+            {
+                ::close(fd);
+                check_size(used);
+            }
+        }
+        _buffer.resize(used);
+
+        ::close(fd);
+        return true;
+    }
+#else
+    bool source_file::read_file(const std::string& path)
+    {
+        std::ifstream input(path, std::ios::binary | std::ios::ate);
+        if(!input.is_open())
+        {
+            return false;
+        }
+
+        auto size = input.tellg();
+        check_size(size_t(size));
+        input.seekg(0);
+        _buffer.resize(size_t(size));
+        input.read(_buffer.data(), size);
+        return true;
     }
+#endif
 
-    std::string source_file::get_line(size_t line) const
+    const std::vector<uint32_t>& source_file::line_starts() const
     {
-        size_t idx = 0;
-        size_t cur_line = 1;
-        for(auto c : _buffer)
+        std::call_once(_line_starts_built, [this]() {
+            _line_starts.reserve(_size / 32 + 1);
+            _line_starts.push_back(0);
+
+            size_t i = 0;
+#ifdef ARC_HAS_SSE2
+            auto newline = _mm_set1_epi8('\n');
+            for(; i + 16 <= _size; i += 16)
+            {
+                auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_data + i));
+                auto mask = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)));
+                while(mask != 0)
+                {
+                    _line_starts.push_back(uint32_t(i + std::countr_zero(mask) + 1));
+                    mask &= mask - 1;
+                }
+            }
+#endif
+            for(; i < _size; i++)
+            {
+                if(_data[i] == '\n')
+                {
+                    _line_starts.push_back(uint32_t(i + 1));
+                }
+            }
+        });
+
+        return _line_starts;
+    }
+
+    std::string_view source_file::get_line(size_t line) const
+    {
+        const auto& starts = line_starts();
+        if(line == 0 || line > starts.size())
         {
-            if(cur_line == line) { break; }
-            idx++;
-            if(c == '\n') { cur_line++; }
+            return std::string_view();
         }
 
-        auto end = std::find(_buffer.begin() + idx, _buffer.end(), '\n');
-        return std::string(_buffer.begin() + idx, end);
+        auto begin = _data + starts[line - 1];
+        auto end = line < starts.size() ? _data + starts[line] - 1 : _data + _size;
+        return std::string_view(begin, end - begin);
+    }
+
+    source_location source_file::location(size_t offset) const
+    {
+        const auto& starts = line_starts();
+        auto next_line = std::upper_bound(starts.begin(), starts.end(), uint32_t(offset));
+        auto line = size_t(next_line - starts.begin());
+        return {
+            .line = line,
+            .column = offset - starts[line - 1] + 1
+        };
+    }
+
+    source_location source_file::location(source_pos position) const
+    {
+        return location(position.offset);
+    }
+
+    size_t source_file::line_count() const
+    {
+        return line_starts().size();
+    }
+
+    std::string_view source_file::text(size_t offset, size_t length) const
+    {
+        return std::string_view(_data + offset, length);
+    }
+
+    uint32_t source_file::id() const
+    {
+        return _id;
     }
 
     std::string source_file::path() const
@@ -48,16 +239,21 @@ namespace arc
 
     const char* source_file::buffer() const
     {
-        return _buffer.data();
+        return _data;
     }
 
     size_t source_file::size() const
     {
-        return _buffer.size();
+        return _size;
     }
 
     bool source_file::exists() const
     {
         return _exists;
     }
+
+    bool source_file::is_mapped() const
+    {
+        return _mapping.is_mapped();
+    }
 }
@@ -2,29 +2,79 @@
 
 #include <string>
 #include <vector>
+#include <string_view>
+#include <cstdint>
+#include <mutex>
+
+#include "mapped_file.h"
 
 namespace arc
 {
+    // A position in a source file, line and column are only worked out from the
+    // file's line table when a diagnostic needs them.
     struct source_pos
+    {
+        uint32_t offset = 0;
+        uint32_t file = 0;
+    };
+
+    struct source_location
     {
         size_t line = 1;
         size_t column = 1;
     };
 
+    // The contents of a source file. The buffer is always followed by at least
+    // one NUL byte that is not counted in size(), so the lexer can look one
+    // character past the end without bounds checks.
+    //
+    // Positions are 32-bit offsets, so the constructors throw std::length_error
+    // for anything longer than max_size.
     class source_file
     {
+    public:
+        static constexpr size_t max_size = UINT32_MAX;
     private:
+        uint32_t _id;
         bool _exists;
         std::string _path;
+
+        const char* _data;
+        size_t _size;
+
+        mapped_file _mapping;
         std::vector<char> _buffer;
+
+        // Offset of the first character of every line, built on first use.
+        mutable std::vector<uint32_t> _line_starts;
+        mutable std::once_flag _line_starts_built;
     public:
         source_file(const std::string& path, bool is_content = false);
 
-        std::string get_line(size_t line) const;
+        // A new version of an in-memory file. Keeps the id and path of previous,
+        // so positions taken from the old version still name this file.
+        source_file(const source_file& previous, std::string_view content);
+
+        source_file(const source_file&) = delete;
+        source_file& operator=(const source_file&) = delete;
 
+        std::string_view get_line(size_t line) const;
+        std::string_view text(size_t offset, size_t length) const;
+
+        source_location location(size_t offset) const;
+        source_location location(source_pos position) const;
+        size_t line_count() const;
+
+        uint32_t id() const;
         std::string path() const;
         const char* buffer() const;
         size_t size() const;
         bool exists() const;
+        bool is_mapped() const;
+    private:
+        bool read_file(const std::string& path);
+        void check_size(size_t size) const;
+        void use_buffer();
+        const std::vector<uint32_t>& line_starts() const;
     };
 }
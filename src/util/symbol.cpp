@@ -0,0 +1,97 @@
+#include "symbol.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "arena.h"
+
+namespace
+{
+    // Interning is split over shards by hash so parallel lexers rarely wait on
+    // each other. Texts by id live in fixed size chunks that never move, which
+    // lets text() read them without taking a lock.
+    constexpr size_t shard_count = 64;
+    constexpr size_t chunk_bits = 16;
+    constexpr size_t chunk_size = size_t(1) << chunk_bits;
+    constexpr size_t chunk_count = (size_t(1) << 32) / chunk_size;
+
+    struct shard
+    {
+        std::mutex mutex;
+        std::unordered_map<std::string_view, uint32_t> ids;
+        arc::arena texts;
+    };
+
+    struct symbol_table
+    {
+        shard shards[shard_count];
+
+        std::atomic<uint32_t> next = 0;
+        std::mutex chunk_mutex;
+        std::atomic<std::string_view*> chunks[chunk_count] = {};
+
+        symbol_table()
+        {
+            shards[std::hash<std::string_view>()("") % shard_count].ids.emplace("", next++);
+            slot(0) = "";
+        }
+
+        std::string_view& slot(uint32_t id)
+        {
+            auto& chunk = chunks[id >> chunk_bits];
+            auto texts = chunk.load(std::memory_order_acquire);
+            if(texts == nullptr)
+            {
+                std::lock_guard<std::mutex> lock(chunk_mutex);
+                texts = chunk.load(std::memory_order_relaxed);
+                if(texts == nullptr)
+                {
+                    texts = new std::string_view[chunk_size];
+                    chunk.store(texts, std::memory_order_release);
+                }
+            }
+            return texts[id & (chunk_size - 1)];
+        }
+    };
+
+    // Never destroyed, so symbols stay usable from other static destructors.
+    symbol_table& table()
+    {
+        static auto table = new symbol_table();
+        return *table;
+    }
+}
+
+namespace arc
+{
+    symbol symbol::intern(std::string_view text)
+    {
+        auto hash = std::hash<std::string_view>()(text);
+        auto& shard = table().shards[hash % shard_count];
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto f = shard.ids.find(text);
+        if(f != shard.ids.end())
+        {
+            return symbol { f->second };
+        }
+
+        auto id = table().next.fetch_add(1, std::memory_order_relaxed);
+        auto copy = shard.texts.copy(text);
+        table().slot(id) = copy;
+        shard.ids.emplace(copy, id);
+        return symbol { id };
+    }
+
+    std::string_view symbol::text() const
+    {
+        return table().slot(id);
+    }
+
+    uint32_t symbol::count()
+    {
+        return table().next.load(std::memory_order_relaxed);
+    }
+}
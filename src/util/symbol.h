@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+namespace arc
+{
+    // An interned identifier. The same text always gives the same symbol for the
+    // life of the process, so names compare and hash as a single integer, and ids
+    // are handed out densely from zero so they can index flat tables. Id zero,
+    // which is what symbol() gives, is always the empty name.
+    struct symbol
+    {
+        uint32_t id;
+
+        bool operator==(const symbol&) const = default;
+
+        // Safe to call from several threads at once.
+        static symbol intern(std::string_view text);
+
+        std::string_view text() const;
+
+        // One past the largest id handed out so far.
+        static uint32_t count();
+    };
+}
+
+template<>
+struct std::hash<arc::symbol>
+{
+    size_t operator()(arc::symbol s) const
+    {
+        return std::hash<uint32_t>()(s.id);
+    }
+};
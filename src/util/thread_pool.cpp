@@ -0,0 +1,95 @@
+#include "thread_pool.h"
+
+namespace arc
+{
+    thread_pool::thread_pool(size_t threads)
+        : _task(nullptr), _count(0), _next(0), _active(0), _generation(0), _stopping(false)
+    {
+        for(size_t i = 1; i < threads; i++)
+        {
+            _workers.emplace_back([this]() { worker_main(); });
+        }
+    }
+
+    thread_pool::~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _wake.notify_all();
+
+        for(auto& worker : _workers)
+        {
+            worker.join();
+        }
+    }
+
+    void thread_pool::parallel_for(size_t count, const std::function<void(size_t)>& task)
+    {
+        if(_workers.empty() || count <= 1)
+        {
+            for(size_t i = 0; i < count; i++)
+            {
+                task(i);
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> submit(_submit_mutex);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _task = &task;
+            _count = count;
+            _next = 0;
+            _active = _workers.size();
+            _generation++;
+        }
+        _wake.notify_all();
+
+        run_tasks();
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _finished.wait(lock, [this]() { return _active == 0; });
+        _task = nullptr;
+    }
+
+    size_t thread_pool::size() const
+    {
+        return _workers.size() + 1;
+    }
+
+    void thread_pool::run_tasks()
+    {
+        for(size_t i = _next++; i < _count; i = _next++)
+        {
+            (*_task)(i);
+        }
+    }
+
+    void thread_pool::worker_main()
+    {
+        uint64_t seen_generation = 0;
+        while(true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wake.wait(lock, [&]() { return _stopping || _generation != seen_generation; });
+                if(_stopping)
+                {
+                    return;
+                }
+                seen_generation = _generation;
+            }
+
+            run_tasks();
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _active--;
+            }
+            _finished.notify_one();
+        }
+    }
+}
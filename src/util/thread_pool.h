@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+namespace arc
+{
+    // A fixed set of worker threads for data parallel loops. The calling thread
+    // takes part in every loop, so a pool of one thread runs everything inline.
+    class thread_pool
+    {
+    private:
+        std::vector<std::thread> _workers;
+
+        std::mutex _submit_mutex;
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _finished;
+
+        const std::function<void(size_t)>* _task;
+        size_t _count;
+        std::atomic<size_t> _next;
+        size_t _active;
+        uint64_t _generation;
+        bool _stopping;
+    public:
+        thread_pool(size_t threads = std::thread::hardware_concurrency());
+        ~thread_pool();
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        // Runs task(i) for every i in [0, count) across the pool and returns once
+        // all of them are done. Tasks must not throw, and must not start another
+        // loop on the same pool.
+        void parallel_for(size_t count, const std::function<void(size_t)>& task);
+
+        size_t size() const;
+    private:
+        void run_tasks();
+        void worker_main();
+    };
+}